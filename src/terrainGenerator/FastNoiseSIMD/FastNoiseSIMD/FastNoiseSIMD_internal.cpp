@@ -1034,7 +1034,9 @@ SIMD_LEVEL_CLASS::FASTNOISE_SIMD_CLASS(SIMD_LEVEL)(int seed)
 	m_fractalBounding = CalculateFractalBounding(m_octaves, m_gain);
 	m_perturbFractalBounding = CalculateFractalBounding(m_perturbOctaves, m_perturbGain);
 	FUNC(InitSIMDValues)();
-	s_currentSIMDLevel = SIMD_LEVEL;
+	// Only written when it changes, instances are created concurrently once the level was detected
+	if (s_currentSIMDLevel != SIMD_LEVEL)
+		s_currentSIMDLevel = SIMD_LEVEL;
 }
 
 int SIMD_LEVEL_CLASS::AlignedSize(int size)
@@ -0,0 +1,59 @@
+#include "derivedMaps.h"
+
+#include "heightfieldKernels.h"
+#include "memoryTracking.h"
+#include "profiler.h"
+#include "threadPool.h"
+#include <algorithm>
+
+// Smaller maps convert faster than the pool wakes up
+static constexpr size_t kMinParallelTexelCount = 512 * 512;
+
+std::vector<uint16_t> generateNoiseMapTexture(const HeightfieldView &noiseMap, ThreadPool *threadPool) {
+  PROFILE_ZONE("Convert noise map texture");
+  MemoryTagScope memoryTagScope(MEMORY_TAG::TEXTURE_STAGING);
+
+  const auto width = noiseMap.width();
+  const auto height = noiseMap.height();
+  std::vector<uint16_t> noiseMapTextureData(size_t(width) * size_t(height));
+  const auto convertRows = [&](const int firstRow, const int lastRow) {
+    for (int i = firstRow; i < lastRow; ++i) {
+      convertRowToUnorm16(noiseMap.row(i).data(), noiseMapTextureData.data() + size_t(i) * width, width);
+    }
+  };
+
+  threadPool = threadPool != nullptr ? threadPool : &getThreadPool();
+  if (size_t(width) * size_t(height) < kMinParallelTexelCount) {
+    convertRows(0, height);
+  } else {
+    const auto bandCount = std::min(height, int(threadPool->threadCount()) * 4);
+    threadPool->parallelFor(bandCount, [&](const int band) {
+      convertRows(band * height / bandCount, (band + 1) * height / bandCount);
+    });
+  }
+
+  return noiseMapTextureData;
+}
+
+std::vector<glm::vec3> generateNormalMap(const HeightfieldView &noiseMap, const float heightScale) {
+  PROFILE_ZONE("Generate normal map");
+  MemoryTagScope memoryTagScope(MEMORY_TAG::TEXTURE_STAGING);
+
+  const auto width = noiseMap.width();
+  const auto height = noiseMap.height();
+
+  std::vector<glm::vec3> normals;
+  normals.reserve(size_t(width) * size_t(height));
+  for (int i = 0; i < height; ++i) {
+    const auto previousRow = noiseMap.row(std::max(i - 1, 0));
+    const auto row = noiseMap.row(i);
+    const auto nextRow = noiseMap.row(std::min(i + 1, height - 1));
+    for (int j = 0; j < width; ++j) {
+      const auto dx = (row[std::min(j + 1, width - 1)] - row[std::max(j - 1, 0)]) * 0.5f * heightScale;
+      const auto dy = (nextRow[j] - previousRow[j]) * 0.5f * heightScale;
+      normals.push_back(glm::normalize(glm::vec3(-dx, -dy, 1.0f)));
+    }
+  }
+
+  return normals;
+}
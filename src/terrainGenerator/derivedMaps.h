@@ -0,0 +1,25 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+
+#include "noiseMapGenerator.h"
+
+#include "glm/glm.hpp"
+
+class ThreadPool;
+
+// Single channel 16-bit unorm texels of the map clamped to [0, 1], row by row without the stride padding,
+// as the height textures take them. Big maps are converted in bands of rows on the thread pool (the shared
+// pool if not set).
+std::vector<uint16_t> generateNoiseMapTexture(const HeightfieldView &noiseMap,
+                                              ThreadPool *threadPool = nullptr);
+
+// Texels of a rect of a height texture, as generateNoiseMapTexture returns them for the rect
+struct TextureRegion {
+  HeightRect rect;
+  std::vector<uint16_t> texels;
+};
+
+// Unit normals (z up) from central differences, clamped at the edges. heightScale is the height of a map
+// value of 1 measured in texels.
+std::vector<glm::vec3> generateNormalMap(const HeightfieldView &noiseMap, const float heightScale);
@@ -0,0 +1,117 @@
+#include "dirtyRegion.h"
+
+#include "profiler.h"
+#include "threadPool.h"
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+
+DirtyRegion::DirtyRegion(const int width, const int height, const int tileSize)
+    : _width(width), _height(height), _tileSize(tileSize), _tileCountX((width + tileSize - 1) / tileSize),
+      _tileCountY((height + tileSize - 1) / tileSize), _dirtyTiles(size_t(_tileCountX) * _tileCountY) {
+  assert(tileSize > 0);
+}
+
+void DirtyRegion::add(const HeightRect &rect) {
+  const auto firstX = std::max(rect.x, 0);
+  const auto firstY = std::max(rect.y, 0);
+  const auto lastX = std::min(rect.x + rect.width, _width) - 1;
+  const auto lastY = std::min(rect.y + rect.height, _height) - 1;
+  if (firstX > lastX || firstY > lastY) {
+    return;
+  }
+
+  for (int tileY = firstY / _tileSize; tileY <= lastY / _tileSize; ++tileY) {
+    for (int tileX = firstX / _tileSize; tileX <= lastX / _tileSize; ++tileX) {
+      auto &dirtyTile = _dirtyTiles[size_t(tileY) * _tileCountX + tileX];
+      _dirtyTileCount += dirtyTile == 0 ? 1 : 0;
+      dirtyTile = 1;
+    }
+  }
+}
+
+void DirtyRegion::addAll() {
+  std::fill(_dirtyTiles.begin(), _dirtyTiles.end(), uint8_t(1));
+  _dirtyTileCount = int(_dirtyTiles.size());
+}
+
+void DirtyRegion::add(const DirtyRegion &other) {
+  assert(other._width == _width && other._height == _height && other._tileSize == _tileSize);
+
+  for (size_t i = 0; i < _dirtyTiles.size(); ++i) {
+    _dirtyTiles[i] |= other._dirtyTiles[i];
+  }
+  _dirtyTileCount = int(std::count(_dirtyTiles.begin(), _dirtyTiles.end(), uint8_t(1)));
+}
+
+void DirtyRegion::addChanges(const HeightfieldView &previous, const HeightfieldView &next,
+                             ThreadPool *threadPool) {
+  assert(previous.width() == _width && previous.height() == _height);
+  assert(next.width() == _width && next.height() == _height);
+  PROFILE_ZONE("Find changed tiles");
+
+  // A tile stops being compared at its first changed row
+  threadPool = threadPool != nullptr ? threadPool : &getThreadPool();
+  threadPool->parallelFor2D(_tileCountX, _tileCountY, [&](const int tileX, const int tileY) {
+    auto &dirtyTile = _dirtyTiles[size_t(tileY) * _tileCountX + tileX];
+    const auto x = tileX * _tileSize;
+    const auto width = std::min(_tileSize, _width - x);
+    for (int i = tileY * _tileSize; i < std::min((tileY + 1) * _tileSize, _height) && dirtyTile == 0; ++i) {
+      if (std::memcmp(previous.row(i).data() + x, next.row(i).data() + x, width * sizeof(float)) != 0) {
+        dirtyTile = 1;
+      }
+    }
+  });
+  _dirtyTileCount = int(std::count(_dirtyTiles.begin(), _dirtyTiles.end(), uint8_t(1)));
+}
+
+void DirtyRegion::clear() {
+  std::fill(_dirtyTiles.begin(), _dirtyTiles.end(), uint8_t(0));
+  _dirtyTileCount = 0;
+}
+
+std::vector<HeightRect> DirtyRegion::rects() const {
+  struct TileRun {
+    int firstTileX, lastTileX;
+    int rectIndex;
+  };
+
+  std::vector<HeightRect> rects;
+  std::vector<TileRun> previousRuns;
+  std::vector<TileRun> runs;
+  for (int tileY = 0; tileY < _tileCountY; ++tileY) {
+    const auto y = tileY * _tileSize;
+    const auto height = std::min(_tileSize, _height - y);
+    const auto dirtyTiles = _dirtyTiles.data() + size_t(tileY) * _tileCountX;
+
+    runs.clear();
+    for (int tileX = 0; tileX < _tileCountX;) {
+      if (dirtyTiles[tileX] == 0) {
+        ++tileX;
+        continue;
+      }
+
+      auto lastTileX = tileX;
+      while (lastTileX + 1 < _tileCountX && dirtyTiles[lastTileX + 1] != 0) {
+        ++lastTileX;
+      }
+
+      const auto isSameRun = [&](const TileRun &run) {
+        return run.firstTileX == tileX && run.lastTileX == lastTileX;
+      };
+      const auto previousRun = std::find_if(previousRuns.begin(), previousRuns.end(), isSameRun);
+      if (previousRun != previousRuns.end()) {
+        rects[previousRun->rectIndex].height += height;
+        runs.push_back(*previousRun);
+      } else {
+        const auto x = tileX * _tileSize;
+        rects.push_back({x, y, std::min((lastTileX + 1) * _tileSize, _width) - x, height});
+        runs.push_back({tileX, lastTileX, int(rects.size()) - 1});
+      }
+      tileX = lastTileX + 1;
+    }
+    std::swap(runs, previousRuns);
+  }
+
+  return rects;
+}
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "heightfield.h"
+
+class ThreadPool;
+
+// Changed parts of a map, tracked on a grid of square tiles so that any number of edits stays a few rects
+class DirtyRegion {
+public:
+  static constexpr int kDefaultTileSize = 64;
+
+  DirtyRegion() = default;
+  DirtyRegion(const int width, const int height, const int tileSize = kDefaultTileSize);
+
+  int width() const { return _width; }
+  int height() const { return _height; }
+  int tileSize() const { return _tileSize; }
+  bool empty() const { return _dirtyTileCount == 0; }
+
+  // Clipped to the map
+  void add(const HeightRect &rect);
+  void addAll();
+  // other has to have the same size and tile size
+  void add(const DirtyRegion &other);
+  // Marks the tiles where the two maps differ, both have to have the size of the region. Tiles are
+  // compared in parallel on the thread pool (the shared pool if not set).
+  void addChanges(const HeightfieldView &previous, const HeightfieldView &next,
+                  ThreadPool *threadPool = nullptr);
+  void clear();
+
+  // Covers exactly the dirty tiles, clipped to the map. Runs of dirty tiles in a tile row are merged with
+  // the same run in the rows below.
+  std::vector<HeightRect> rects() const;
+
+private:
+  int _width = 0;
+  int _height = 0;
+  int _tileSize = kDefaultTileSize;
+  int _tileCountX = 0;
+  int _tileCountY = 0;
+  std::vector<uint8_t> _dirtyTiles;
+  int _dirtyTileCount = 0;
+};
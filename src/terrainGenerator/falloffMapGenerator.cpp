@@ -1,27 +1,96 @@
 #include "falloffMapGenerator.h"
 
-#include <array>
-#include <memory>
+#include "linearArena.h"
+#include "memoryTracking.h"
+#include "profiler.h"
+#include "threadPool.h"
+#include <algorithm>
+#include <cmath>
+#include <mutex>
+#include <vector>
 
-FalloffMap generateFalloffMap(const int mapSize) {
-  FalloffMap falloffMap;
-  falloffMap.reserve(size_t(mapSize) * size_t(mapSize));
+// Falloff maps of the last few map sizes are kept around, the UI usually toggles between two at most
+static constexpr size_t kFalloffMapCacheSize = 2;
 
+// Smaller tiles fill faster than the pool wakes up
+static constexpr size_t kMinParallelTexelCount = 512 * 512;
+
+static std::mutex falloffMapsMutex;
+static std::vector<FalloffMap> falloffMaps; // Most recently used first
+
+static float getFalloffValue(const float maxValue) {
   float b = 2.2f;
 
-  for (size_t i = 0; i < mapSize; ++i) {
-    for (size_t j = 0; j < mapSize; ++j) {
-      const auto x = i / float(mapSize) * 2.0f - 1.0f;
-      const auto y = j / float(mapSize) * 2.0f - 1.0f;
-      const auto maxValue = std::max(std::fabs(x), std::fabs(y));
+  const auto maxValuePow3 = maxValue * maxValue * maxValue;
+  const auto temp = b - b * maxValue;
+  const auto tempPow3 = temp * temp * temp;
+
+  return maxValuePow3 / (maxValuePow3 + tempPow3);
+}
+
+Heightfield generateFalloffMapTile(const int mapSize, const int x, const int y, const int width,
+                                   const int height) {
+  PROFILE_ZONE("Generate falloff map");
+  MemoryTagScope memoryTagScope(MEMORY_TAG::FALLOFF_MAPS);
 
-      const auto maxValuePow3 = maxValue * maxValue * maxValue;
-      const auto temp = b - b * maxValue;
-      const auto tempPow3 = temp * temp * temp;
+  // The falloff only depends on max(|x|, |y|), so it is fully described by the 1D profile along one axis.
+  // Each texel picks the profile entry with the larger distance, which gives exactly the value the
+  // per-texel evaluation would.
+  const auto getDistance = [mapSize](const int i) { return std::fabs(i / float(mapSize) * 2.0f - 1.0f); };
 
-      falloffMap.push_back(glm::vec3(maxValuePow3 / (maxValuePow3 + tempPow3)));
+  ScratchArenaScope scratch;
+  const auto columnDistances = scratch.arena().allocateArray<float>(size_t(width));
+  const auto columnProfile = scratch.arena().allocateArray<float>(size_t(width));
+  for (int j = 0; j < width; ++j) {
+    columnDistances[j] = getDistance(x + j);
+    columnProfile[j] = getFalloffValue(columnDistances[j]);
+  }
+
+  Heightfield falloffMap(width, height);
+  const auto fillRows = [&](const int firstRow, const int lastRow) {
+    for (int i = firstRow; i < lastRow; ++i) {
+      const auto rowDistance = getDistance(y + i);
+      const auto rowProfile = getFalloffValue(rowDistance);
+      const auto falloffValues = falloffMap.row(i);
+      for (int j = 0; j < width; ++j) {
+        falloffValues[j] = rowDistance >= columnDistances[j] ? rowProfile : columnProfile[j];
+      }
     }
+  };
+
+  if (size_t(width) * size_t(height) < kMinParallelTexelCount) {
+    fillRows(0, height);
+  } else {
+    auto &threadPool = getThreadPool();
+    const auto bandCount = std::min(height, int(threadPool.threadCount()) * 4);
+    threadPool.parallelFor(bandCount, [&](const int band) {
+      fillRows(band * height / bandCount, (band + 1) * height / bandCount);
+    });
   }
 
   return falloffMap;
-}
\ No newline at end of file
+}
+
+Heightfield generateFalloffMap(const int mapSize) {
+  return generateFalloffMapTile(mapSize, 0, 0, mapSize, mapSize);
+}
+
+FalloffMap getFalloffMap(const int mapSize) {
+  std::lock_guard lock(falloffMapsMutex);
+  MemoryTagScope memoryTagScope(MEMORY_TAG::FALLOFF_MAPS);
+
+  auto falloffMapIt = std::find_if(falloffMaps.begin(), falloffMaps.end(), [&](const FalloffMap &falloffMap) {
+    return falloffMap->width() == mapSize;
+  });
+  if (falloffMapIt != falloffMaps.end()) {
+    std::rotate(falloffMaps.begin(), falloffMapIt, falloffMapIt + 1);
+    return falloffMaps.front();
+  }
+
+  falloffMaps.insert(falloffMaps.begin(), std::make_shared<const Heightfield>(generateFalloffMap(mapSize)));
+  if (falloffMaps.size() > kFalloffMapCacheSize) {
+    falloffMaps.pop_back();
+  }
+
+  return falloffMaps.front();
+}
@@ -1,9 +1,20 @@
 #pragma once
-#include <vector>
+#include <memory>
 
-#include "glm/glm.hpp"
+#include "heightfield.h"
 
 
-using FalloffMap = std::vector<glm::vec3>;
+// Read-only, single channel falloff shared by the noise post-process and the texture upload. It has the
+// same row-major layout (and padded stride) as the noise map it is applied to.
+using FalloffMap = std::shared_ptr<const Heightfield>;
 
-FalloffMap generateFalloffMap(const int mapSize);
\ No newline at end of file
+// Builds a new map every call, getFalloffMap should be used instead outside of benchmarks
+Heightfield generateFalloffMap(const int mapSize);
+
+// Texels [x, x + width) x [y, y + height) of the falloff map of a mapSize map, for maps too large to hold
+// their whole falloff map
+Heightfield generateFalloffMapTile(const int mapSize, const int x, const int y, const int width,
+                                   const int height);
+
+// Cached by map size. Maps handed out stay valid after being evicted from the cache.
+FalloffMap getFalloffMap(const int mapSize);
@@ -0,0 +1,143 @@
+#include "frameStatistics.h"
+
+#include "memoryTracking.h"
+#include "profiler.h"
+#include <cmath>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+
+static constexpr auto kNanoToMilliSeconds = 1000000.0f;
+
+// A capture copies every profiler ring, which is a hitch of its own, so following slow frames are skipped
+static constexpr auto kMinSpikeCaptureIntervalInSec = 2.0;
+
+FrameStatistics::FrameStatistics() : _frames(kFrameHistorySize) {
+  _lastSpikeCaptureTime = startTimeMeasure() - std::chrono::duration<double>(kMinSpikeCaptureIntervalInSec);
+}
+
+void FrameStatistics::beginFrame() {
+  _currentFrame = {};
+  _frameStart = startTimeMeasure();
+  _frameStartTimestamp = getProfilerTimestamp();
+  _frameStartHeapAllocationCount = getThreadHeapAllocationCount();
+}
+
+void FrameStatistics::endFrame() {
+  _currentFrame.frameTimeInMs = endTimeMeasure(_frameStart) / kNanoToMilliSeconds;
+  _currentFrame.heapAllocationCount = int(getThreadHeapAllocationCount() - _frameStartHeapAllocationCount);
+  _frames[_frameIndex % kFrameHistorySize] = _currentFrame;
+  ++_frameIndex;
+
+  if (spikeThresholdInMs > 0.0f && _currentFrame.frameTimeInMs > spikeThresholdInMs &&
+      !spikeCapturePath.empty()) {
+    captureSpike(_currentFrame);
+  }
+}
+
+void FrameStatistics::addStageTime(const FRAME_STAGE stage, const float timeInMs) {
+  _currentFrame.stageTimesInMs[size_t(stage)] += timeInMs;
+}
+
+// Nearest rank over the frames in the history
+template <typename GetTime>
+FrameTimePercentiles FrameStatistics::getPercentiles(const GetTime &getTime) const {
+  const auto count = frameCount();
+  if (count == 0) {
+    return {};
+  }
+
+  ScratchArenaScope scratch;
+  const auto times = scratch.arena().allocateArray<float>(size_t(count));
+  for (int i = 0; i < count; ++i) {
+    times[i] = getTime(_frames[i]);
+  }
+
+  const auto getPercentile = [&](const float percentile) {
+    const auto rank = std::clamp(int(std::ceil(percentile / 100.0f * count)) - 1, 0, count - 1);
+    std::nth_element(times.begin(), times.begin() + rank, times.end());
+    return times[rank];
+  };
+  return {getPercentile(50.0f), getPercentile(95.0f), getPercentile(99.0f)};
+}
+
+FrameTimePercentiles FrameStatistics::frameTimePercentiles() const {
+  return getPercentiles([](const FrameTimes &frameTimes) { return frameTimes.frameTimeInMs; });
+}
+
+FrameTimePercentiles FrameStatistics::stageTimePercentiles(const FRAME_STAGE stage) const {
+  return getPercentiles(
+      [stage](const FrameTimes &frameTimes) { return frameTimes.stageTimesInMs[size_t(stage)]; });
+}
+
+ArenaVector<float> FrameStatistics::frameTimeHistory(LinearArena *arena) const {
+  const auto count = frameCount();
+  const auto oldestFrame = _frameIndex - count;
+
+  ArenaVector<float> frameTimes(size_t(count), arena);
+  for (int i = 0; i < count; ++i) {
+    frameTimes[i] = _frames[(oldestFrame + i) % kFrameHistorySize].frameTimeInMs;
+  }
+  return frameTimes;
+}
+
+int FrameStatistics::lastFrameHeapAllocationCount() const {
+  return _frameIndex > 0 ? _frames[(_frameIndex - 1) % kFrameHistorySize].heapAllocationCount : 0;
+}
+
+int FrameStatistics::maxFrameHeapAllocationCount() const {
+  int maxCount = 0;
+  for (int i = 0; i < frameCount(); ++i) {
+    maxCount = std::max(maxCount, _frames[i].heapAllocationCount);
+  }
+  return maxCount;
+}
+
+void FrameStatistics::captureSpike(const FrameTimes &frameTimes) {
+  const auto timeSinceLastCapture =
+      std::chrono::duration<double>(startTimeMeasure() - _lastSpikeCaptureTime).count();
+  if (timeSinceLastCapture < kMinSpikeCaptureIntervalInSec) {
+    return;
+  }
+  _lastSpikeCaptureTime = startTimeMeasure();
+
+  std::error_code errorCode;
+  std::filesystem::create_directories(spikeCapturePath, errorCode);
+  const auto frameNumber = _frameIndex - 1;
+
+  std::string stageTimes;
+  for (size_t i = 0; i < kFrameStageNames.size(); ++i) {
+    char stageTime[64];
+    snprintf(stageTime, sizeof(stageTime), "%s%s %.2f ms", i > 0 ? ", " : "", kFrameStageNames[i],
+             frameTimes.stageTimesInMs[i]);
+    stageTimes += stageTime;
+  }
+
+  char capture[512];
+  snprintf(capture, sizeof(capture), "Frame %llu took %.2f ms\n%s",
+           static_cast<unsigned long long>(frameNumber), frameTimes.frameTimeInMs, stageTimes.c_str());
+  _lastSpikeCapture = capture;
+
+  // The stage breakdown of every captured frame is appended to a log, the zones go to a trace per frame
+  std::ofstream spikeLog(std::filesystem::path(spikeCapturePath) / "frameSpikes.log", std::ios::app);
+  spikeLog << "Frame " << frameNumber << ": " << frameTimes.frameTimeInMs << " ms, " << stageTimes << "\n";
+#ifdef TERRAIN_GENERATOR_PROFILING
+  const auto filePath =
+      (std::filesystem::path(spikeCapturePath) / ("frame" + std::to_string(frameNumber) + ".trace.json"))
+          .string();
+  if (writeChromeTrace(filePath, _frameStartTimestamp, getProfilerTimestamp())) {
+    _lastSpikeCapture += "\nZones saved to " + filePath;
+  }
+#endif
+}
+
+FrameStageTimer::FrameStageTimer(FrameStatistics *frameStatistics, const FRAME_STAGE stage)
+    : _frameStatistics(frameStatistics), _stage(stage), _start(startTimeMeasure()),
+      _startTimestamp(getProfilerTimestamp()) {}
+
+FrameStageTimer::~FrameStageTimer() {
+#ifdef TERRAIN_GENERATOR_PROFILING
+  recordProfilerZone(kFrameStageNames[size_t(_stage)], _startTimestamp, getProfilerTimestamp());
+#endif
+  _frameStatistics->addStageTime(_stage, endTimeMeasure(_start) / kNanoToMilliSeconds);
+}
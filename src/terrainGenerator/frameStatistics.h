@@ -0,0 +1,87 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "linearArena.h"
+#include "timeMeasureUtils.h"
+
+enum class FRAME_STAGE { UPDATE_SCENE, MAP_PASS, REFLECTION_PASS, SCENE_PASS, UI, SWAP_BUFFERS, COUNT };
+
+constexpr std::array<const char *, size_t(FRAME_STAGE::COUNT)> kFrameStageNames{
+    "Update scene", "Map pass", "Reflection pass", "Scene pass", "UI", "Swap buffers"};
+
+// In milliseconds
+struct FrameTimePercentiles {
+  float p50 = 0.0f;
+  float p95 = 0.0f;
+  float p99 = 0.0f;
+};
+
+// CPU time of the most recent frames, in total and per stage. Frames slower than spikeThresholdInMs get
+// the profiler zones of every thread during that frame written to spikeCapturePath.
+class FrameStatistics {
+public:
+  static constexpr int kFrameHistorySize = 600;
+
+  FrameStatistics();
+
+  void beginFrame();
+  void endFrame();
+  void addStageTime(const FRAME_STAGE stage, const float timeInMs);
+
+  int frameCount() const { return int(std::min<uint64_t>(_frameIndex, kFrameHistorySize)); }
+  FrameTimePercentiles frameTimePercentiles() const;
+  FrameTimePercentiles stageTimePercentiles(const FRAME_STAGE stage) const;
+  // Oldest first, allocated from arena
+  ArenaVector<float> frameTimeHistory(LinearArena *arena) const;
+
+  // Heap allocations of the main thread between beginFrame and endFrame, zero once nothing is loaded or
+  // regenerated
+  int lastFrameHeapAllocationCount() const;
+  int maxFrameHeapAllocationCount() const; // Over the history
+
+  const std::string &lastSpikeCapture() const { return _lastSpikeCapture; }
+
+  float spikeThresholdInMs = 50.0f; // 0 disables spike captures
+  std::string spikeCapturePath;
+
+private:
+  struct FrameTimes {
+    float frameTimeInMs = 0.0f;
+    std::array<float, size_t(FRAME_STAGE::COUNT)> stageTimesInMs = {};
+    int heapAllocationCount = 0;
+  };
+
+  template <typename GetTime> FrameTimePercentiles getPercentiles(const GetTime &getTime) const;
+  void captureSpike(const FrameTimes &frameTimes);
+
+  std::vector<FrameTimes> _frames; // Ring of kFrameHistorySize frames
+  uint64_t _frameIndex = 0;
+  FrameTimes _currentFrame;
+  TimePoint _frameStart;
+  uint64_t _frameStartTimestamp = 0;
+  uint64_t _frameStartHeapAllocationCount = 0;
+  TimePoint _lastSpikeCaptureTime;
+  std::string _lastSpikeCapture;
+};
+
+// Adds the time until the end of the scope to a stage of the current frame, and records it as a profiler
+// zone named after the stage
+class FrameStageTimer {
+public:
+  FrameStageTimer(FrameStatistics *frameStatistics, const FRAME_STAGE stage);
+  ~FrameStageTimer();
+
+  FrameStageTimer(const FrameStageTimer &) = delete;
+  FrameStageTimer &operator=(const FrameStageTimer &) = delete;
+
+private:
+  FrameStatistics *_frameStatistics;
+  FRAME_STAGE _stage;
+  TimePoint _start;
+  uint64_t _startTimestamp;
+};
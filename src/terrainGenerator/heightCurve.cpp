@@ -0,0 +1,101 @@
+#include "heightCurve.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+
+static float evaluatePolynomial(const std::vector<float> &coefficients, const float x) {
+  auto value = 0.0f;
+  for (auto coefficientIt = coefficients.rbegin(); coefficientIt != coefficients.rend(); ++coefficientIt) {
+    value = value * x + *coefficientIt;
+  }
+
+  return value;
+}
+
+// Fritsch-Carlson tangents, limited so every segment between monotone points stays monotone
+static std::vector<float> getMonotoneTangents(const std::vector<glm::vec2> &points) {
+  const auto pointCount = points.size();
+
+  std::vector<float> slopes(pointCount - 1);
+  for (size_t i = 0; i < slopes.size(); ++i) {
+    const auto delta = points[i + 1] - points[i];
+    slopes[i] = delta.x > 0.0f ? delta.y / delta.x : 0.0f;
+  }
+
+  std::vector<float> tangents(pointCount);
+  tangents.front() = slopes.front();
+  tangents.back() = slopes.back();
+  for (size_t i = 1; i < pointCount - 1; ++i) {
+    tangents[i] = slopes[i - 1] * slopes[i] <= 0.0f ? 0.0f : (slopes[i - 1] + slopes[i]) * 0.5f;
+  }
+
+  for (size_t i = 0; i < slopes.size(); ++i) {
+    if (slopes[i] == 0.0f) {
+      tangents[i] = tangents[i + 1] = 0.0f;
+      continue;
+    }
+
+    const auto alpha = tangents[i] / slopes[i];
+    const auto beta = tangents[i + 1] / slopes[i];
+    const auto length = alpha * alpha + beta * beta;
+    if (length > 9.0f) {
+      const auto tau = 3.0f / std::sqrt(length);
+      tangents[i] = tau * alpha * slopes[i];
+      tangents[i + 1] = tau * beta * slopes[i];
+    }
+  }
+
+  return tangents;
+}
+
+static float evaluateMonotoneCubic(const std::vector<glm::vec2> &points, const std::vector<float> &tangents,
+                                   const float x) {
+  if (x <= points.front().x) {
+    return points.front().y;
+  }
+  if (x >= points.back().x) {
+    return points.back().y;
+  }
+
+  const auto segmentEnd = std::upper_bound(points.begin(), points.end(), x,
+                                           [](const float x, const glm::vec2 &point) { return x < point.x; });
+  const auto segment = size_t(segmentEnd - points.begin()) - 1;
+  const auto &p0 = points[segment];
+  const auto &p1 = points[segment + 1];
+  const auto h = p1.x - p0.x;
+  const auto t = (x - p0.x) / h;
+  const auto t2 = t * t;
+  const auto t3 = t2 * t;
+
+  return (2.0f * t3 - 3.0f * t2 + 1.0f) * p0.y + (t3 - 2.0f * t2 + t) * h * tangents[segment] +
+         (-2.0f * t3 + 3.0f * t2) * p1.y + (t3 - t2) * h * tangents[segment + 1];
+}
+
+HeightCurveTable bakeHeightCurve(const HeightCurve &heightCurve) {
+  HeightCurveTable heightCurveTable(kHeightCurveTableSize);
+
+  const auto getX = [](const int i) { return i / float(kHeightCurveTableSize - 1); };
+
+  if (heightCurve.type == HEIGHT_CURVE_TYPE::POLYNOMIAL) {
+    for (int i = 0; i < kHeightCurveTableSize; ++i) {
+      heightCurveTable[i] = evaluatePolynomial(heightCurve.coefficients, getX(i));
+    }
+  } else {
+    assert(heightCurve.controlPoints.size() >= 2);
+
+    auto points = heightCurve.controlPoints;
+    std::sort(points.begin(), points.end(), [](const glm::vec2 &a, const glm::vec2 &b) { return a.x < b.x; });
+    const auto tangents = getMonotoneTangents(points);
+
+    for (int i = 0; i < kHeightCurveTableSize; ++i) {
+      heightCurveTable[i] = evaluateMonotoneCubic(points, tangents, getX(i));
+    }
+  }
+
+  for (auto &value : heightCurveTable) {
+    value = glm::clamp(value, 0.0f, 1.0f);
+  }
+
+  return heightCurveTable;
+}
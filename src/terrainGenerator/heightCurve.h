@@ -0,0 +1,26 @@
+#pragma once
+#include <vector>
+
+#include "glm/glm.hpp"
+
+enum class HEIGHT_CURVE_TYPE { POLYNOMIAL, CONTROL_POINTS };
+
+// Remaps normalised noise heights in [0, 1]. The curve is baked in to a lookup table before the
+// post-process, so the cost per texel is the same however complex the curve is.
+struct HeightCurve {
+  HEIGHT_CURVE_TYPE type = HEIGHT_CURVE_TYPE::POLYNOMIAL;
+  // c0 + c1 * x + c2 * x^2 + ..., defaults to the original terrain curve
+  std::vector<float> coefficients = {-0.000937f, -0.72331f, 2.35243f, 0.0f, -0.635179f};
+  // Both x and y in [0, 1], in any order. Interpolated with a monotone cubic, so monotone points give a
+  // monotone curve without overshoot.
+  std::vector<glm::vec2> controlPoints = {glm::vec2(0.0f), glm::vec2(1.0f)};
+
+  bool operator==(const HeightCurve &other) const = default;
+};
+
+constexpr int kHeightCurveTableSize = 4096;
+
+// kHeightCurveTableSize evenly spaced samples of the curve over [0, 1], clamped to [0, 1]
+using HeightCurveTable = std::vector<float>;
+
+HeightCurveTable bakeHeightCurve(const HeightCurve &heightCurve);
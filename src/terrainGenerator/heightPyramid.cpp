@@ -0,0 +1,368 @@
+#include "heightPyramid.h"
+
+#include "linearArena.h"
+#include "profiler.h"
+#include "threadPool.h"
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cmath>
+#include <limits>
+
+static constexpr auto kEmptyRange =
+    glm::vec2(std::numeric_limits<float>::max(), std::numeric_limits<float>::lowest());
+
+// Levels with fewer cells are built on the calling thread, waking the pool would take longer
+static constexpr int kMinParallelCellCount = 64 * 64;
+
+static glm::vec2 addRange(const glm::vec2 &range, const glm::vec2 &otherRange) {
+  return glm::vec2(std::min(range.x, otherRange.x), std::max(range.y, otherRange.y));
+}
+
+// Cells needed to cover the quads between texelCount texels, at least one
+static int getCellCount(const int texelCount, const int cellSize) {
+  return std::max(1, (texelCount - 1 + cellSize - 1) / cellSize);
+}
+
+void HeightPyramid::build(const HeightfieldView &heightfield, ThreadPool *threadPool, const int cellSize) {
+  assert(!heightfield.empty() && cellSize > 0 && (cellSize & (cellSize - 1)) == 0);
+  PROFILE_ZONE("Build height pyramid");
+
+  threadPool = threadPool != nullptr ? threadPool : &getThreadPool();
+
+  _width = heightfield.width();
+  _height = heightfield.height();
+  _cellSize = cellSize;
+  _levels.clear();
+
+  auto levelWidth = getCellCount(_width, cellSize);
+  auto levelHeight = getCellCount(_height, cellSize);
+  while (true) {
+    _levels.push_back({levelWidth, levelHeight, std::vector<glm::vec2>(size_t(levelWidth) * levelHeight)});
+    if (levelWidth == 1 && levelHeight == 1) {
+      break;
+    }
+    levelWidth = (levelWidth + 1) / 2;
+    levelHeight = (levelHeight + 1) / 2;
+  }
+
+  // Every level is split in to bands of rows, a few per thread to even out the load
+  const auto buildLevel = [&](const int level, const std::function<void(const CellRect &)> &buildCells) {
+    const auto &pyramidLevel = _levels[level];
+    if (pyramidLevel.width * pyramidLevel.height < kMinParallelCellCount) {
+      buildCells({0, 0, pyramidLevel.width, pyramidLevel.height});
+      return;
+    }
+
+    const auto bandCount = std::min(pyramidLevel.height, int(threadPool->threadCount()) * 4);
+    threadPool->parallelFor(bandCount, [&](const int band) {
+      buildCells({0, band * pyramidLevel.height / bandCount, pyramidLevel.width,
+                  (band + 1) * pyramidLevel.height / bandCount});
+    });
+  };
+
+  buildLevel(0, [&](const CellRect &cells) { buildBaseCells(heightfield, cells); });
+  for (int level = 1; level < levelCount(); ++level) {
+    buildLevel(level, [&](const CellRect &cells) { buildParentCells(level, cells); });
+  }
+}
+
+void HeightPyramid::update(const HeightfieldView &heightfield, const HeightRect &changedRect) {
+  assert(heightfield.width() == _width && heightfield.height() == _height);
+  PROFILE_ZONE("Update height pyramid");
+
+  const auto firstX = std::max(changedRect.x, 0);
+  const auto firstY = std::max(changedRect.y, 0);
+  const auto lastX = std::min(changedRect.x + changedRect.width, _width) - 1;
+  const auto lastY = std::min(changedRect.y + changedRect.height, _height) - 1;
+  if (empty() || firstX > lastX || firstY > lastY) {
+    return;
+  }
+
+  // Texels on a cell border belong to the cells on both sides
+  const auto &baseLevel = _levels[0];
+  CellRect cells = {std::min(firstX > 0 ? (firstX - 1) / _cellSize : 0, baseLevel.width - 1),
+                    std::min(firstY > 0 ? (firstY - 1) / _cellSize : 0, baseLevel.height - 1),
+                    std::min(lastX / _cellSize + 1, baseLevel.width),
+                    std::min(lastY / _cellSize + 1, baseLevel.height)};
+  buildBaseCells(heightfield, cells);
+
+  for (int level = 1; level < levelCount(); ++level) {
+    cells = {cells.firstX / 2, cells.firstY / 2, (cells.lastX - 1) / 2 + 1, (cells.lastY - 1) / 2 + 1};
+    buildParentCells(level, cells);
+  }
+}
+
+void HeightPyramid::buildBaseCells(const HeightfieldView &heightfield, const CellRect &cells) {
+  auto &baseLevel = _levels[0];
+
+  const auto firstTexelX = cells.firstX * _cellSize;
+  const auto lastTexelX = std::min(cells.lastX * _cellSize, _width - 1);
+  const auto columnCount = lastTexelX - firstTexelX + 1;
+  ScratchArenaScope scratch;
+  const auto columnMin = scratch.arena().allocateArray<float>(size_t(columnCount));
+  const auto columnMax = scratch.arena().allocateArray<float>(size_t(columnCount));
+
+  for (int y = cells.firstY; y < cells.lastY; ++y) {
+    // Min/max of every texel column over the rows of the cells first, a loop that vectorises, then the
+    // columns of each cell
+    const auto firstRow = y * _cellSize;
+    const auto lastRow = std::min(firstRow + _cellSize, _height - 1);
+    const auto row = heightfield.row(firstRow).data() + firstTexelX;
+    std::copy_n(row, columnCount, columnMin.data());
+    std::copy_n(row, columnCount, columnMax.data());
+    for (int i = firstRow + 1; i <= lastRow; ++i) {
+      const auto nextRow = heightfield.row(i).data() + firstTexelX;
+      for (int j = 0; j < columnCount; ++j) {
+        columnMin[j] = std::min(columnMin[j], nextRow[j]);
+        columnMax[j] = std::max(columnMax[j], nextRow[j]);
+      }
+    }
+
+    for (int x = cells.firstX; x < cells.lastX; ++x) {
+      const auto firstColumn = x * _cellSize - firstTexelX;
+      const auto lastColumn = std::min((x + 1) * _cellSize, _width - 1) - firstTexelX;
+      auto range = kEmptyRange;
+      for (int j = firstColumn; j <= lastColumn; ++j) {
+        range = glm::vec2(std::min(range.x, columnMin[j]), std::max(range.y, columnMax[j]));
+      }
+      baseLevel.ranges[size_t(y) * baseLevel.width + x] = range;
+    }
+  }
+}
+
+void HeightPyramid::buildParentCells(const int level, const CellRect &cells) {
+  const auto &childLevel = _levels[level - 1];
+  auto &pyramidLevel = _levels[level];
+
+  for (int y = cells.firstY; y < cells.lastY; ++y) {
+    for (int x = cells.firstX; x < cells.lastX; ++x) {
+      auto range = kEmptyRange;
+      for (int childY = 2 * y; childY < std::min(2 * y + 2, childLevel.height); ++childY) {
+        for (int childX = 2 * x; childX < std::min(2 * x + 2, childLevel.width); ++childX) {
+          range = addRange(range, childLevel.ranges[size_t(childY) * childLevel.width + childX]);
+        }
+      }
+      pyramidLevel.ranges[size_t(y) * pyramidLevel.width + x] = range;
+    }
+  }
+}
+
+HeightRect HeightPyramid::cellRect(const int level, const int x, const int y) const {
+  const auto &baseLevel = _levels[0];
+  const auto firstTexelX = (x << level) * _cellSize;
+  const auto firstTexelY = (y << level) * _cellSize;
+  const auto lastTexelX = std::min(std::min((x + 1) << level, baseLevel.width) * _cellSize, _width - 1);
+  const auto lastTexelY = std::min(std::min((y + 1) << level, baseLevel.height) * _cellSize, _height - 1);
+  return {firstTexelX, firstTexelY, lastTexelX - firstTexelX + 1, lastTexelY - firstTexelY + 1};
+}
+
+// Fewest level 0 cells containing the clipped, non-empty rect
+HeightPyramid::CellRect HeightPyramid::getCoveringCells(const HeightRect &rect) const {
+  const auto &baseLevel = _levels[0];
+  const auto firstX = std::min(rect.x / _cellSize, baseLevel.width - 1);
+  const auto firstY = std::min(rect.y / _cellSize, baseLevel.height - 1);
+  const auto lastX = rect.x + rect.width - 1;
+  const auto lastY = rect.y + rect.height - 1;
+  return {firstX, firstY,
+          std::max(firstX + 1, std::min((lastX + _cellSize - 1) / _cellSize, baseLevel.width)),
+          std::max(firstY + 1, std::min((lastY + _cellSize - 1) / _cellSize, baseLevel.height))};
+}
+
+void HeightPyramid::addCellsRange(const int level, const int x, const int y, const CellRect &cells,
+                                  glm::vec2 *range) const {
+  const auto firstX = x << level;
+  const auto firstY = y << level;
+  const auto lastX = (x + 1) << level;
+  const auto lastY = (y + 1) << level;
+  if (lastX <= cells.firstX || firstX >= cells.lastX || lastY <= cells.firstY || firstY >= cells.lastY) {
+    return;
+  }
+
+  const auto &baseLevel = _levels[0];
+  if (firstX >= cells.firstX && std::min(lastX, baseLevel.width) <= cells.lastX && firstY >= cells.firstY &&
+      std::min(lastY, baseLevel.height) <= cells.lastY) {
+    *range = addRange(*range, cellRange(level, x, y));
+    return;
+  }
+
+  const auto &childLevel = _levels[level - 1];
+  for (int childY = 2 * y; childY < std::min(2 * y + 2, childLevel.height); ++childY) {
+    for (int childX = 2 * x; childX < std::min(2 * x + 2, childLevel.width); ++childX) {
+      addCellsRange(level - 1, childX, childY, cells, range);
+    }
+  }
+}
+
+glm::vec2 HeightPyramid::getHeightRange(const HeightRect &rect, const HeightfieldView *heightfield) const {
+  const auto firstX = std::max(rect.x, 0);
+  const auto firstY = std::max(rect.y, 0);
+  const auto lastX = std::min(rect.x + rect.width, _width) - 1;
+  const auto lastY = std::min(rect.y + rect.height, _height) - 1;
+  if (empty() || firstX > lastX || firstY > lastY) {
+    return kEmptyRange;
+  }
+
+  const auto topLevel = levelCount() - 1;
+  auto range = kEmptyRange;
+  if (heightfield == nullptr) {
+    const auto cells = getCoveringCells({firstX, firstY, lastX - firstX + 1, lastY - firstY + 1});
+    addCellsRange(topLevel, 0, 0, cells, &range);
+    return range;
+  }
+
+  // Cells entirely inside the rect come from the pyramid, only the texels around them are read. The last
+  // cell of a row or column ends at the last texel.
+  const auto &baseLevel = _levels[0];
+  const auto getInnerCellEnd = [&](const int last, const int size, const int cellCount) {
+    return last == size - 1 ? cellCount : std::min(last >= _cellSize ? (last - _cellSize) / _cellSize + 1 : 0,
+                                                   cellCount);
+  };
+  CellRect innerCells = {(firstX + _cellSize - 1) / _cellSize, (firstY + _cellSize - 1) / _cellSize,
+                         getInnerCellEnd(lastX, _width, baseLevel.width),
+                         getInnerCellEnd(lastY, _height, baseLevel.height)};
+
+  auto innerFirstX = lastX + 1;
+  auto innerLastX = lastX;
+  auto innerFirstY = lastY + 1;
+  auto innerLastY = lastY;
+  if (innerCells.firstX < innerCells.lastX && innerCells.firstY < innerCells.lastY) {
+    addCellsRange(topLevel, 0, 0, innerCells, &range);
+    innerFirstX = innerCells.firstX * _cellSize;
+    innerLastX = std::min(innerCells.lastX * _cellSize, _width - 1);
+    innerFirstY = innerCells.firstY * _cellSize;
+    innerLastY = std::min(innerCells.lastY * _cellSize, _height - 1);
+  }
+
+  const auto addTexelsRange = [&](const int i, const int first, const int last) {
+    const auto row = heightfield->row(i);
+    for (int j = first; j <= last; ++j) {
+      range = glm::vec2(std::min(range.x, row[j]), std::max(range.y, row[j]));
+    }
+  };
+  for (int i = firstY; i <= lastY; ++i) {
+    if (i < innerFirstY || i > innerLastY) {
+      addTexelsRange(i, firstX, lastX);
+    } else {
+      addTexelsRange(i, firstX, innerFirstX - 1);
+      addTexelsRange(i, innerLastX + 1, lastX);
+    }
+  }
+  return range;
+}
+
+std::vector<glm::vec2> HeightPyramid::getPatchRanges(const int patchSize) const {
+  const auto patchCountX = getCellCount(_width, patchSize);
+  const auto patchCountY = getCellCount(_height, patchSize);
+
+  std::vector<glm::vec2> patchRanges;
+  patchRanges.reserve(size_t(patchCountX) * patchCountY);
+  for (int i = 0; i < patchCountY; ++i) {
+    for (int j = 0; j < patchCountX; ++j) {
+      const auto x = j * patchSize;
+      const auto y = i * patchSize;
+      patchRanges.push_back(getHeightRange(
+          {x, y, std::min(x + patchSize, _width - 1) - x + 1, std::min(y + patchSize, _height - 1) - y + 1}));
+    }
+  }
+  return patchRanges;
+}
+
+bool HeightPyramid::intersectCell(const int level, const int x, const int y, const glm::vec3 &origin,
+                                  const glm::vec3 &inverseDirection, const float maxT, float *enterT,
+                                  float *exitT) const {
+  const auto rect = cellRect(level, x, y);
+  const auto range = cellRange(level, x, y);
+  const auto boxMin = glm::vec3(float(rect.x), float(rect.y), range.x);
+  const auto boxMax = glm::vec3(float(rect.x + rect.width - 1), float(rect.y + rect.height - 1), range.y);
+
+  *enterT = 0.0f;
+  *exitT = maxT;
+  for (int axis = 0; axis < 3; ++axis) {
+    // Parallel to the slab, 1 / 0 is infinite
+    if (std::isinf(inverseDirection[axis])) {
+      if (origin[axis] < boxMin[axis] || origin[axis] > boxMax[axis]) {
+        return false;
+      }
+      continue;
+    }
+
+    auto slabEnterT = (boxMin[axis] - origin[axis]) * inverseDirection[axis];
+    auto slabExitT = (boxMax[axis] - origin[axis]) * inverseDirection[axis];
+    if (slabEnterT > slabExitT) {
+      std::swap(slabEnterT, slabExitT);
+    }
+    *enterT = std::max(*enterT, slabEnterT);
+    *exitT = std::min(*exitT, slabExitT);
+  }
+  return *enterT <= *exitT;
+}
+
+bool HeightPyramid::traverseCell(const int level, const int x, const int y, const glm::vec3 &origin,
+                                 const glm::vec3 &inverseDirection, const float maxT, const float enterT,
+                                 const float exitT, const CellVisitor &visit) const {
+  if (level == 0) {
+    return visit(x, y, enterT, exitT);
+  }
+
+  struct ChildHit {
+    int x, y;
+    float enterT, exitT;
+  };
+  std::array<ChildHit, 4> childHits;
+  int childHitCount = 0;
+
+  const auto &childLevel = _levels[level - 1];
+  for (int childY = 2 * y; childY < std::min(2 * y + 2, childLevel.height); ++childY) {
+    for (int childX = 2 * x; childX < std::min(2 * x + 2, childLevel.width); ++childX) {
+      auto &childHit = childHits[childHitCount];
+      if (intersectCell(level - 1, childX, childY, origin, inverseDirection, maxT, &childHit.enterT,
+                        &childHit.exitT)) {
+        childHit.x = childX;
+        childHit.y = childY;
+        ++childHitCount;
+      }
+    }
+  }
+
+  // Children do not overlap apart from their borders, so the order they are entered is front to back
+  std::sort(childHits.begin(), childHits.begin() + childHitCount,
+            [](const ChildHit &a, const ChildHit &b) { return a.enterT < b.enterT; });
+  for (int i = 0; i < childHitCount; ++i) {
+    const auto &childHit = childHits[i];
+    if (!traverseCell(level - 1, childHit.x, childHit.y, origin, inverseDirection, maxT, childHit.enterT,
+                      childHit.exitT, visit)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+void HeightPyramid::traverseRay(const glm::vec3 &origin, const glm::vec3 &direction, const float maxT,
+                                const CellVisitor &visit) const {
+  if (empty()) {
+    return;
+  }
+
+  const auto inverseDirection = 1.0f / direction;
+  const auto topLevel = levelCount() - 1;
+  float enterT, exitT;
+  if (intersectCell(topLevel, 0, 0, origin, inverseDirection, maxT, &enterT, &exitT)) {
+    traverseCell(topLevel, 0, 0, origin, inverseDirection, maxT, enterT, exitT, visit);
+  }
+}
+
+bool HeightPyramid::getRayHitBounds(const glm::vec3 &origin, const glm::vec3 &direction, const float maxT,
+                                    float *firstT, float *lastT) const {
+  bool isHit = false;
+  traverseRay(origin, direction, maxT, [&](const int, const int, const float enterT, const float exitT) {
+    if (!isHit) {
+      *firstT = enterT;
+      *lastT = exitT;
+      isHit = true;
+    }
+    *lastT = std::max(*lastT, exitT);
+    return true;
+  });
+  return isHit;
+}
@@ -0,0 +1,102 @@
+#pragma once
+
+#include <functional>
+#include <vector>
+
+#include "heightfield.h"
+
+#include "glm/glm.hpp"
+
+class ThreadPool;
+
+// Min/max quadtree over a heightfield. Each cell of level 0 holds the min/max of the cellSize + 1 texels
+// in each direction from its corner texel, so it bounds the bilinear surface over its cellSize^2 quads.
+// Every coarser level halves the cell count in each direction (rounding up) until a single cell is left.
+// Heights are in heightfield units and x, y in texels, with texel (j, i) at (j, i).
+class HeightPyramid {
+public:
+  static constexpr int kDefaultCellSize = 8;
+
+  HeightPyramid() = default;
+  HeightPyramid(HeightPyramid &&other) noexcept = default;
+  HeightPyramid &operator=(HeightPyramid &&other) noexcept = default;
+  HeightPyramid(const HeightPyramid &) = delete;
+  HeightPyramid &operator=(const HeightPyramid &) = delete;
+
+  // Bottom up, every level is split in to bands of rows over the thread pool (the shared pool if not set).
+  // cellSize has to be a power of two.
+  void build(const HeightfieldView &heightfield, ThreadPool *threadPool = nullptr,
+             const int cellSize = kDefaultCellSize);
+
+  // Recomputes the cells covering changedRect of a heightfield the pyramid was built from, and their
+  // parents. The heightfield has to have the same size as before.
+  void update(const HeightfieldView &heightfield, const HeightRect &changedRect);
+
+  bool empty() const { return _levels.empty(); }
+  int width() const { return _width; } // In texels
+  int height() const { return _height; }
+  int cellSize() const { return _cellSize; }
+  int levelCount() const { return int(_levels.size()); }
+  int levelWidth(const int level) const { return _levels[level].width; } // In cells
+  int levelHeight(const int level) const { return _levels[level].height; }
+
+  // (min, max) of a cell
+  glm::vec2 cellRange(const int level, const int x, const int y) const {
+    const auto &pyramidLevel = _levels[level];
+    return pyramidLevel.ranges[size_t(y) * pyramidLevel.width + x];
+  }
+
+  // Texels covered by a cell, cells of the same level share their border texels
+  HeightRect cellRect(const int level, const int x, const int y) const;
+
+  // (min, max) of the texels in rect. With the heightfield the pyramid was built from the range is exact,
+  // without it level 0 cells partly inside the rect count whole, which overestimates by up to a cell.
+  glm::vec2 getHeightRange(const HeightRect &rect, const HeightfieldView *heightfield = nullptr) const;
+
+  // (min, max) of every patchSize^2 quad patch, row-major, patch (j, i) covering texels
+  // [j * patchSize, (j + 1) * patchSize] x [i * patchSize, (i + 1) * patchSize]. Together with the patch
+  // corners these are the bounding boxes of the patches. Conservative like getHeightRange without a
+  // heightfield, exact if patchSize is a multiple of the cell size.
+  std::vector<glm::vec2> getPatchRanges(const int patchSize) const;
+
+  // Visits the level 0 cells whose box the ray passes through front to back, with the ray parameters it
+  // enters and leaves the box. Cells entirely beyond maxT are not visited and returning false from visit
+  // stops the traversal. Whole subtrees the ray passes above or below are skipped.
+  using CellVisitor = std::function<bool(const int x, const int y, const float enterT, const float exitT)>;
+  void traverseRay(const glm::vec3 &origin, const glm::vec3 &direction, const float maxT,
+                   const CellVisitor &visit) const;
+
+  // Every hit of the ray with the surface within maxT lies in [*firstT, *lastT], the span from entering the
+  // first to leaving the last cell box the ray passes through. False if it passes through none, so it can
+  // not hit the surface.
+  bool getRayHitBounds(const glm::vec3 &origin, const glm::vec3 &direction, const float maxT, float *firstT,
+                       float *lastT) const;
+
+private:
+  struct Level {
+    int width, height;
+    std::vector<glm::vec2> ranges;
+  };
+
+  // Cells [firstX, lastX) x [firstY, lastY) of a level
+  struct CellRect {
+    int firstX, firstY;
+    int lastX, lastY;
+  };
+
+  void buildBaseCells(const HeightfieldView &heightfield, const CellRect &cells);
+  void buildParentCells(const int level, const CellRect &cells);
+  CellRect getCoveringCells(const HeightRect &rect) const;
+  void addCellsRange(const int level, const int x, const int y, const CellRect &cells,
+                     glm::vec2 *range) const;
+  bool traverseCell(const int level, const int x, const int y, const glm::vec3 &origin,
+                    const glm::vec3 &inverseDirection, const float maxT, const float enterT,
+                    const float exitT, const CellVisitor &visit) const;
+  bool intersectCell(const int level, const int x, const int y, const glm::vec3 &origin,
+                     const glm::vec3 &inverseDirection, const float maxT, float *enterT, float *exitT) const;
+
+  int _width = 0;
+  int _height = 0;
+  int _cellSize = kDefaultCellSize;
+  std::vector<Level> _levels;
+};
@@ -0,0 +1,239 @@
+#include "heightQueries.h"
+
+#include "FastNoiseSIMD/FastNoiseSIMD.h"
+#include "noiseMapGenerator.h"
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <limits>
+
+static constexpr int kBatchSize = 8;
+
+struct QuadSample {
+  float h00, h10, h01, h11;
+  float fractionX, fractionY;
+};
+
+// Mirrors sampleQuads in heightQueryKernelsAvx2.cpp. std::max(0.0f, x) returns 0 for a NaN x like
+// _mm256_max_ps(x, 0) does, so NaN positions clamp to the first texel on both paths.
+static QuadSample sampleQuad(const HeightQuerySurface &surface, const glm::vec2 &position) {
+  const auto u =
+      std::min(std::max(0.0f, position.x * surface.inverseGridPointSpacing), float(surface.width - 1));
+  const auto v =
+      std::min(std::max(0.0f, position.y * surface.inverseGridPointSpacing), float(surface.height - 1));
+  const auto j = std::min(int(u), surface.width - 2);
+  const auto i = std::min(int(v), surface.height - 2);
+
+  const auto texels = surface.heights + size_t(i) * surface.stride + j;
+  return {texels[0], texels[1], texels[surface.stride], texels[surface.stride + 1],
+          u - float(j), v - float(i)};
+}
+
+static float lerp(const float a, const float b, const float fraction) { return a + (b - a) * fraction; }
+
+float getSurfaceHeight(const HeightQuerySurface &surface, const glm::vec2 &position) {
+  const auto quad = sampleQuad(surface, position);
+  const auto top = lerp(quad.h00, quad.h10, quad.fractionX);
+  const auto bottom = lerp(quad.h01, quad.h11, quad.fractionX);
+  return lerp(top, bottom, quad.fractionY) * surface.heightScale;
+}
+
+glm::vec3 getSurfaceNormal(const HeightQuerySurface &surface, const glm::vec2 &position) {
+  const auto quad = sampleQuad(surface, position);
+  const auto slopeU = lerp(quad.h10 - quad.h00, quad.h11 - quad.h01, quad.fractionY);
+  const auto slopeV = lerp(quad.h01 - quad.h00, quad.h11 - quad.h10, quad.fractionX);
+
+  const auto x = slopeU * -surface.slopeScale;
+  const auto z = slopeV * -surface.slopeScale;
+  const auto inverseLength = 1.0f / std::sqrt(x * x + 1.0f + z * z);
+  return glm::vec3(x * inverseLength, inverseLength, z * inverseLength);
+}
+
+HeightQueries::HeightQueries(const HeightfieldView &heightfield, const HeightPyramid &heightPyramid,
+                             const float gridPointSpacing, const float heightMultiplier)
+    : _heightPyramid(&heightPyramid) {
+  assert(heightfield.width() >= 2 && heightfield.height() >= 2);
+  assert(heightPyramid.width() == heightfield.width() && heightPyramid.height() == heightfield.height());
+  assert(gridPointSpacing > 0.0f && heightMultiplier > 0.0f);
+
+  _surface = {heightfield.data(),
+              heightfield.width(),
+              heightfield.height(),
+              heightfield.stride(),
+              1.0f / gridPointSpacing,
+              heightMultiplier * gridPointSpacing,
+              heightMultiplier};
+#if defined(_M_X64) || defined(__x86_64__)
+  _useAvx2 = getNoiseSIMDLevel() >= FN_AVX2;
+#endif
+}
+
+float HeightQueries::getHeight(const glm::vec2 &position) const {
+  return getSurfaceHeight(_surface, position);
+}
+
+glm::vec3 HeightQueries::getNormal(const glm::vec2 &position) const {
+  return getSurfaceNormal(_surface, position);
+}
+
+void HeightQueries::getHeights(const glm::vec2 *positions, const int count, float *heights) const {
+  const auto batchedCount = _useAvx2 ? count / kBatchSize * kBatchSize : 0;
+  if (batchedCount > 0) {
+    getSurfaceHeightsAvx2(_surface, positions, batchedCount, heights);
+  }
+  for (int k = batchedCount; k < count; ++k) {
+    heights[k] = getSurfaceHeight(_surface, positions[k]);
+  }
+}
+
+void HeightQueries::getNormals(const glm::vec2 *positions, const int count, glm::vec3 *normals) const {
+  const auto batchedCount = _useAvx2 ? count / kBatchSize * kBatchSize : 0;
+  if (batchedCount > 0) {
+    getSurfaceNormalsAvx2(_surface, positions, batchedCount, normals);
+  }
+  for (int k = batchedCount; k < count; ++k) {
+    normals[k] = getSurfaceNormal(_surface, positions[k]);
+  }
+}
+
+bool HeightQueries::castRay(const glm::vec3 &origin, const glm::vec3 &direction, const float maxT,
+                            TerrainRayHit *hit) const {
+  // In the pyramid's space of (column, row, texel height) t stays the same
+  const auto toTexels = glm::vec3(_surface.inverseGridPointSpacing, _surface.inverseGridPointSpacing,
+                                  1.0f / _surface.heightScale);
+  const auto texelOrigin = glm::vec3(origin.x, origin.z, origin.y) * toTexels;
+  const auto texelDirection = glm::vec3(direction.x, direction.z, direction.y) * toTexels;
+
+  // Cells come front to back, so the first hit is the nearest
+  auto hitT = -1.0f;
+  const auto visitCell = [&](const int x, const int y, const float enterT, const float exitT) {
+    return !intersectCell(x, y, texelOrigin, texelDirection, enterT, exitT, &hitT);
+  };
+  _heightPyramid->traverseRay(texelOrigin, texelDirection, maxT, visitCell);
+
+  hit->t = hitT;
+  if (hitT < 0.0f) {
+    return false;
+  }
+  hit->position = origin + direction * hitT;
+  hit->normal = getNormal(glm::vec2(hit->position.x, hit->position.z));
+  return true;
+}
+
+int HeightQueries::castRays(const TerrainRay *rays, const int count, TerrainRayHit *hits) const {
+  int hitCount = 0;
+  for (int k = 0; k < count; ++k) {
+    hitCount += castRay(rays[k].origin, rays[k].direction, rays[k].maxT, &hits[k]) ? 1 : 0;
+  }
+  return hitCount;
+}
+
+// Steps through the quads of a level 0 cell in the order the ray crosses them
+bool HeightQueries::intersectCell(const int cellX, const int cellY, const glm::vec3 &origin,
+                                  const glm::vec3 &direction, const float enterT, const float exitT,
+                                  float *hitT) const {
+  const auto cellRect = _heightPyramid->cellRect(0, cellX, cellY);
+  const auto firstX = cellRect.x;
+  const auto firstY = cellRect.y;
+  const auto lastX = cellRect.x + cellRect.width - 2;
+  const auto lastY = cellRect.y + cellRect.height - 2;
+
+  const auto enterPosition = origin + direction * enterT;
+  auto x = std::clamp(int(std::floor(enterPosition.x)), firstX, lastX);
+  auto y = std::clamp(int(std::floor(enterPosition.y)), firstY, lastY);
+  const auto stepX = direction.x > 0.0f ? 1 : -1;
+  const auto stepY = direction.y > 0.0f ? 1 : -1;
+
+  const auto getQuadExitT = [](const int quad, const float origin, const float direction) {
+    if (direction == 0.0f) {
+      return std::numeric_limits<float>::max();
+    }
+    return (float(direction > 0.0f ? quad + 1 : quad) - origin) / direction;
+  };
+
+  auto quadEnterT = enterT;
+  while (true) {
+    const auto quadExitX = getQuadExitT(x, origin.x, direction.x);
+    const auto quadExitY = getQuadExitT(y, origin.y, direction.y);
+    const auto quadExitT = std::min(std::min(quadExitX, quadExitY), exitT);
+    if (intersectQuad(x, y, origin, direction, quadEnterT, std::max(quadExitT, quadEnterT), hitT)) {
+      return true;
+    }
+    if (quadExitT >= exitT) {
+      break;
+    }
+
+    if (quadExitX <= quadExitY) {
+      x += stepX;
+    }
+    if (quadExitY <= quadExitX) {
+      y += stepY;
+    }
+    if (x < firstX || x > lastX || y < firstY || y > lastY) {
+      break;
+    }
+    quadEnterT = std::max(quadEnterT, quadExitT);
+  }
+
+  // A ray leaving the box through its bottom went below the surface in this cell, rounding can only have
+  // pushed a grazing hit just past the quads. The exit is computed like the pyramid does.
+  if (direction.z < 0.0f) {
+    const auto bottomExitT =
+        (_heightPyramid->cellRange(0, cellX, cellY).x - origin.z) * (1.0f / direction.z);
+    if (bottomExitT <= exitT) {
+      *hitT = exitT;
+      return true;
+    }
+  }
+  return false;
+}
+
+// Along the ray the bilinear height of a quad is quadratic in t, so the hit is the first root of
+// (ray height - surface height) within the quad
+bool HeightQueries::intersectQuad(const int x, const int y, const glm::vec3 &origin,
+                                  const glm::vec3 &direction, const float enterT, const float exitT,
+                                  float *hitT) const {
+  const auto texels = _surface.heights + size_t(y) * _surface.stride + x;
+  const auto h00 = texels[0];
+  const auto slopeX = texels[1] - h00;
+  const auto slopeY = texels[_surface.stride] - h00;
+  const auto twist = h00 - texels[1] - texels[_surface.stride] + texels[_surface.stride + 1];
+
+  // Relative to where the ray enters the quad, s = t - enterT
+  const auto fractionX = origin.x + direction.x * enterT - float(x);
+  const auto fractionY = origin.y + direction.y * enterT - float(y);
+  const auto rayHeight = origin.z + direction.z * enterT;
+
+  const auto c0 = rayHeight - (h00 + slopeX * fractionX + slopeY * fractionY + twist * fractionX * fractionY);
+  const auto c1 = direction.z - (slopeX * direction.x + slopeY * direction.y +
+                                 twist * (fractionX * direction.y + fractionY * direction.x));
+  const auto c2 = -twist * direction.x * direction.y;
+  if (c0 <= 0.0f) {
+    *hitT = enterT;
+    return true;
+  }
+
+  float s;
+  if (c2 == 0.0f) {
+    if (c1 >= 0.0f) {
+      return false;
+    }
+    s = -c0 / c1;
+  } else {
+    const auto discriminant = c1 * c1 - 4.0f * c2 * c0;
+    if (discriminant < 0.0f) {
+      return false;
+    }
+    // Numerically stable roots, q is never 0 as c0 > 0
+    const auto q = -0.5f * (c1 + std::copysign(std::sqrt(discriminant), c1));
+    const auto root1 = std::min(q / c2, c0 / q);
+    const auto root2 = std::max(q / c2, c0 / q);
+    s = root1 >= 0.0f ? root1 : root2;
+  }
+
+  if (s < 0.0f || s > exitT - enterT) {
+    return false;
+  }
+  *hitT = enterT + s;
+  return true;
+}
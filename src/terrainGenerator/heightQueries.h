@@ -0,0 +1,58 @@
+#pragma once
+
+#include "heightPyramid.h"
+#include "heightQueryKernels.h"
+#include "heightfield.h"
+
+#include "glm/glm.hpp"
+
+struct TerrainRay {
+  glm::vec3 origin;
+  glm::vec3 direction;
+  float maxT;
+};
+
+struct TerrainRayHit {
+  float t = -1.0f; // Hit at origin + t * direction, negative if the ray missed
+  glm::vec3 position;
+  glm::vec3 normal;
+};
+
+// Height, normal and ray queries against the surface the terrain shaders displace: the heightfield
+// interpolated bilinearly, texel (j, i) at world (x, z) = (j, i) * gridPointSpacing and its height times
+// heightMultiplier * gridPointSpacing. Positions outside the map are clamped to its edge.
+//
+// Queries only read the heightfield and the pyramid, so any number of threads can run them at once as long
+// as neither changes.
+class HeightQueries {
+public:
+  // heightPyramid has to be built from heightfield, which is at least 2x2 texels. Both are not copied.
+  HeightQueries(const HeightfieldView &heightfield, const HeightPyramid &heightPyramid,
+                const float gridPointSpacing, const float heightMultiplier);
+
+  // position is world (x, z)
+  float getHeight(const glm::vec2 &position) const;
+  glm::vec3 getNormal(const glm::vec2 &position) const;
+
+  // First hit within maxT. The ray walks the pyramid down to the cells it can hit and only tests the quads
+  // of those. The terrain counts as solid, so a ray starting below the surface hits at its start and one
+  // entering the map from the side below its edge hits where it enters.
+  bool castRay(const glm::vec3 &origin, const glm::vec3 &direction, const float maxT,
+               TerrainRayHit *hit) const;
+
+  // Batched, 8 per step if the CPU supports AVX2, with the same results as one at a time
+  void getHeights(const glm::vec2 *positions, const int count, float *heights) const;
+  void getNormals(const glm::vec2 *positions, const int count, glm::vec3 *normals) const;
+  // Returns the number of rays that hit
+  int castRays(const TerrainRay *rays, const int count, TerrainRayHit *hits) const;
+
+private:
+  bool intersectCell(const int cellX, const int cellY, const glm::vec3 &origin, const glm::vec3 &direction,
+                     const float enterT, const float exitT, float *hitT) const;
+  bool intersectQuad(const int x, const int y, const glm::vec3 &origin, const glm::vec3 &direction,
+                     const float enterT, const float exitT, float *hitT) const;
+
+  HeightQuerySurface _surface;
+  const HeightPyramid *_heightPyramid;
+  bool _useAvx2 = false;
+};
@@ -0,0 +1,25 @@
+#pragma once
+
+#include "glm/glm.hpp"
+
+// The terrain surface as the shaders displace it, for the height query kernels (see HeightQueries). Texel
+// (j, i) is at world (x, z) = (j, i) * gridPointSpacing and heights are interpolated bilinearly in between.
+struct HeightQuerySurface {
+  const float *heights;
+  int width, height; // At least 2 texels each
+  int stride;
+  float inverseGridPointSpacing;
+  float heightScale; // heightMultiplier * gridPointSpacing, texel height to world height
+  float slopeScale;  // heightMultiplier, texel height difference per texel to world slope
+};
+
+// One world (x, z) position at a time, the reference the kernels below match
+float getSurfaceHeight(const HeightQuerySurface &surface, const glm::vec2 &position);
+glm::vec3 getSurfaceNormal(const HeightQuerySurface &surface, const glm::vec2 &position);
+
+// 8 world (x, z) positions per step with AVX2 gathers, count must be a multiple of 8. Only call when the
+// CPU supports AVX2. The results match the scalar queries bit for bit.
+void getSurfaceHeightsAvx2(const HeightQuerySurface &surface, const glm::vec2 *positions, const int count,
+                           float *heights);
+void getSurfaceNormalsAvx2(const HeightQuerySurface &surface, const glm::vec2 *positions, const int count,
+                           glm::vec3 *normals);
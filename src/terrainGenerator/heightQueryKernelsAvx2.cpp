@@ -0,0 +1,98 @@
+#include "heightQueryKernels.h"
+
+#include <cassert>
+
+// Compiled with AVX2 enabled (see CMakeLists.txt), nothing in here may run before the CPU was checked
+#if defined(_M_X64) || defined(__x86_64__)
+#include <immintrin.h>
+
+// The quad under each of 8 positions, same operations in the same order as the scalar queries and no FMA
+struct QuadSamples {
+  __m256 h00, h10, h01, h11;
+  __m256 fractionX, fractionY;
+};
+
+static QuadSamples sampleQuads(const HeightQuerySurface &surface, const glm::vec2 *positions) {
+  // Deinterleave in to x and z, the shuffle leaves the 64-bit pairs in the order 0 2 1 3
+  const auto first = _mm256_loadu_ps(&positions[0].x);
+  const auto second = _mm256_loadu_ps(&positions[4].x);
+  const auto x = _mm256_castpd_ps(_mm256_permute4x64_pd(
+      _mm256_castps_pd(_mm256_shuffle_ps(first, second, _MM_SHUFFLE(2, 0, 2, 0))), _MM_SHUFFLE(3, 1, 2, 0)));
+  const auto z = _mm256_castpd_ps(_mm256_permute4x64_pd(
+      _mm256_castps_pd(_mm256_shuffle_ps(first, second, _MM_SHUFFLE(3, 1, 3, 1))), _MM_SHUFFLE(3, 1, 2, 0)));
+
+  const auto zero = _mm256_setzero_ps();
+  const auto inverseGridPointSpacing = _mm256_set1_ps(surface.inverseGridPointSpacing);
+  const auto u = _mm256_min_ps(_mm256_max_ps(_mm256_mul_ps(x, inverseGridPointSpacing), zero),
+                               _mm256_set1_ps(float(surface.width - 1)));
+  const auto v = _mm256_min_ps(_mm256_max_ps(_mm256_mul_ps(z, inverseGridPointSpacing), zero),
+                               _mm256_set1_ps(float(surface.height - 1)));
+  const auto j = _mm256_min_epi32(_mm256_cvttps_epi32(u), _mm256_set1_epi32(surface.width - 2));
+  const auto i = _mm256_min_epi32(_mm256_cvttps_epi32(v), _mm256_set1_epi32(surface.height - 2));
+  const auto index = _mm256_add_epi32(_mm256_mullo_epi32(i, _mm256_set1_epi32(surface.stride)), j);
+
+  const auto heights = surface.heights;
+  return {_mm256_i32gather_ps(heights, index, 4),
+          _mm256_i32gather_ps(heights + 1, index, 4),
+          _mm256_i32gather_ps(heights + surface.stride, index, 4),
+          _mm256_i32gather_ps(heights + surface.stride + 1, index, 4),
+          _mm256_sub_ps(u, _mm256_cvtepi32_ps(j)),
+          _mm256_sub_ps(v, _mm256_cvtepi32_ps(i))};
+}
+
+static __m256 lerp(const __m256 a, const __m256 b, const __m256 fraction) {
+  return _mm256_add_ps(a, _mm256_mul_ps(_mm256_sub_ps(b, a), fraction));
+}
+
+void getSurfaceHeightsAvx2(const HeightQuerySurface &surface, const glm::vec2 *positions, const int count,
+                           float *heights) {
+  assert(count % 8 == 0);
+
+  const auto heightScale = _mm256_set1_ps(surface.heightScale);
+  for (int k = 0; k < count; k += 8) {
+    const auto quad = sampleQuads(surface, positions + k);
+    const auto top = lerp(quad.h00, quad.h10, quad.fractionX);
+    const auto bottom = lerp(quad.h01, quad.h11, quad.fractionX);
+    _mm256_storeu_ps(heights + k, _mm256_mul_ps(lerp(top, bottom, quad.fractionY), heightScale));
+  }
+}
+
+void getSurfaceNormalsAvx2(const HeightQuerySurface &surface, const glm::vec2 *positions, const int count,
+                           glm::vec3 *normals) {
+  assert(count % 8 == 0);
+
+  const auto one = _mm256_set1_ps(1.0f);
+  const auto negativeSlopeScale = _mm256_set1_ps(-surface.slopeScale);
+  alignas(32) float normalX[8], normalY[8], normalZ[8];
+  for (int k = 0; k < count; k += 8) {
+    const auto quad = sampleQuads(surface, positions + k);
+    const auto slopeU = lerp(_mm256_sub_ps(quad.h10, quad.h00), _mm256_sub_ps(quad.h11, quad.h01),
+                             quad.fractionY);
+    const auto slopeV = lerp(_mm256_sub_ps(quad.h01, quad.h00), _mm256_sub_ps(quad.h11, quad.h10),
+                             quad.fractionX);
+
+    const auto x = _mm256_mul_ps(slopeU, negativeSlopeScale);
+    const auto z = _mm256_mul_ps(slopeV, negativeSlopeScale);
+    const auto lengthSquared = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(x, x), one), _mm256_mul_ps(z, z));
+    const auto inverseLength = _mm256_div_ps(one, _mm256_sqrt_ps(lengthSquared));
+    _mm256_store_ps(normalX, _mm256_mul_ps(x, inverseLength));
+    _mm256_store_ps(normalY, inverseLength);
+    _mm256_store_ps(normalZ, _mm256_mul_ps(z, inverseLength));
+
+    for (int l = 0; l < 8; ++l) {
+      normals[k + l] = glm::vec3(normalX[l], normalY[l], normalZ[l]);
+    }
+  }
+}
+
+#else
+
+void getSurfaceHeightsAvx2(const HeightQuerySurface &, const glm::vec2 *, const int, float *) {
+  assert(false);
+}
+
+void getSurfaceNormalsAvx2(const HeightQuerySurface &, const glm::vec2 *, const int, glm::vec3 *) {
+  assert(false);
+}
+
+#endif
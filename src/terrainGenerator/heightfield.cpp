@@ -0,0 +1,29 @@
+#include "heightfield.h"
+
+#include <cassert>
+#include <cstring>
+#include <new>
+
+void Heightfield::AlignedDeleter::operator()(float *data) const {
+  ::operator delete[](data, std::align_val_t(kAlignment));
+}
+
+Heightfield::Heightfield(const int width, const int height)
+    : _width(width), _height(height),
+      _stride((width + kStrideAlignment - 1) / kStrideAlignment * kStrideAlignment) {
+  assert(width > 0 && height > 0);
+
+  const auto size = std::size_t(_stride) * std::size_t(_height);
+  _data.reset(static_cast<float *>(::operator new[](size * sizeof(float), std::align_val_t(kAlignment))));
+  std::memset(_data.get(), 0, size * sizeof(float));
+}
+
+Heightfield Heightfield::clone() const {
+  if (empty()) {
+    return {};
+  }
+
+  Heightfield heightfield(_width, _height);
+  std::memcpy(heightfield.data(), data(), sizeInBytes());
+  return heightfield;
+}
@@ -0,0 +1,93 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <span>
+
+// Row-major 2D float map stored in a single 64-byte aligned allocation. Every row starts on a 64-byte
+// boundary (stride is padded to a multiple of 16 floats) so whole SIMD vectors can be loaded and stored
+// per row, even past the last texel of a row.
+class Heightfield {
+public:
+  static constexpr std::size_t kAlignment = 64;
+  static constexpr int kStrideAlignment = int(kAlignment / sizeof(float));
+
+  Heightfield() = default;
+  Heightfield(const int width, const int height);
+
+  Heightfield(Heightfield &&other) noexcept = default;
+  Heightfield &operator=(Heightfield &&other) noexcept = default;
+  Heightfield(const Heightfield &) = delete;
+  Heightfield &operator=(const Heightfield &) = delete;
+
+  int width() const { return _width; }
+  int height() const { return _height; }
+  int stride() const { return _stride; } // In floats
+  bool empty() const { return _data == nullptr; }
+  std::size_t sizeInBytes() const { return std::size_t(_stride) * std::size_t(_height) * sizeof(float); }
+
+  float *data() { return _data.get(); }
+  const float *data() const { return _data.get(); }
+
+  std::span<float> row(const int y) { return {_data.get() + std::size_t(y) * _stride, std::size_t(_width)}; }
+  std::span<const float> row(const int y) const {
+    return {_data.get() + std::size_t(y) * _stride, std::size_t(_width)};
+  }
+
+  float &at(const int x, const int y) { return _data[std::size_t(y) * _stride + x]; }
+  float at(const int x, const int y) const { return _data[std::size_t(y) * _stride + x]; }
+
+  Heightfield clone() const;
+
+private:
+  struct AlignedDeleter {
+    void operator()(float *data) const;
+  };
+
+  std::unique_ptr<float[], AlignedDeleter> _data;
+  int _width = 0;
+  int _height = 0;
+  int _stride = 0;
+};
+
+// Texels [x, x + width) x [y, y + height) of a heightfield
+struct HeightRect {
+  int x, y;
+  int width, height;
+};
+
+// Non-owning read-only view of row-major floats with a stride, such as a Heightfield or a tile of a mapped
+// file (see TiledHeightmapReader). Consumers that only read heights take a view, so they work on both.
+class HeightfieldView {
+public:
+  HeightfieldView() = default;
+  HeightfieldView(const float *data, const int width, const int height, const int stride)
+      : _data(data), _width(width), _height(height), _stride(stride) {}
+  HeightfieldView(const Heightfield &heightfield)
+      : HeightfieldView(heightfield.data(), heightfield.width(), heightfield.height(),
+                        heightfield.stride()) {}
+
+  int width() const { return _width; }
+  int height() const { return _height; }
+  int stride() const { return _stride; } // In floats
+  bool empty() const { return _data == nullptr; }
+
+  const float *data() const { return _data; }
+
+  std::span<const float> row(const int y) const {
+    return {_data + std::size_t(y) * _stride, std::size_t(_width)};
+  }
+
+  float at(const int x, const int y) const { return _data[std::size_t(y) * _stride + x]; }
+
+  // rect has to lie within the view
+  HeightfieldView subview(const HeightRect &rect) const {
+    return {_data + std::size_t(rect.y) * _stride + rect.x, rect.width, rect.height, _stride};
+  }
+
+private:
+  const float *_data = nullptr;
+  int _width = 0;
+  int _height = 0;
+  int _stride = 0;
+};
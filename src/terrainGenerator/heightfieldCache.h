@@ -0,0 +1,89 @@
+#pragma once
+
+#include <list>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+
+#include "heightfield.h"
+
+// Least recently used cache of heightfields with a memory budget. Heightfields handed out stay valid after
+// being evicted. Safe to use from the background generation thread and the UI at the same time.
+template <typename Key, typename KeyHash = std::hash<Key>> class HeightfieldCache {
+public:
+  using Value = std::shared_ptr<const Heightfield>;
+
+  explicit HeightfieldCache(const size_t memoryBudgetInBytes) : _memoryBudgetInBytes(memoryBudgetInBytes) {}
+
+  Value find(const Key &key) {
+    std::lock_guard lock(_mutex);
+    const auto it = _keyToEntry.find(key);
+    if (it == _keyToEntry.end()) {
+      return nullptr;
+    }
+
+    _entries.splice(_entries.begin(), _entries, it->second);
+    return it->second->second;
+  }
+
+  void insert(const Key &key, Value value) {
+    std::lock_guard lock(_mutex);
+    const auto it = _keyToEntry.find(key);
+    if (it != _keyToEntry.end()) {
+      _memoryUsageInBytes -= it->second->second->sizeInBytes();
+      _entries.erase(it->second);
+      _keyToEntry.erase(it);
+    }
+
+    _memoryUsageInBytes += value->sizeInBytes();
+    _entries.emplace_front(key, std::move(value));
+    _keyToEntry.emplace(key, _entries.begin());
+
+    evictToBudget();
+  }
+
+  void clear() {
+    std::lock_guard lock(_mutex);
+    _entries.clear();
+    _keyToEntry.clear();
+    _memoryUsageInBytes = 0;
+  }
+
+  void setMemoryBudget(const size_t memoryBudgetInBytes) {
+    std::lock_guard lock(_mutex);
+    _memoryBudgetInBytes = memoryBudgetInBytes;
+    evictToBudget();
+  }
+
+  size_t memoryBudget() const {
+    std::lock_guard lock(_mutex);
+    return _memoryBudgetInBytes;
+  }
+
+  size_t memoryUsage() const {
+    std::lock_guard lock(_mutex);
+    return _memoryUsageInBytes;
+  }
+
+  size_t size() const {
+    std::lock_guard lock(_mutex);
+    return _entries.size();
+  }
+
+private:
+  using EntryList = std::list<std::pair<Key, Value>>;
+
+  void evictToBudget() {
+    while (_memoryUsageInBytes > _memoryBudgetInBytes && !_entries.empty()) {
+      _memoryUsageInBytes -= _entries.back().second->sizeInBytes();
+      _keyToEntry.erase(_entries.back().first);
+      _entries.pop_back();
+    }
+  }
+
+  mutable std::mutex _mutex;
+  EntryList _entries; // Most recently used first
+  std::unordered_map<Key, typename EntryList::iterator, KeyHash> _keyToEntry;
+  size_t _memoryBudgetInBytes;
+  size_t _memoryUsageInBytes = 0;
+};
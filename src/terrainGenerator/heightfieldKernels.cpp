@@ -0,0 +1,115 @@
+#include "heightfieldKernels.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+
+#if defined(_M_X64) || defined(__x86_64__)
+#include <immintrin.h>
+#define HEIGHTFIELD_KERNELS_SSE2
+#endif
+
+[[maybe_unused]] static bool isAligned(const void *pointer) { return (uintptr_t(pointer) & 15) == 0; }
+
+void addWeightedRow(float *destination, const float *source, const float weight, const int count) {
+  assert(isAligned(destination) && isAligned(source) && count % 4 == 0);
+
+#ifdef HEIGHTFIELD_KERNELS_SSE2
+  // Separate multiply and add (no FMA) so the result matches the scalar octave sum bit for bit
+  const auto weightV = _mm_set1_ps(weight);
+  for (int i = 0; i < count; i += 4) {
+    const auto weightedSource = _mm_mul_ps(_mm_load_ps(source + i), weightV);
+    _mm_store_ps(destination + i, _mm_add_ps(_mm_load_ps(destination + i), weightedSource));
+  }
+#else
+  for (int i = 0; i < count; ++i) {
+    destination[i] += source[i] * weight;
+  }
+#endif
+}
+
+void postProcessNoiseRow(float *noiseValues, const float *falloffValues, const float minNoiseHeight,
+                         const float noiseHeightDiffInverse, const float *heightCurveTable,
+                         const int heightCurveTableSize, const int count) {
+  assert(isAligned(noiseValues) && (falloffValues == nullptr || isAligned(falloffValues)) && count % 4 == 0);
+  assert(heightCurveTableSize >= 2);
+
+  const auto lastTableSegment = float(heightCurveTableSize - 2);
+  const auto tableScale = float(heightCurveTableSize - 1);
+
+#ifdef HEIGHTFIELD_KERNELS_SSE2
+  const auto zero = _mm_setzero_ps();
+  const auto one = _mm_set1_ps(1.0f);
+  const auto minNoiseHeightV = _mm_set1_ps(minNoiseHeight);
+  const auto noiseHeightDiffInverseV = _mm_set1_ps(noiseHeightDiffInverse);
+  const auto lastTableSegmentV = _mm_set1_ps(lastTableSegment);
+  const auto tableScaleV = _mm_set1_ps(tableScale);
+
+  alignas(16) int tableIndices[4];
+  for (int i = 0; i < count; i += 4) {
+    auto value =
+        _mm_mul_ps(_mm_sub_ps(_mm_load_ps(noiseValues + i), minNoiseHeightV), noiseHeightDiffInverseV);
+
+    if (falloffValues != nullptr) {
+      value = _mm_sub_ps(value, _mm_load_ps(falloffValues + i));
+    }
+    value = _mm_min_ps(_mm_max_ps(value, zero), one);
+
+    // The last segment is also used for 1.0, with a fraction of 1
+    const auto tablePosition = _mm_mul_ps(value, tableScaleV);
+    const auto tableIndex = _mm_cvttps_epi32(_mm_min_ps(tablePosition, lastTableSegmentV));
+    const auto fraction = _mm_sub_ps(tablePosition, _mm_cvtepi32_ps(tableIndex));
+    _mm_store_si128(reinterpret_cast<__m128i *>(tableIndices), tableIndex);
+
+    // No gathers in SSE2, the lerp itself is vectorised
+    const auto a = _mm_setr_ps(heightCurveTable[tableIndices[0]], heightCurveTable[tableIndices[1]],
+                               heightCurveTable[tableIndices[2]], heightCurveTable[tableIndices[3]]);
+    const auto b = _mm_setr_ps(heightCurveTable[tableIndices[0] + 1], heightCurveTable[tableIndices[1] + 1],
+                               heightCurveTable[tableIndices[2] + 1], heightCurveTable[tableIndices[3] + 1]);
+    _mm_store_ps(noiseValues + i, _mm_add_ps(a, _mm_mul_ps(_mm_sub_ps(b, a), fraction)));
+  }
+#else
+  for (int i = 0; i < count; ++i) {
+    auto value = (noiseValues[i] - minNoiseHeight) * noiseHeightDiffInverse;
+
+    if (falloffValues != nullptr) {
+      value -= falloffValues[i];
+    }
+    value = std::min(std::max(value, 0.0f), 1.0f);
+
+    const auto tablePosition = value * tableScale;
+    const auto tableIndex = int(std::min(tablePosition, lastTableSegment));
+    const auto fraction = tablePosition - float(tableIndex);
+    const auto a = heightCurveTable[tableIndex];
+    const auto b = heightCurveTable[tableIndex + 1];
+    noiseValues[i] = a + (b - a) * fraction;
+  }
+#endif
+}
+
+void convertRowToUnorm16(const float *values, uint16_t *texels, const int count) {
+  int i = 0;
+#ifdef HEIGHTFIELD_KERNELS_SSE2
+  // SSE2 can only pack to signed 16-bit with saturation, so the values are shifted down by 32768 first and
+  // the sign bit is flipped back afterwards
+  const auto zero = _mm_setzero_ps();
+  const auto one = _mm_set1_ps(1.0f);
+  const auto scale = _mm_set1_ps(65535.0f);
+  const auto half = _mm_set1_ps(0.5f);
+  const auto signedOffset = _mm_set1_epi32(32768);
+  const auto signBit = _mm_set1_epi16(int16_t(0x8000));
+  const auto toSigned = [&](const __m128 value) {
+    const auto clampedValue = _mm_min_ps(_mm_max_ps(value, zero), one);
+    return _mm_sub_epi32(_mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(clampedValue, scale), half)), signedOffset);
+  };
+
+  for (; i + 8 <= count; i += 8) {
+    const auto packed =
+        _mm_packs_epi32(toSigned(_mm_loadu_ps(values + i)), toSigned(_mm_loadu_ps(values + i + 4)));
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(texels + i), _mm_xor_si128(packed, signBit));
+  }
+#endif
+  for (; i < count; ++i) {
+    texels[i] = uint16_t(std::min(std::max(values[i], 0.0f), 1.0f) * 65535.0f + 0.5f);
+  }
+}
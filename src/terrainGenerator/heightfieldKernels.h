@@ -0,0 +1,19 @@
+#pragma once
+
+#include <cstdint>
+
+// Row kernels for heightfield data. Pointers must be 16-byte aligned and count a multiple of 4, which
+// holds for whole Heightfield rows (see Heightfield::stride).
+
+// destination[i] += source[i] * weight
+void addWeightedRow(float *destination, const float *source, const float weight, const int count);
+
+// Fused post-process of raw noise: normalise with the map's min/max, subtract the falloff (optional,
+// may be nullptr), clamp to [0, 1] and remap through the height curve table with linear interpolation
+void postProcessNoiseRow(float *noiseValues, const float *falloffValues, const float minNoiseHeight,
+                         const float noiseHeightDiffInverse, const float *heightCurveTable,
+                         const int heightCurveTableSize, const int count);
+
+// texels[i] = values[i] clamped to [0, 1] as a rounded 16-bit unorm. Unlike the kernels above any pointer
+// alignment and count work, so rows can be packed without padding.
+void convertRowToUnorm16(const float *values, uint16_t *texels, const int count);
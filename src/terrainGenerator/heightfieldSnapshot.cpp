@@ -0,0 +1,95 @@
+#include "heightfieldSnapshot.h"
+
+#include <algorithm>
+#include <cassert>
+#include <utility>
+
+// Marks a pin slot that was claimed by a reader that has not announced its snapshot yet
+static const char kClaimedPinSlot = 0;
+
+HeightfieldSnapshotPin::HeightfieldSnapshotPin(HeightfieldSnapshotPin &&other) noexcept
+    : _owner(std::exchange(other._owner, nullptr)), _slot(std::exchange(other._slot, -1)),
+      _snapshot(std::exchange(other._snapshot, nullptr)) {}
+
+HeightfieldSnapshotPin &HeightfieldSnapshotPin::operator=(HeightfieldSnapshotPin &&other) noexcept {
+  if (this != &other) {
+    release();
+    _owner = std::exchange(other._owner, nullptr);
+    _slot = std::exchange(other._slot, -1);
+    _snapshot = std::exchange(other._snapshot, nullptr);
+  }
+  return *this;
+}
+
+void HeightfieldSnapshotPin::release() {
+  if (_snapshot != nullptr) {
+    _owner->unpin(_slot, _snapshot);
+    _owner = nullptr;
+    _slot = -1;
+    _snapshot = nullptr;
+  }
+}
+
+VersionedHeightfield::~VersionedHeightfield() {
+  assert(std::all_of(_pinSlots.begin(), _pinSlots.end(), [](const auto &slot) { return slot == nullptr; }));
+  delete _current.load();
+}
+
+void VersionedHeightfield::publish(std::unique_ptr<HeightfieldSnapshot> snapshot) {
+  std::lock_guard<std::mutex> lock(_writerMutex);
+  assert(snapshot->version > _version);
+
+  _version.store(snapshot->version, std::memory_order_release);
+  if (const auto replacedSnapshot = _current.exchange(snapshot.release())) {
+    _retiredSnapshots.emplace_back(replacedSnapshot);
+  }
+  reclaimRetiredSnapshots();
+}
+
+HeightfieldSnapshotPin VersionedHeightfield::pin() const {
+  if (_current.load(std::memory_order_acquire) == nullptr) {
+    return {};
+  }
+
+  for (int slot = 0; slot < kMaxPinCount; ++slot) {
+    const void *freeSlot = nullptr;
+    if (!_pinSlots[slot].compare_exchange_strong(freeSlot, &kClaimedPinSlot)) {
+      continue;
+    }
+
+    // Announce the snapshot, then make sure it is still current. A writer that replaced it in between
+    // sees the announcement when it checks the slots, so it can not have been freed.
+    const HeightfieldSnapshot *snapshot;
+    do {
+      snapshot = _current.load();
+      _pinSlots[slot].store(snapshot);
+    } while (snapshot != _current.load());
+    return HeightfieldSnapshotPin(this, slot, snapshot);
+  }
+
+  assert(false && "All heightfield pin slots are taken");
+  return {};
+}
+
+void VersionedHeightfield::unpin(const int slot, const HeightfieldSnapshot *snapshot) const {
+  _pinSlots[slot].store(nullptr, std::memory_order_release);
+
+  // The last reader of a replaced snapshot frees it, unless a writer is busy and will do it instead
+  if (snapshot != _current.load(std::memory_order_acquire) && _retiredCount.load() > 0 &&
+      _writerMutex.try_lock()) {
+    reclaimRetiredSnapshots();
+    _writerMutex.unlock();
+  }
+}
+
+void VersionedHeightfield::reclaimRetiredSnapshots() const {
+  std::array<const void *, kMaxPinCount> pinnedSnapshots;
+  for (int slot = 0; slot < kMaxPinCount; ++slot) {
+    pinnedSnapshots[slot] = _pinSlots[slot].load();
+  }
+
+  std::erase_if(_retiredSnapshots, [&](const auto &snapshot) {
+    return std::find(pinnedSnapshots.begin(), pinnedSnapshots.end(), snapshot.get()) == pinnedSnapshots.end();
+  });
+  _retiredCount.store(int(_retiredSnapshots.size()), std::memory_order_relaxed);
+}
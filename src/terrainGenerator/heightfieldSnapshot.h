@@ -0,0 +1,94 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "heightPyramid.h"
+#include "noiseMapGenerator.h"
+
+// One version of a heightfield with what is derived from it, never changed once published
+struct HeightfieldSnapshot {
+  uint64_t version = 0;
+  NoiseMapData noiseMapData = {};
+  NoiseMap heightfield;
+  HeightPyramid heightPyramid;
+};
+
+class VersionedHeightfield;
+
+// Keeps a published snapshot alive until released or destroyed
+class HeightfieldSnapshotPin {
+public:
+  HeightfieldSnapshotPin() = default;
+  ~HeightfieldSnapshotPin() { release(); }
+
+  HeightfieldSnapshotPin(HeightfieldSnapshotPin &&other) noexcept;
+  HeightfieldSnapshotPin &operator=(HeightfieldSnapshotPin &&other) noexcept;
+  HeightfieldSnapshotPin(const HeightfieldSnapshotPin &) = delete;
+  HeightfieldSnapshotPin &operator=(const HeightfieldSnapshotPin &) = delete;
+
+  explicit operator bool() const { return _snapshot != nullptr; }
+  const HeightfieldSnapshot *get() const { return _snapshot; }
+  const HeightfieldSnapshot *operator->() const { return _snapshot; }
+  const HeightfieldSnapshot &operator*() const { return *_snapshot; }
+
+  void release();
+
+private:
+  friend class VersionedHeightfield;
+
+  HeightfieldSnapshotPin(const VersionedHeightfield *owner, const int slot,
+                         const HeightfieldSnapshot *snapshot)
+      : _owner(owner), _slot(slot), _snapshot(snapshot) {}
+
+  const VersionedHeightfield *_owner = nullptr;
+  int _slot = -1;
+  const HeightfieldSnapshot *_snapshot = nullptr;
+};
+
+// The current snapshot of a heightfield, replaced RCU style: publishing swaps in a new snapshot while
+// readers keep using the ones they pinned, and a replaced snapshot is freed once no pin holds it any more.
+//
+// Pinning and releasing never lock or wait for a writer. Every pin announces its snapshot in one of
+// kMaxPinCount slots (hazard pointers), which a writer checks before freeing anything. Replaced snapshots
+// are freed by the release of their last pin, or at the latest by the next publish.
+class VersionedHeightfield {
+public:
+  static constexpr int kMaxPinCount = 64;
+
+  VersionedHeightfield() = default;
+  ~VersionedHeightfield();
+
+  VersionedHeightfield(const VersionedHeightfield &) = delete;
+  VersionedHeightfield &operator=(const VersionedHeightfield &) = delete;
+
+  // Takes over the snapshot, its version has to be greater than the current one. Writers are serialised
+  // with a mutex that readers never take.
+  void publish(std::unique_ptr<HeightfieldSnapshot> snapshot);
+
+  // The newest snapshot, empty if none was published yet or all pin slots are taken
+  HeightfieldSnapshotPin pin() const;
+
+  // 0 until the first publish
+  uint64_t version() const { return _version.load(std::memory_order_acquire); }
+  // Replaced snapshots still pinned by a reader
+  int retiredCount() const { return _retiredCount.load(std::memory_order_relaxed); }
+
+private:
+  friend class HeightfieldSnapshotPin;
+
+  void unpin(const int slot, const HeightfieldSnapshot *snapshot) const;
+  void reclaimRetiredSnapshots() const; // _writerMutex must be held
+
+  std::atomic<const HeightfieldSnapshot *> _current = nullptr;
+  std::atomic<uint64_t> _version = 0;
+  mutable std::array<std::atomic<const void *>, kMaxPinCount> _pinSlots = {};
+
+  mutable std::mutex _writerMutex;
+  mutable std::vector<std::unique_ptr<const HeightfieldSnapshot>> _retiredSnapshots;
+  mutable std::atomic<int> _retiredCount = 0;
+};
@@ -0,0 +1,164 @@
+#include "heightmapWriter.h"
+
+#include "profiler.h"
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <fstream>
+#include <functional>
+
+// Deflate stored blocks hold at most 64 KiB - 1
+static constexpr size_t kMaxStoredBlockSize = 65535;
+
+static uint16_t getHeight16(const float height) {
+  return uint16_t(std::lround(std::clamp(height, 0.0f, 1.0f) * 65535.0f));
+}
+
+static uint32_t getCrc32(const uint32_t crc, const uint8_t *data, const size_t size) {
+  static const auto crcTable = []() {
+    std::array<uint32_t, 256> table;
+    for (uint32_t i = 0; i < 256; ++i) {
+      auto value = i;
+      for (int bit = 0; bit < 8; ++bit) {
+        value = (value & 1) != 0 ? 0xedb88320u ^ (value >> 1) : value >> 1;
+      }
+      table[i] = value;
+    }
+    return table;
+  }();
+
+  auto value = ~crc;
+  for (size_t i = 0; i < size; ++i) {
+    value = crcTable[(value ^ data[i]) & 0xff] ^ (value >> 8);
+  }
+  return ~value;
+}
+
+static void appendBigEndian32(std::vector<uint8_t> *bytes, const uint32_t value) {
+  bytes->insert(bytes->end(),
+                {uint8_t(value >> 24), uint8_t(value >> 16), uint8_t(value >> 8), uint8_t(value)});
+}
+
+static void writePngChunk(std::ofstream *file, const char *type, const std::vector<uint8_t> &data) {
+  std::vector<uint8_t> chunk;
+  chunk.reserve(data.size() + 12);
+  appendBigEndian32(&chunk, uint32_t(data.size()));
+  chunk.insert(chunk.end(), type, type + 4);
+  chunk.insert(chunk.end(), data.begin(), data.end());
+  appendBigEndian32(&chunk, getCrc32(0, chunk.data() + 4, chunk.size() - 4));
+  file->write(reinterpret_cast<const char *>(chunk.data()), std::streamsize(chunk.size()));
+}
+
+// Streams rows through uncompressed (stored) deflate blocks, one block per IDAT chunk, so only a block of
+// the image is held at a time. Heightmaps barely compress with deflate anyway.
+static bool writePng(const std::string &filePath, const int width, const int height, const int bitDepth,
+                     const int channels, const std::function<void(int, uint8_t *)> &getRow) {
+  std::ofstream file(filePath, std::ios::binary);
+  if (!file) {
+    return false;
+  }
+
+  const uint8_t signature[] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n'};
+  file.write(reinterpret_cast<const char *>(signature), sizeof(signature));
+
+  std::vector<uint8_t> header;
+  appendBigEndian32(&header, uint32_t(width));
+  appendBigEndian32(&header, uint32_t(height));
+  const uint8_t colorType = channels == 3 ? 2 : 0;
+  header.insert(header.end(), {uint8_t(bitDepth), colorType, 0, 0, 0});
+  writePngChunk(&file, "IHDR", header);
+
+  // Filter type byte (none) followed by the row
+  const auto rowSize = 1 + size_t(width) * size_t(channels) * size_t(bitDepth / 8);
+  std::vector<uint8_t> row(rowSize, 0);
+  std::vector<uint8_t> pending;
+  uint32_t adlerA = 1;
+  uint32_t adlerB = 0;
+  bool isFirstBlock = true;
+
+  const auto writeBlock = [&](const size_t size, const bool isFinal) {
+    std::vector<uint8_t> data;
+    data.reserve(size + 11);
+    if (isFirstBlock) {
+      data.insert(data.end(), {0x78, 0x01}); // Deflate, 32 KiB window, no preset dictionary
+      isFirstBlock = false;
+    }
+    data.insert(data.end(), {uint8_t(isFinal ? 1 : 0), uint8_t(size), uint8_t(size >> 8), uint8_t(~size),
+                             uint8_t(~size >> 8)});
+    data.insert(data.end(), pending.begin(), pending.begin() + std::ptrdiff_t(size));
+    if (isFinal) {
+      appendBigEndian32(&data, (adlerB << 16) | adlerA);
+    }
+    writePngChunk(&file, "IDAT", data);
+    pending.erase(pending.begin(), pending.begin() + std::ptrdiff_t(size));
+  };
+
+  for (int i = 0; i < height; ++i) {
+    getRow(i, row.data() + 1);
+    for (const auto byte : row) {
+      adlerA = (adlerA + byte) % 65521;
+      adlerB = (adlerB + adlerA) % 65521;
+    }
+    pending.insert(pending.end(), row.begin(), row.end());
+    while (pending.size() > kMaxStoredBlockSize) {
+      writeBlock(kMaxStoredBlockSize, false);
+    }
+  }
+  writeBlock(pending.size(), true);
+  writePngChunk(&file, "IEND", {});
+
+  return bool(file);
+}
+
+bool writeHeightmap(const std::string &filePath, const HeightfieldView &noiseMap,
+                    const HEIGHTMAP_FORMAT format) {
+  PROFILE_ZONE("Write heightmap");
+
+  const auto width = noiseMap.width();
+  const auto height = noiseMap.height();
+
+  if (format == HEIGHTMAP_FORMAT::PNG16) {
+    // PNG samples are big endian
+    return writePng(filePath, width, height, 16, 1, [&](const int i, uint8_t *row) {
+      for (const auto value : noiseMap.row(i)) {
+        const auto height16 = getHeight16(value);
+        *row++ = uint8_t(height16 >> 8);
+        *row++ = uint8_t(height16);
+      }
+    });
+  }
+
+  std::ofstream file(filePath, std::ios::binary);
+  if (!file) {
+    return false;
+  }
+
+  std::vector<uint16_t> row16(format == HEIGHTMAP_FORMAT::RAW16 ? width : 0);
+  for (int i = 0; i < height; ++i) {
+    const auto row = noiseMap.row(i);
+    if (format == HEIGHTMAP_FORMAT::RAW16) {
+      std::transform(row.begin(), row.end(), row16.begin(), getHeight16);
+      file.write(reinterpret_cast<const char *>(row16.data()),
+                 std::streamsize(row16.size() * sizeof(uint16_t)));
+    } else {
+      file.write(reinterpret_cast<const char *>(row.data()), std::streamsize(row.size_bytes()));
+    }
+  }
+
+  return bool(file);
+}
+
+bool writeNormalMap(const std::string &filePath, const std::vector<glm::vec3> &normals, const int width,
+                    const int height) {
+  PROFILE_ZONE("Write normal map");
+
+  return writePng(filePath, width, height, 8, 3, [&](const int i, uint8_t *row) {
+    for (int j = 0; j < width; ++j) {
+      const auto normal = glm::clamp(normals[size_t(i) * size_t(width) + j], -1.0f, 1.0f);
+      *row++ = uint8_t(std::lround((normal.x * 0.5f + 0.5f) * 255.0f));
+      *row++ = uint8_t(std::lround((normal.y * 0.5f + 0.5f) * 255.0f));
+      *row++ = uint8_t(std::lround((normal.z * 0.5f + 0.5f) * 255.0f));
+    }
+  });
+}
@@ -0,0 +1,19 @@
+#pragma once
+#include <string>
+#include <vector>
+
+#include "noiseMapGenerator.h"
+
+#include "glm/glm.hpp"
+
+// PNG16 is a 16-bit greyscale PNG. RAW16 (unsigned 16-bit) and FLOAT32 are headerless, row-major and in the
+// byte order of the machine, little endian on everything we build for.
+enum class HEIGHTMAP_FORMAT { PNG16, RAW16, FLOAT32 };
+
+// Heights are clamped to [0, 1] and scaled to 65535 for the 16-bit formats
+bool writeHeightmap(const std::string &filePath, const HeightfieldView &noiseMap,
+                    const HEIGHTMAP_FORMAT format);
+
+// 8-bit RGB PNG of unit normals, [-1, 1] mapped to [0, 255]
+bool writeNormalMap(const std::string &filePath, const std::vector<glm::vec3> &normals, const int width,
+                    const int height);
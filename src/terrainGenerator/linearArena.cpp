@@ -0,0 +1,76 @@
+#include "linearArena.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+
+// A frame of the viewer only needs a few KiB, the first block should hold all of it
+static constexpr std::size_t kFrameArenaBlockSize = 1024 * 1024;
+
+void *LinearArena::allocate(const std::size_t size, const std::size_t alignment) {
+  assert(alignment > 0 && (alignment & (alignment - 1)) == 0);
+
+  for (;;) {
+    if (_blockIndex == _blocks.size()) {
+      addBlock(size + alignment);
+    }
+
+    auto &block = _blocks[_blockIndex];
+    const auto address = reinterpret_cast<std::uintptr_t>(block.data.get()) + _offset;
+    const auto padding = (alignment - address % alignment) % alignment;
+    if (_offset + padding + size <= block.size) {
+      const auto memory = block.data.get() + _offset + padding;
+      _offset += padding + size;
+      _peakUsedBytes = std::max(_peakUsedBytes, usedBytes());
+      return memory;
+    }
+
+    // The rest of the block is wasted until the next rewind
+    ++_blockIndex;
+    _offset = 0;
+  }
+}
+
+void LinearArena::rewind(const Marker &marker) {
+  assert(marker.blockIndex < _blockIndex || (marker.blockIndex == _blockIndex && marker.offset <= _offset));
+
+  _blockIndex = marker.blockIndex;
+  _offset = marker.offset;
+
+  if (_blockIndex == 0 && _offset == 0 && _blocks.size() > 1) {
+    const auto totalSize = capacity();
+    _blocks.clear();
+    addBlock(totalSize);
+  }
+}
+
+std::size_t LinearArena::usedBytes() const {
+  std::size_t usedBytes = 0;
+  for (std::size_t i = 0; i < std::min(_blockIndex, _blocks.size()); ++i) {
+    usedBytes += _blocks[i].size;
+  }
+  return usedBytes + _offset;
+}
+
+std::size_t LinearArena::capacity() const {
+  std::size_t capacity = 0;
+  for (const auto &block : _blocks) {
+    capacity += block.size;
+  }
+  return capacity;
+}
+
+void LinearArena::addBlock(const std::size_t minSize) {
+  const auto size = std::max(_blockSize, minSize);
+  _blocks.push_back({std::unique_ptr<std::byte[]>(new std::byte[size]), size});
+}
+
+LinearArena &getFrameArena() {
+  static LinearArena frameArena(kFrameArenaBlockSize);
+  return frameArena;
+}
+
+LinearArena &getScratchArena() {
+  thread_local LinearArena scratchArena;
+  return scratchArena;
+}
@@ -0,0 +1,111 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <span>
+#include <type_traits>
+#include <vector>
+
+// Bump allocator for short lived data. Nothing is freed on its own, everything allocated after a marker is
+// released at once by rewinding to it. The blocks stay allocated, and whenever the arena is rewound to
+// empty the blocks are merged in to one, so a workload that repeats itself only touches the heap during
+// its first runs.
+class LinearArena {
+public:
+  static constexpr std::size_t kDefaultBlockSize = 64 * 1024;
+
+  // A position in the arena, everything allocated after it is released by rewinding to it
+  struct Marker {
+    std::size_t blockIndex = 0;
+    std::size_t offset = 0;
+  };
+
+  explicit LinearArena(const std::size_t blockSize = kDefaultBlockSize) : _blockSize(blockSize) {}
+
+  LinearArena(const LinearArena &) = delete;
+  LinearArena &operator=(const LinearArena &) = delete;
+
+  // alignment has to be a power of two
+  void *allocate(const std::size_t size, const std::size_t alignment = alignof(std::max_align_t));
+
+  // Default initialized, so trivial types are left uninitialized
+  template <typename T>
+  std::span<T> allocateArray(const std::size_t count, const std::size_t alignment = alignof(T)) {
+    static_assert(std::is_trivially_destructible_v<T>, "Arena memory is released without destructors");
+    const auto values = static_cast<T *>(allocate(count * sizeof(T), alignment));
+    std::uninitialized_default_construct_n(values, count);
+    return {values, count};
+  }
+
+  Marker mark() const { return {_blockIndex, _offset}; }
+  void rewind(const Marker &marker);
+  void reset() { rewind({}); }
+
+  std::size_t usedBytes() const;     // Including alignment padding
+  std::size_t capacity() const;      // Summed over all blocks
+  std::size_t peakUsedBytes() const { return _peakUsedBytes; }
+
+private:
+  struct Block {
+    std::unique_ptr<std::byte[]> data;
+    std::size_t size;
+  };
+
+  void addBlock(const std::size_t minSize);
+
+  std::size_t _blockSize;
+  std::vector<Block> _blocks;
+  std::size_t _blockIndex = 0; // Block allocated from, the blocks after it are unused
+  std::size_t _offset = 0;     // In the current block
+  std::size_t _peakUsedBytes = 0;
+};
+
+// Lets standard containers allocate from an arena. Deallocation does nothing, the memory is released with
+// the arena, so an arena backed container must not outlive the marker it was created after.
+template <typename T> class ArenaAllocator {
+public:
+  using value_type = T;
+
+  ArenaAllocator(LinearArena *arena) : _arena(arena) {}
+  template <typename U> ArenaAllocator(const ArenaAllocator<U> &other) : _arena(other.arena()) {}
+
+  T *allocate(const std::size_t count) {
+    return static_cast<T *>(_arena->allocate(count * sizeof(T), alignof(T)));
+  }
+  void deallocate(T *, const std::size_t) {}
+
+  LinearArena *arena() const { return _arena; }
+
+  template <typename U> bool operator==(const ArenaAllocator<U> &other) const {
+    return _arena == other.arena();
+  }
+
+private:
+  LinearArena *_arena;
+};
+
+template <typename T> using ArenaVector = std::vector<T, ArenaAllocator<T>>;
+
+// Transient data of one frame of the viewer. Only used on the main thread, which resets it at the start of
+// every frame.
+LinearArena &getFrameArena();
+
+// Arena of the calling thread for temporaries of a job or task, used through ScratchArenaScope
+LinearArena &getScratchArena();
+
+// Releases everything allocated from the scratch arena of the thread during its lifetime. Scopes nest, as
+// do tasks a thread runs while it waits for others.
+class ScratchArenaScope {
+public:
+  ScratchArenaScope() : _arena(getScratchArena()), _marker(_arena.mark()) {}
+  ~ScratchArenaScope() { _arena.rewind(_marker); }
+
+  ScratchArenaScope(const ScratchArenaScope &) = delete;
+  ScratchArenaScope &operator=(const ScratchArenaScope &) = delete;
+
+  LinearArena &arena() { return _arena; }
+
+private:
+  LinearArena &_arena;
+  LinearArena::Marker _marker;
+};
@@ -0,0 +1,120 @@
+#include "mappedFile.h"
+
+#include <utility>
+
+#ifdef _WIN32
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+MappedFile::~MappedFile() { close(); }
+
+MappedFile::MappedFile(MappedFile &&other) noexcept { *this = std::move(other); }
+
+MappedFile &MappedFile::operator=(MappedFile &&other) noexcept {
+  if (this != &other) {
+    close();
+    _data = std::exchange(other._data, nullptr);
+    _size = std::exchange(other._size, 0);
+#ifdef _WIN32
+    _fileHandle = std::exchange(other._fileHandle, nullptr);
+    _mappingHandle = std::exchange(other._mappingHandle, nullptr);
+#else
+    _fileDescriptor = std::exchange(other._fileDescriptor, -1);
+#endif
+  }
+  return *this;
+}
+
+#ifdef _WIN32
+bool MappedFile::open(const std::string &filePath) {
+  close();
+
+  _fileHandle = CreateFileA(filePath.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                            FILE_ATTRIBUTE_NORMAL, nullptr);
+  if (_fileHandle == INVALID_HANDLE_VALUE) {
+    _fileHandle = nullptr;
+    return false;
+  }
+
+  LARGE_INTEGER fileSize;
+  if (!GetFileSizeEx(_fileHandle, &fileSize) || fileSize.QuadPart == 0) {
+    close();
+    return false;
+  }
+
+  _mappingHandle = CreateFileMappingA(_fileHandle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+  if (_mappingHandle == nullptr) {
+    close();
+    return false;
+  }
+
+  _data = static_cast<const std::byte *>(MapViewOfFile(_mappingHandle, FILE_MAP_READ, 0, 0, 0));
+  if (_data == nullptr) {
+    close();
+    return false;
+  }
+
+  _size = size_t(fileSize.QuadPart);
+  return true;
+}
+
+void MappedFile::close() {
+  if (_data != nullptr) {
+    UnmapViewOfFile(_data);
+  }
+  if (_mappingHandle != nullptr) {
+    CloseHandle(_mappingHandle);
+  }
+  if (_fileHandle != nullptr) {
+    CloseHandle(_fileHandle);
+  }
+
+  _data = nullptr;
+  _size = 0;
+  _mappingHandle = nullptr;
+  _fileHandle = nullptr;
+}
+#else
+bool MappedFile::open(const std::string &filePath) {
+  close();
+
+  _fileDescriptor = ::open(filePath.c_str(), O_RDONLY);
+  if (_fileDescriptor < 0) {
+    return false;
+  }
+
+  struct stat fileStatus;
+  if (fstat(_fileDescriptor, &fileStatus) != 0 || fileStatus.st_size == 0) {
+    close();
+    return false;
+  }
+
+  const auto mapping = mmap(nullptr, size_t(fileStatus.st_size), PROT_READ, MAP_PRIVATE, _fileDescriptor, 0);
+  if (mapping == MAP_FAILED) {
+    close();
+    return false;
+  }
+
+  _data = static_cast<const std::byte *>(mapping);
+  _size = size_t(fileStatus.st_size);
+  return true;
+}
+
+void MappedFile::close() {
+  if (_data != nullptr) {
+    munmap(const_cast<std::byte *>(_data), _size);
+  }
+  if (_fileDescriptor >= 0) {
+    ::close(_fileDescriptor);
+  }
+
+  _data = nullptr;
+  _size = 0;
+  _fileDescriptor = -1;
+}
+#endif
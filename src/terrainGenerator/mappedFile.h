@@ -0,0 +1,34 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+// Read-only memory mapping of a whole file
+class MappedFile {
+public:
+  MappedFile() = default;
+  ~MappedFile();
+
+  MappedFile(MappedFile &&other) noexcept;
+  MappedFile &operator=(MappedFile &&other) noexcept;
+  MappedFile(const MappedFile &) = delete;
+  MappedFile &operator=(const MappedFile &) = delete;
+
+  // Returns false if the file does not exist, is empty or can not be mapped
+  bool open(const std::string &filePath);
+  void close();
+
+  bool isOpen() const { return _data != nullptr; }
+  const std::byte *data() const { return _data; }
+  size_t size() const { return _size; }
+
+private:
+  const std::byte *_data = nullptr;
+  size_t _size = 0;
+#ifdef _WIN32
+  void *_fileHandle = nullptr;
+  void *_mappingHandle = nullptr;
+#else
+  int _fileDescriptor = -1;
+#endif
+};
@@ -0,0 +1,249 @@
+#include "memoryTracking.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <mutex>
+#include <new>
+#include <unordered_map>
+
+static constexpr auto kBytesToMiB = 1.0 / (1024.0 * 1024.0);
+
+// Stored right in front of the memory handed out, so delete knows what to subtract from which tag
+struct AllocationHeader {
+  uint64_t size;
+  MEMORY_TAG tag;
+};
+
+static constexpr std::size_t kAllocationHeaderSize = 16;
+static_assert(sizeof(AllocationHeader) <= kAllocationHeaderSize);
+
+struct UsageCounters {
+  std::atomic<uint64_t> allocationCount = 0;
+  std::atomic<uint64_t> bytes = 0;
+  std::atomic<uint64_t> peakBytes = 0;
+
+  void add(const uint64_t size) {
+    allocationCount.fetch_add(1, std::memory_order_relaxed);
+    const auto newBytes = bytes.fetch_add(size, std::memory_order_relaxed) + size;
+    auto peak = peakBytes.load(std::memory_order_relaxed);
+    while (newBytes > peak && !peakBytes.compare_exchange_weak(peak, newBytes, std::memory_order_relaxed)) {
+    }
+  }
+
+  void remove(const uint64_t size) { bytes.fetch_sub(size, std::memory_order_relaxed); }
+
+  MemoryUsage usage() const {
+    return {allocationCount.load(std::memory_order_relaxed), bytes.load(std::memory_order_relaxed),
+            peakBytes.load(std::memory_order_relaxed)};
+  }
+
+  void resetPeak() { peakBytes.store(bytes.load(std::memory_order_relaxed), std::memory_order_relaxed); }
+};
+
+// Constant initialized, so allocations made before main are counted as well
+static std::array<UsageCounters, size_t(MEMORY_TAG::COUNT)> heapUsage;
+static std::array<UsageCounters, size_t(MEMORY_TAG::COUNT)> gpuUsage;
+static UsageCounters totalHeapUsage;
+static UsageCounters totalGpuUsage;
+
+static std::atomic<uint64_t> heapAllocationCount = 0;
+static thread_local uint64_t threadHeapAllocationCount = 0;
+static thread_local MEMORY_TAG threadMemoryTag = MEMORY_TAG::OTHER;
+
+struct GpuResource {
+  MEMORY_TAG tag;
+  uint64_t sizeInBytes;
+};
+
+static std::mutex gpuResourcesMutex;
+
+static std::unordered_map<uint64_t, GpuResource> &getGpuResources() {
+  static std::unordered_map<uint64_t, GpuResource> gpuResources;
+  return gpuResources;
+}
+
+static uint64_t getGpuResourceKey(const GPU_RESOURCE_TYPE type, const uint32_t handle) {
+  return uint64_t(type) << 32 | handle;
+}
+
+// The header fits in the space up to the requested alignment
+static std::size_t getAllocationOffset(const std::size_t alignment) {
+  return std::max(alignment, kAllocationHeaderSize);
+}
+
+static void *allocateMemory(const std::size_t size, const std::size_t alignment) {
+  const auto offset = getAllocationOffset(alignment);
+  void *block;
+  if (alignment <= __STDCPP_DEFAULT_NEW_ALIGNMENT__) {
+    block = std::malloc(offset + size);
+  } else {
+#ifdef _MSC_VER
+    block = _aligned_malloc(offset + size, alignment);
+#else
+    block = std::aligned_alloc(alignment, (offset + size + alignment - 1) / alignment * alignment);
+#endif
+  }
+  if (block == nullptr) {
+    return nullptr;
+  }
+
+  heapAllocationCount.fetch_add(1, std::memory_order_relaxed);
+  ++threadHeapAllocationCount;
+  heapUsage[size_t(threadMemoryTag)].add(size);
+  totalHeapUsage.add(size);
+
+  const auto memory = static_cast<std::byte *>(block) + offset;
+  new (memory - kAllocationHeaderSize) AllocationHeader{size, threadMemoryTag};
+  return memory;
+}
+
+static void freeMemory(void *memory, const std::size_t alignment) {
+  if (memory == nullptr) {
+    return;
+  }
+
+  const auto header =
+      reinterpret_cast<const AllocationHeader *>(static_cast<std::byte *>(memory) - kAllocationHeaderSize);
+  heapUsage[size_t(header->tag)].remove(header->size);
+  totalHeapUsage.remove(header->size);
+
+  const auto block = static_cast<std::byte *>(memory) - getAllocationOffset(alignment);
+#ifdef _MSC_VER
+  if (alignment > __STDCPP_DEFAULT_NEW_ALIGNMENT__) {
+    _aligned_free(block);
+    return;
+  }
+#endif
+  std::free(block);
+}
+
+static void *allocateOrThrow(const std::size_t size, const std::size_t alignment) {
+  const auto memory = allocateMemory(size, alignment);
+  if (memory == nullptr) {
+    throw std::bad_alloc();
+  }
+  return memory;
+}
+
+MemoryTagUsage getMemoryTagUsage(const MEMORY_TAG tag) {
+  return {heapUsage[size_t(tag)].usage(), gpuUsage[size_t(tag)].usage()};
+}
+
+MemoryTagUsage getTotalMemoryUsage() { return {totalHeapUsage.usage(), totalGpuUsage.usage()}; }
+
+void resetMemoryPeaks() {
+  for (size_t i = 0; i < size_t(MEMORY_TAG::COUNT); ++i) {
+    heapUsage[i].resetPeak();
+    gpuUsage[i].resetPeak();
+  }
+  totalHeapUsage.resetPeak();
+  totalGpuUsage.resetPeak();
+}
+
+uint64_t getHeapAllocationCount() { return heapAllocationCount.load(std::memory_order_relaxed); }
+
+uint64_t getThreadHeapAllocationCount() { return threadHeapAllocationCount; }
+
+MEMORY_TAG getThreadMemoryTag() { return threadMemoryTag; }
+
+MemoryTagScope::MemoryTagScope(const MEMORY_TAG tag) : _previousTag(threadMemoryTag) {
+  threadMemoryTag = tag;
+}
+
+MemoryTagScope::~MemoryTagScope() { threadMemoryTag = _previousTag; }
+
+void trackGpuResource(const GPU_RESOURCE_TYPE type, const uint32_t handle, const MEMORY_TAG tag,
+                      const uint64_t sizeInBytes) {
+  std::lock_guard<std::mutex> lock(gpuResourcesMutex);
+  const auto [resource, isNew] = getGpuResources().try_emplace(getGpuResourceKey(type, handle));
+  if (!isNew) {
+    gpuUsage[size_t(resource->second.tag)].remove(resource->second.sizeInBytes);
+    totalGpuUsage.remove(resource->second.sizeInBytes);
+  }
+  resource->second = {tag, sizeInBytes};
+  gpuUsage[size_t(tag)].add(sizeInBytes);
+  totalGpuUsage.add(sizeInBytes);
+}
+
+void untrackGpuResource(const GPU_RESOURCE_TYPE type, const uint32_t handle) {
+  std::lock_guard<std::mutex> lock(gpuResourcesMutex);
+  auto &gpuResources = getGpuResources();
+  const auto resource = gpuResources.find(getGpuResourceKey(type, handle));
+  if (resource == gpuResources.end()) {
+    return;
+  }
+  gpuUsage[size_t(resource->second.tag)].remove(resource->second.sizeInBytes);
+  totalGpuUsage.remove(resource->second.sizeInBytes);
+  gpuResources.erase(resource);
+}
+
+void writeMemoryReport(std::FILE *file) {
+  const auto writeRow = [file](const char *name, const MemoryTagUsage &usage) {
+    std::fprintf(file, "%-16s %10.2f %10.2f %12llu %10.2f %10.2f\n", name, usage.heap.bytes * kBytesToMiB,
+                 usage.heap.peakBytes * kBytesToMiB,
+                 static_cast<unsigned long long>(usage.heap.allocationCount), usage.gpu.bytes * kBytesToMiB,
+                 usage.gpu.peakBytes * kBytesToMiB);
+  };
+
+  std::fprintf(file, "%-16s %10s %10s %12s %10s %10s\n", "Memory", "heap MiB", "peak MiB", "allocations",
+               "GPU MiB", "peak MiB");
+  for (size_t i = 0; i < size_t(MEMORY_TAG::COUNT); ++i) {
+    writeRow(kMemoryTagNames[i], getMemoryTagUsage(MEMORY_TAG(i)));
+  }
+  writeRow("Total", getTotalMemoryUsage());
+}
+
+void *operator new(std::size_t size) { return allocateOrThrow(size, __STDCPP_DEFAULT_NEW_ALIGNMENT__); }
+void *operator new[](std::size_t size) { return allocateOrThrow(size, __STDCPP_DEFAULT_NEW_ALIGNMENT__); }
+void *operator new(std::size_t size, std::align_val_t alignment) {
+  return allocateOrThrow(size, std::size_t(alignment));
+}
+void *operator new[](std::size_t size, std::align_val_t alignment) {
+  return allocateOrThrow(size, std::size_t(alignment));
+}
+void *operator new(std::size_t size, const std::nothrow_t &) noexcept {
+  return allocateMemory(size, __STDCPP_DEFAULT_NEW_ALIGNMENT__);
+}
+void *operator new[](std::size_t size, const std::nothrow_t &) noexcept {
+  return allocateMemory(size, __STDCPP_DEFAULT_NEW_ALIGNMENT__);
+}
+void *operator new(std::size_t size, std::align_val_t alignment, const std::nothrow_t &) noexcept {
+  return allocateMemory(size, std::size_t(alignment));
+}
+void *operator new[](std::size_t size, std::align_val_t alignment, const std::nothrow_t &) noexcept {
+  return allocateMemory(size, std::size_t(alignment));
+}
+
+void operator delete(void *memory) noexcept { freeMemory(memory, __STDCPP_DEFAULT_NEW_ALIGNMENT__); }
+void operator delete[](void *memory) noexcept { freeMemory(memory, __STDCPP_DEFAULT_NEW_ALIGNMENT__); }
+void operator delete(void *memory, std::size_t) noexcept {
+  freeMemory(memory, __STDCPP_DEFAULT_NEW_ALIGNMENT__);
+}
+void operator delete[](void *memory, std::size_t) noexcept {
+  freeMemory(memory, __STDCPP_DEFAULT_NEW_ALIGNMENT__);
+}
+void operator delete(void *memory, std::align_val_t alignment) noexcept {
+  freeMemory(memory, std::size_t(alignment));
+}
+void operator delete[](void *memory, std::align_val_t alignment) noexcept {
+  freeMemory(memory, std::size_t(alignment));
+}
+void operator delete(void *memory, std::size_t, std::align_val_t alignment) noexcept {
+  freeMemory(memory, std::size_t(alignment));
+}
+void operator delete[](void *memory, std::size_t, std::align_val_t alignment) noexcept {
+  freeMemory(memory, std::size_t(alignment));
+}
+void operator delete(void *memory, const std::nothrow_t &) noexcept {
+  freeMemory(memory, __STDCPP_DEFAULT_NEW_ALIGNMENT__);
+}
+void operator delete[](void *memory, const std::nothrow_t &) noexcept {
+  freeMemory(memory, __STDCPP_DEFAULT_NEW_ALIGNMENT__);
+}
+void operator delete(void *memory, std::align_val_t alignment, const std::nothrow_t &) noexcept {
+  freeMemory(memory, std::size_t(alignment));
+}
+void operator delete[](void *memory, std::align_val_t alignment, const std::nothrow_t &) noexcept {
+  freeMemory(memory, std::size_t(alignment));
+}
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <cstdio>
+
+// Heap allocations are counted by replacing the global operator new and delete, every allocation is charged
+// to the memory tag of the thread that makes it. GPU memory is recorded by hand where resources are created.
+
+enum class MEMORY_TAG {
+  OTHER,
+  NOISE_MAPS,      // Generated heightfields, their snapshots and previews
+  FALLOFF_MAPS,    // Including the cached copies
+  CACHES,          // Noise map and noise layer caches
+  TEXTURE_STAGING, // Texels converted for upload and the upload buffers
+  TEXTURES,        // Decoded images and the textures made from them
+  MESHES,          // Vertices, indices and their buffers
+  RENDER_TARGETS,
+  COUNT
+};
+
+constexpr std::array<const char *, size_t(MEMORY_TAG::COUNT)> kMemoryTagNames{
+    "Other",           "Noise maps", "Falloff maps", "Caches",
+    "Texture staging", "Textures",   "Meshes",       "Render targets"};
+
+struct MemoryUsage {
+  uint64_t allocationCount = 0; // Since the program started
+  uint64_t bytes = 0;           // Currently allocated
+  uint64_t peakBytes = 0;       // High-water mark since the program started or resetMemoryPeaks
+};
+
+struct MemoryTagUsage {
+  MemoryUsage heap;
+  MemoryUsage gpu;
+};
+
+MemoryTagUsage getMemoryTagUsage(const MEMORY_TAG tag);
+// Over all tags, with the high-water mark of the sum rather than the sum of the high-water marks
+MemoryTagUsage getTotalMemoryUsage();
+// Lowers the high-water marks to the current usage
+void resetMemoryPeaks();
+
+// Over all threads since the program started
+uint64_t getHeapAllocationCount();
+// By the calling thread since it started
+uint64_t getThreadHeapAllocationCount();
+
+MEMORY_TAG getThreadMemoryTag();
+
+// Charges the heap allocations of the calling thread to a tag until the end of the scope. Thread pool tasks
+// keep the tag of the thread that queued them.
+class MemoryTagScope {
+public:
+  explicit MemoryTagScope(const MEMORY_TAG tag);
+  ~MemoryTagScope();
+
+  MemoryTagScope(const MemoryTagScope &) = delete;
+  MemoryTagScope &operator=(const MemoryTagScope &) = delete;
+
+private:
+  MEMORY_TAG _previousTag;
+};
+
+enum class GPU_RESOURCE_TYPE { TEXTURE, BUFFER, RENDERBUFFER };
+
+// Tracking a resource again replaces its previous size, such as when the storage of a texture is respecified
+void trackGpuResource(const GPU_RESOURCE_TYPE type, const uint32_t handle, const MEMORY_TAG tag,
+                      const uint64_t sizeInBytes);
+void untrackGpuResource(const GPU_RESOURCE_TYPE type, const uint32_t handle);
+
+// Current and peak bytes and allocation counts of every tag as a table
+void writeMemoryReport(std::FILE *file);
@@ -1,10 +1,13 @@
 #include "meshGenerator.h"
 
+#include "derivedMaps.h"
 #include "glm\gtc\matrix_transform.hpp"
 #include "lightDefs.h"
 #include "terrainDefs.h"
 #include "textureGenerator.h"
+#include "threadPool.h"
 #include <assert.h>
+#include <memory>
 
 static void validateTerrainMeshTextureData(const unsigned char *pixelData, const int width, const int height,
                                            const int expectedWidth, const int expectedHeight) {
@@ -13,84 +16,28 @@ static void validateTerrainMeshTextureData(const unsigned char *pixelData, const
   assert(height == expectedHeight);
 }
 
-static void createVertexBufferObject(GLuint *vboHandle, const std::vector<Vertex> &vertices) {
+static void createVertexBufferObject(GLuint *vboHandle, const MEMORY_TAG memoryTag,
+                                     const std::vector<Vertex> &vertices) {
   glBindBuffer(GL_ARRAY_BUFFER, *vboHandle);
   glBufferData(GL_ARRAY_BUFFER, sizeof(Vertex) * vertices.size(), vertices.data(), GL_STATIC_DRAW);
   glBindBuffer(GL_ARRAY_BUFFER, 0);
+  trackGpuResource(GPU_RESOURCE_TYPE::BUFFER, *vboHandle, memoryTag, sizeof(Vertex) * vertices.size());
 }
 
-static void createIndexBufferObject(GLuint *iboHandle, const std::vector<uint32_t> &indices) {
+static void createIndexBufferObject(GLuint *iboHandle, const MEMORY_TAG memoryTag,
+                                    const std::vector<uint32_t> &indices) {
   glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, *iboHandle);
   glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(uint32_t) * indices.size(), indices.data(), GL_STATIC_DRAW);
   glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+  trackGpuResource(GPU_RESOURCE_TYPE::BUFFER, *iboHandle, memoryTag, sizeof(uint32_t) * indices.size());
 }
 
-static void calculateNormals(Mesh *mesh) {
-  for (size_t i = 0, size = mesh->indices.size(); i < size; i = i + 3) {
-    auto &v1 = mesh->vertices[mesh->indices[i]];
-    auto &v2 = mesh->vertices[mesh->indices[i + 1]];
-    auto &v3 = mesh->vertices[mesh->indices[i + 2]];
-
-    const auto edgeOne = glm::vec3(v2.position3f) - glm::vec3(v1.position3f);
-    const auto edgeTwo = glm::vec3(v3.position3f) - glm::vec3(v1.position3f);
-    const auto faceNormal = glm::cross(edgeOne, edgeTwo);
-    v1.normal += faceNormal;
-    v2.normal += faceNormal;
-    v3.normal += faceNormal;
-  }
-
-  for (size_t i = 0, size = mesh->vertices.size(); i < size; i++) {
-    auto &v = mesh->vertices[i];
-    v.normal = glm::normalize(v.normal);
-  }
-}
-
-static void calculateTangentVectors(Mesh *mesh) {
-  for (size_t i = 0, size = mesh->indices.size(); i < size; i = i + 3) {
-    auto &v1 = mesh->vertices[mesh->indices[i]];
-    auto &v2 = mesh->vertices[mesh->indices[i + 1]];
-    auto &v3 = mesh->vertices[mesh->indices[i + 2]];
-
-    const auto edgeOne = glm::vec3(v2.position3f) - glm::vec3(v1.position3f);
-    const auto edgeTwo = glm::vec3(v3.position3f) - glm::vec3(v1.position3f);
-    const auto deltaUVOne = v2.textureCoordinate - v1.textureCoordinate;
-    const auto deltaUVTwo = v3.textureCoordinate - v1.textureCoordinate;
-
-    const auto fract = 1.0f / (deltaUVOne.x * deltaUVTwo.y - deltaUVTwo.x * deltaUVOne.y);
-
-    glm::vec3 tangent(0.0f);
-    glm::vec3 bitangent(0.0f);
-
-    tangent.x = fract * (deltaUVTwo.y * edgeOne.x - deltaUVOne.y * edgeTwo.x);
-    tangent.y = fract * (deltaUVTwo.y * edgeOne.y - deltaUVOne.y * edgeTwo.y);
-    tangent.z = fract * (deltaUVTwo.y * edgeOne.z - deltaUVOne.y * edgeTwo.z);
-
-    bitangent.x = fract * (-deltaUVTwo.x * edgeOne.x + deltaUVOne.x * edgeTwo.x);
-    bitangent.y = fract * (-deltaUVTwo.x * edgeOne.y + deltaUVOne.x * edgeTwo.y);
-    bitangent.z = fract * (-deltaUVTwo.x * edgeOne.z + deltaUVOne.x * edgeTwo.z);
-
-    v1.tangent += tangent;
-    v2.tangent += tangent;
-    v3.tangent += tangent;
-
-    v1.bitangent += bitangent;
-    v2.bitangent += bitangent;
-    v3.bitangent += bitangent;
-  }
-
-  for (size_t i = 0, size = mesh->vertices.size(); i < size; i++) {
-    auto &v = mesh->vertices[i];
-    const auto &T = v.tangent;
-    const auto &B = v.bitangent;
-    const auto &N = v.normal;
-    v.tangent = normalize(T - glm::dot(T, N) * N);
-    v.bitangent = glm::cross(N, T);
-  }
-}
-
-static Mesh generateMeshHeightMapVertices(const int mapWidth, const int mapHeight, const NoiseMap &noiseMap) {
+static Mesh generateMeshHeightMapVertices(const NoiseMap &noiseMap) {
   Mesh heightMapMesh = {};
 
+  const auto mapWidth = noiseMap.width();
+  const auto mapHeight = noiseMap.height();
+
   // Assume height map texture is a multiple of 64 (so minimum is that it contains one patch)
   int numOfPatchesX = mapWidth / int(kPatchSize);
   int numOfPatchesZ = mapHeight / int(kPatchSize);
@@ -122,14 +69,14 @@ static Mesh generateMeshFromHeightMap(const NoiseMapData &noiseMapData, const bo
                                       const std::vector<float> &heights) {
   const auto noiseMap = generateNoiseMap(noiseMapData, useFalloffMap);
 
-  Mesh terrainMesh = generateMeshHeightMapVertices(noiseMapData.width, noiseMapData.height, noiseMap);
+  Mesh terrainMesh = generateMeshHeightMapVertices(noiseMap);
   terrainMesh.modelTransformation = glm::identity<glm::mat4>();
 
   glGenBuffers(1, &terrainMesh.vboHandle);
-  createVertexBufferObject(&terrainMesh.vboHandle, terrainMesh.vertices);
+  createVertexBufferObject(&terrainMesh.vboHandle, MEMORY_TAG::MESHES, terrainMesh.vertices);
 
   glGenBuffers(1, &terrainMesh.iboHandle);
-  createIndexBufferObject(&terrainMesh.iboHandle, terrainMesh.indices);
+  createIndexBufferObject(&terrainMesh.iboHandle, MEMORY_TAG::MESHES, terrainMesh.indices);
 
   glGenVertexArrays(1, &terrainMesh.vaoHandle);
   glBindVertexArray(terrainMesh.vaoHandle);
@@ -144,55 +91,28 @@ static Mesh generateMeshFromHeightMap(const NoiseMapData &noiseMapData, const bo
   glBindVertexArray(0);
 
   glGenTextures(3, terrainMesh.textureHandles);
-  createTexture2D(&terrainMesh.textureHandles[0], GL_CLAMP_TO_EDGE, GL_NEAREST, noiseMapData.width,
-                  noiseMapData.height, GL_FLOAT, generateNoiseMapTexture(noiseMap).data());
-  createTexture2D(&terrainMesh.textureHandles[1], GL_CLAMP_TO_EDGE, GL_NEAREST, noiseMapData.width,
-                  noiseMapData.height, GL_FLOAT, generateFalloffMap(noiseMapData.width).data());
+  createHeightTexture2D(&terrainMesh.textureHandles[0], MEMORY_TAG::TEXTURES, GL_CLAMP_TO_EDGE, GL_NEAREST,
+                        noiseMapData.width, noiseMapData.height, generateNoiseMapTexture(noiseMap).data());
+  createHeightTexture2D(&terrainMesh.textureHandles[1], MEMORY_TAG::TEXTURES, GL_CLAMP_TO_EDGE, GL_NEAREST,
+                        noiseMapData.width, noiseMapData.height,
+                        generateNoiseMapTexture(*getFalloffMap(noiseMapData.width)).data());
 
-  std::vector<unsigned char *> terrainTexturesPixelData;
+  // Sand is used for the two lowest layers
+  const auto terrainTextures = loadTextures(
+      {"sand.png", "sand.png", "grass.png", "rock.png", "mountain.png", "snow.png"}, terrainTexturePath);
 
   const auto expectedTerrainTextureDimension = 1024; // Ensure it is 1024x1024 textures
-  int terrainTextureWidth, terrainTextureHeight;
-  unsigned char *terrainTexturePixelData = nullptr;
-
-  loadTexture("sand.png", terrainTexturePath, &terrainTextureWidth, &terrainTextureHeight,
-              &terrainTexturePixelData);
-  validateTerrainMeshTextureData(terrainTexturePixelData, terrainTextureWidth, terrainTextureHeight,
-                                 expectedTerrainTextureDimension, expectedTerrainTextureDimension);
-  terrainTexturesPixelData.push_back(terrainTexturePixelData);
-
-  loadTexture("sand.png", terrainTexturePath, &terrainTextureWidth, &terrainTextureHeight,
-              &terrainTexturePixelData);
-  validateTerrainMeshTextureData(terrainTexturePixelData, terrainTextureWidth, terrainTextureHeight,
-                                 expectedTerrainTextureDimension, expectedTerrainTextureDimension);
-  terrainTexturesPixelData.push_back(terrainTexturePixelData);
-
-  loadTexture("grass.png", terrainTexturePath, &terrainTextureWidth, &terrainTextureHeight,
-              &terrainTexturePixelData);
-  validateTerrainMeshTextureData(terrainTexturePixelData, terrainTextureWidth, terrainTextureHeight,
-                                 expectedTerrainTextureDimension, expectedTerrainTextureDimension);
-  terrainTexturesPixelData.push_back(terrainTexturePixelData);
-
-  loadTexture("rock.png", terrainTexturePath, &terrainTextureWidth, &terrainTextureHeight,
-              &terrainTexturePixelData);
-  validateTerrainMeshTextureData(terrainTexturePixelData, terrainTextureWidth, terrainTextureHeight,
-                                 expectedTerrainTextureDimension, expectedTerrainTextureDimension);
-  terrainTexturesPixelData.push_back(terrainTexturePixelData);
-
-  loadTexture("mountain.png", terrainTexturePath, &terrainTextureWidth, &terrainTextureHeight,
-              &terrainTexturePixelData);
-  validateTerrainMeshTextureData(terrainTexturePixelData, terrainTextureWidth, terrainTextureHeight,
-                                 expectedTerrainTextureDimension, expectedTerrainTextureDimension);
-  terrainTexturesPixelData.push_back(terrainTexturePixelData);
-
-  loadTexture("snow.png", terrainTexturePath, &terrainTextureWidth, &terrainTextureHeight,
-              &terrainTexturePixelData);
-  validateTerrainMeshTextureData(terrainTexturePixelData, terrainTextureWidth, terrainTextureHeight,
-                                 expectedTerrainTextureDimension, expectedTerrainTextureDimension);
-  terrainTexturesPixelData.push_back(terrainTexturePixelData);
-
-  createTexture2DArray(&terrainMesh.textureHandles[2], GL_REPEAT, GL_NEAREST, terrainTextureWidth,
-                       terrainTextureHeight, GL_UNSIGNED_BYTE, terrainTexturesPixelData);
+  std::vector<unsigned char *> terrainTexturesPixelData;
+  for (const auto &terrainTexture : terrainTextures) {
+    validateTerrainMeshTextureData(terrainTexture.pixelData, terrainTexture.width, terrainTexture.height,
+                                   expectedTerrainTextureDimension, expectedTerrainTextureDimension);
+    terrainTexturesPixelData.push_back(terrainTexture.pixelData);
+  }
+  const auto terrainTextureWidth = terrainTextures[0].width;
+  const auto terrainTextureHeight = terrainTextures[0].height;
+
+  createTexture2DArray(&terrainMesh.textureHandles[2], MEMORY_TAG::TEXTURES, GL_REPEAT, GL_NEAREST,
+                       terrainTextureWidth, terrainTextureHeight, GL_UNSIGNED_BYTE, terrainTexturesPixelData);
 
   for (auto pixelData : terrainTexturesPixelData) {
     freeTexture(pixelData);
@@ -269,10 +189,10 @@ static Mesh generateSkyboxMesh() {
   skyboxMesh.modelTransformation = glm::identity<glm::mat4>();
 
   glGenBuffers(1, &skyboxMesh.vboHandle);
-  createVertexBufferObject(&skyboxMesh.vboHandle, skyboxMesh.vertices);
+  createVertexBufferObject(&skyboxMesh.vboHandle, MEMORY_TAG::MESHES, skyboxMesh.vertices);
 
   glGenBuffers(1, &skyboxMesh.iboHandle);
-  createIndexBufferObject(&skyboxMesh.iboHandle, skyboxMesh.indices);
+  createIndexBufferObject(&skyboxMesh.iboHandle, MEMORY_TAG::MESHES, skyboxMesh.indices);
 
   glGenVertexArrays(1, &skyboxMesh.vaoHandle);
   glBindVertexArray(skyboxMesh.vaoHandle);
@@ -291,7 +211,7 @@ static Mesh generateSkyboxMesh() {
   };
 
   glGenTextures(1, skyboxMesh.textureHandles);
-  createCubeMapTexture(&skyboxMesh.textureHandles[0], facesNames);
+  createCubeMapTexture(&skyboxMesh.textureHandles[0], MEMORY_TAG::TEXTURES, facesNames);
 
   return skyboxMesh;
 }
@@ -363,10 +283,10 @@ static Mesh generateLightMesh(const glm::vec4 lightPosition) {
   lightMesh.modelTransformation = glm::scale(lightMesh.modelTransformation, glm::vec3(5.0f));
 
   glGenBuffers(1, &lightMesh.vboHandle);
-  createVertexBufferObject(&lightMesh.vboHandle, lightMesh.vertices);
+  createVertexBufferObject(&lightMesh.vboHandle, MEMORY_TAG::MESHES, lightMesh.vertices);
 
   glGenBuffers(1, &lightMesh.iboHandle);
-  createIndexBufferObject(&lightMesh.iboHandle, lightMesh.indices);
+  createIndexBufferObject(&lightMesh.iboHandle, MEMORY_TAG::MESHES, lightMesh.indices);
 
   glGenVertexArrays(1, &lightMesh.vaoHandle);
   glBindVertexArray(lightMesh.vaoHandle);
@@ -419,16 +339,16 @@ static Mesh generateWaterMesh(const int mapWidth, const int mapHeight) {
   waterMesh.indices.push_back(2);
   waterMesh.indices.push_back(1);
 
-  calculateNormals(&waterMesh);
-  calculateTangentVectors(&waterMesh);
+  calculateNormals(waterMesh.indices, &waterMesh.vertices);
+  calculateTangentVectors(waterMesh.indices, &waterMesh.vertices);
 
   waterMesh.modelTransformation = glm::identity<glm::mat4>();
 
   glGenBuffers(1, &waterMesh.vboHandle);
-  createVertexBufferObject(&waterMesh.vboHandle, waterMesh.vertices);
+  createVertexBufferObject(&waterMesh.vboHandle, MEMORY_TAG::MESHES, waterMesh.vertices);
 
   glGenBuffers(1, &waterMesh.iboHandle);
-  createIndexBufferObject(&waterMesh.iboHandle, waterMesh.indices);
+  createIndexBufferObject(&waterMesh.iboHandle, MEMORY_TAG::MESHES, waterMesh.indices);
 
   glGenVertexArrays(1, &waterMesh.vaoHandle);
   glBindVertexArray(waterMesh.vaoHandle);
@@ -465,8 +385,8 @@ static Mesh generateWaterMesh(const int mapWidth, const int mapHeight) {
   unsigned char *dudvPixelData = nullptr;
   loadTexture("waterDuDv1.png", waterDuDvTexturePath, &dudvWidth, &dudvHeight, &dudvPixelData);
   assert(dudvPixelData != nullptr);
-  createTexture2D(&waterMesh.textureHandles[0], GL_REPEAT, GL_LINEAR, dudvWidth, dudvHeight, GL_UNSIGNED_BYTE,
-                  dudvPixelData);
+  createTexture2D(&waterMesh.textureHandles[0], MEMORY_TAG::TEXTURES, GL_REPEAT, GL_LINEAR, dudvWidth,
+                  dudvHeight, GL_UNSIGNED_BYTE, dudvPixelData);
   freeTexture(dudvPixelData);
 
   int normalMapWidth, normalMapHeight;
@@ -474,14 +394,16 @@ static Mesh generateWaterMesh(const int mapWidth, const int mapHeight) {
   loadTexture("waterNormalMap1.png", waterNormalMapTexturePath, &normalMapWidth, &normalMapHeight,
               &normalMapPixelData);
   assert(normalMapPixelData != nullptr);
-  createTexture2D(&waterMesh.textureHandles[1], GL_REPEAT, GL_LINEAR, normalMapWidth, normalMapHeight,
-                  GL_UNSIGNED_BYTE, normalMapPixelData);
+  createTexture2D(&waterMesh.textureHandles[1], MEMORY_TAG::TEXTURES, GL_REPEAT, GL_LINEAR, normalMapWidth,
+                  normalMapHeight, GL_UNSIGNED_BYTE, normalMapPixelData);
   freeTexture(normalMapPixelData);
 
   return waterMesh;
 }
 
 MeshIdToMesh initSceneMeshes(const TerrainData &terrainData) {
+  // Generation and texture loading below charge their own tags
+  MemoryTagScope memoryTagScope(MEMORY_TAG::MESHES);
   MeshIdToMesh meshIdToMesh;
   meshIdToMesh.reserve(4);
 
@@ -499,6 +421,7 @@ MeshIdToMesh initSceneMeshes(const TerrainData &terrainData) {
 }
 
 std::vector<Mesh> initLightMeshes(const LightData &lightData) {
+  MemoryTagScope memoryTagScope(MEMORY_TAG::MESHES);
   std::vector<Mesh> lightMeshes;
 
   for (size_t i = 0; i < lightData.lightCount; ++i) {
@@ -508,28 +431,55 @@ std::vector<Mesh> initLightMeshes(const LightData &lightData) {
   return lightMeshes;
 }
 
-void updateTerrainMeshTexture(Mesh *terrainMesh, const NoiseMapData &noiseMapData, const bool useFalloffMap,
-                              const std::vector<glm::vec3> &colors, const std::vector<float> &heights) {
-  const auto noiseMap = generateNoiseMap(noiseMapData, useFalloffMap);
-  updateTexture2D(&terrainMesh->textureHandles[0], 0, 0, noiseMapData.width, noiseMapData.height, GL_FLOAT,
-                  generateNoiseMapTexture(noiseMap).data());
+void updateTerrainMeshTexture(Mesh *terrainMesh, const int level, std::vector<TextureRegion> textureRegions,
+                              TextureUploadQueue *textureUploadQueue) {
+  const auto texture = terrainMesh->textureHandles[0];
+
+  // Every shader stage clamps its level of detail to GL_TEXTURE_MIN_LOD, so they all sample the preview mip
+  // while textureSize(heightMapTexture, 0) still reports the full size the patches are laid out with
+  const auto showLevel = [texture, level] {
+    glBindTexture(GL_TEXTURE_2D, texture);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, level > 0 ? GL_NEAREST_MIPMAP_NEAREST : GL_NEAREST);
+    glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MIN_LOD, float(level));
+    glBindTexture(GL_TEXTURE_2D, 0);
+  };
+
+  if (textureRegions.empty()) {
+    showLevel();
+    return;
+  }
+  for (size_t i = 0; i < textureRegions.size(); ++i) {
+    const auto isLastRegion = i + 1 == textureRegions.size();
+    textureUploadQueue->enqueue(texture, level, std::move(textureRegions[i]),
+                                isLastRegion ? std::function<void()>(showLevel) : nullptr);
+  }
 }
 
 void updateTerrainMeshWaterTextures(Mesh *waterMesh, const std::string mapIndex) {
-  int dudvWidth, dudvHeight;
-  unsigned char *dudvPixelData = nullptr;
-  loadTexture("waterDuDv" + mapIndex + ".png", waterDuDvTexturePath, &dudvWidth, &dudvHeight, &dudvPixelData);
-  assert(dudvPixelData != nullptr);
-  createTexture2D(&waterMesh->textureHandles[0], GL_REPEAT, GL_LINEAR, dudvWidth, dudvHeight,
-                  GL_UNSIGNED_BYTE, dudvPixelData);
-  freeTexture(dudvPixelData);
-
-  int normalMapWidth, normalMapHeight;
-  unsigned char *normalMapPixelData = nullptr;
-  loadTexture("waterNormalMap" + mapIndex + ".png", waterNormalMapTexturePath, &normalMapWidth,
-              &normalMapHeight, &normalMapPixelData);
-  assert(normalMapPixelData != nullptr);
-  createTexture2D(&waterMesh->textureHandles[1], GL_REPEAT, GL_LINEAR, normalMapWidth, normalMapHeight,
-                  GL_UNSIGNED_BYTE, normalMapPixelData);
-  freeTexture(normalMapPixelData);
-}
\ No newline at end of file
+  // Decoded on the thread pool while the frames go on, the textures are replaced on the main thread
+  auto &threadPool = getThreadPool();
+  auto dudv = std::make_shared<LoadedTexture>();
+  auto normalMap = std::make_shared<LoadedTexture>();
+  const auto loadDuDv = threadPool.schedule([dudv, mapIndex] {
+    loadTexture("waterDuDv" + mapIndex + ".png", waterDuDvTexturePath, &dudv->width, &dudv->height,
+                &dudv->pixelData);
+  });
+  const auto loadNormalMap = threadPool.schedule([normalMap, mapIndex] {
+    loadTexture("waterNormalMap" + mapIndex + ".png", waterNormalMapTexturePath, &normalMap->width,
+                &normalMap->height, &normalMap->pixelData);
+  });
+
+  threadPool.scheduleOnMainThread(
+      [waterMesh, dudv, normalMap] {
+        assert(dudv->pixelData != nullptr);
+        createTexture2D(&waterMesh->textureHandles[0], MEMORY_TAG::TEXTURES, GL_REPEAT, GL_LINEAR,
+                        dudv->width, dudv->height, GL_UNSIGNED_BYTE, dudv->pixelData);
+        freeTexture(dudv->pixelData);
+
+        assert(normalMap->pixelData != nullptr);
+        createTexture2D(&waterMesh->textureHandles[1], MEMORY_TAG::TEXTURES, GL_REPEAT, GL_LINEAR,
+                        normalMap->width, normalMap->height, GL_UNSIGNED_BYTE, normalMap->pixelData);
+        freeTexture(normalMap->pixelData);
+      },
+      {loadDuDv, loadNormalMap});
+}
@@ -3,6 +3,9 @@
 #include "GL/glew.h"
 #include "glm/glm.hpp"
 #include "noiseMapGenerator.h"
+#include "textureUploadQueue.h"
+#include "vertexAttributes.h"
+#include <cstdint>
 #include <unordered_map>
 #include <vector>
 
@@ -12,19 +15,6 @@ struct LightData;
 struct TerrainData;
 struct TerrainProperty;
 
-struct Vertex {
-  union {
-    glm::vec2 position2f;
-    glm::vec3 position3f;
-    glm::vec4 position4f;
-  };
-
-  glm::vec3 normal;
-  glm::vec3 tangent;
-  glm::vec3 bitangent;
-  glm::vec2 textureCoordinate;
-};
-
 struct Mesh {
   std::vector<Vertex> vertices;
   std::vector<uint32_t> indices;
@@ -46,6 +36,9 @@ using MeshIdToMesh = std::unordered_map<std::string, Mesh>;
 MeshIdToMesh initSceneMeshes(const TerrainData &terrainData);
 std::vector<Mesh> initLightMeshes(const LightData &lightData);
 
-void updateTerrainMeshTexture(Mesh *terrainMesh, const NoiseMapData &noiseMapData, const bool useFalloffMap,
-                              const std::vector<glm::vec3> &colors, const std::vector<float> &heights);
+// Level 0 is the full resolution map, coarser preview levels go in to the matching mip level. The regions
+// are streamed through the upload queue and the level is only shown once all of them are uploaded.
+void updateTerrainMeshTexture(Mesh *terrainMesh, const int level, std::vector<TextureRegion> textureRegions,
+                              TextureUploadQueue *textureUploadQueue);
+// Decoded in the background, the textures are swapped by the main thread jobs of the shared thread pool
 void updateTerrainMeshWaterTextures(Mesh *terrainMesh, const std::string mapIndex);
\ No newline at end of file
@@ -0,0 +1,47 @@
+#include "noiseLayerCache.h"
+
+#include <functional>
+
+static constexpr size_t kDefaultNoiseLayerCacheBudget = size_t(256) * 1024 * 1024;
+
+static void hashCombine(size_t *seed, const size_t value) {
+  *seed ^= value + 0x9e3779b9 + (*seed << 6) + (*seed >> 2);
+}
+
+bool NoiseLayerKey::operator==(const NoiseLayerKey &other) const {
+  return width == other.width && height == other.height && seed == other.seed && scale == other.scale &&
+         lacunarity == other.lacunarity && octaveOffset == other.octaveOffset &&
+         noiseBackend == other.noiseBackend && octave == other.octave;
+}
+
+size_t NoiseLayerKeyHash::operator()(const NoiseLayerKey &key) const {
+  size_t seed = 0;
+  hashCombine(&seed, std::hash<int>()(key.width));
+  hashCombine(&seed, std::hash<int>()(key.height));
+  hashCombine(&seed, std::hash<int>()(key.seed));
+  hashCombine(&seed, std::hash<float>()(key.scale));
+  hashCombine(&seed, std::hash<float>()(key.lacunarity));
+  hashCombine(&seed, std::hash<float>()(key.octaveOffset.x));
+  hashCombine(&seed, std::hash<float>()(key.octaveOffset.y));
+  hashCombine(&seed, std::hash<int>()(int(key.noiseBackend)));
+  hashCombine(&seed, std::hash<int>()(key.octave));
+  return seed;
+}
+
+NoiseLayerKey createNoiseLayerKey(const NoiseMapData &noiseMapData, const int octave) {
+  NoiseLayerKey key = {};
+  key.width = noiseMapData.width;
+  key.height = noiseMapData.height;
+  key.seed = noiseMapData.seed;
+  key.scale = noiseMapData.scale;
+  key.lacunarity = noiseMapData.lacunarity;
+  key.octaveOffset = noiseMapData.octaveOffset;
+  key.noiseBackend = noiseMapData.noiseBackend;
+  key.octave = octave;
+  return key;
+}
+
+NoiseLayerCache &getNoiseLayerCache() {
+  static NoiseLayerCache noiseLayerCache(kDefaultNoiseLayerCacheBudget);
+  return noiseLayerCache;
+}
@@ -0,0 +1,38 @@
+#pragma once
+
+#include "heightfieldCache.h"
+#include "noiseMapGenerator.h"
+#include <memory>
+
+// Identifies the raw (unweighted) noise of one octave. Persistance is not part of the key since it
+// only changes the weights the layers are summed with.
+struct NoiseLayerKey {
+  int width, height;
+  int seed;
+  float scale;
+  float lacunarity;
+  glm::vec2 octaveOffset;
+  NOISE_BACKEND noiseBackend;
+  int octave;
+
+  bool operator==(const NoiseLayerKey &other) const;
+};
+
+struct NoiseLayerKeyHash {
+  size_t operator()(const NoiseLayerKey &key) const;
+};
+
+NoiseLayerKey createNoiseLayerKey(const NoiseMapData &noiseMapData, const int octave);
+
+using NoiseLayer = std::shared_ptr<const Heightfield>;
+
+// Raw octave layers of recent generations
+class NoiseLayerCache : public HeightfieldCache<NoiseLayerKey, NoiseLayerKeyHash> {
+public:
+  using HeightfieldCache::HeightfieldCache;
+
+  size_t layerCount() const { return size(); }
+};
+
+// Shared cache used by the UI, 256 MiB by default
+NoiseLayerCache &getNoiseLayerCache();
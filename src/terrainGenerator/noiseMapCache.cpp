@@ -0,0 +1,351 @@
+#include "noiseMapCache.h"
+
+#include "memoryTracking.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+static constexpr size_t kDefaultNoiseMapCacheBudget = size_t(512) * 1024 * 1024;
+static constexpr size_t kDefaultNoiseMapDiskCacheBudget = size_t(2048) * 1024 * 1024;
+
+static constexpr uint32_t kNoiseMapFileMagic = 0x4d4e4754; // "TGNM"
+
+// Float data starts 64 bytes in to the file, a cache line in
+struct NoiseMapFileHeader {
+  uint32_t magic;
+  uint32_t generatorVersion;
+  uint64_t hash;
+  int32_t width;
+  int32_t height;
+  uint8_t reserved[40];
+};
+static_assert(sizeof(NoiseMapFileHeader) == 64);
+
+// 64-bit FNV-1a, std::hash is not guaranteed to be the same between runs
+class StableHash {
+public:
+  template <typename T> void add(const T &value) {
+    static_assert(std::is_arithmetic_v<T> || std::is_enum_v<T>);
+    const auto bytes = reinterpret_cast<const unsigned char *>(&value);
+    for (size_t i = 0; i < sizeof(T); ++i) {
+      _hash = (_hash ^ bytes[i]) * 0x100000001b3ull;
+    }
+  }
+
+  uint64_t hash() const { return _hash; }
+
+private:
+  uint64_t _hash = 0xcbf29ce484222325ull;
+};
+
+uint64_t getNoiseMapHash(const NoiseMapData &noiseMapData, const bool useFalloffMap) {
+  StableHash stableHash;
+  stableHash.add(kNoiseMapGeneratorVersion);
+  stableHash.add(noiseMapData.width);
+  stableHash.add(noiseMapData.height);
+  stableHash.add(noiseMapData.scale);
+  stableHash.add(noiseMapData.octaves);
+  stableHash.add(noiseMapData.persistance);
+  stableHash.add(noiseMapData.lacunarity);
+  stableHash.add(noiseMapData.seed);
+  stableHash.add(noiseMapData.octaveOffset.x);
+  stableHash.add(noiseMapData.octaveOffset.y);
+  stableHash.add(noiseMapData.noiseBackend);
+  // FastNoiseSIMD results differ slightly between instruction sets
+  if (noiseMapData.noiseBackend == NOISE_BACKEND::SIMD) {
+    stableHash.add(getNoiseSIMDLevel());
+  }
+  stableHash.add(noiseMapData.normalization);
+  stableHash.add(noiseMapData.worldNoiseRange.x);
+  stableHash.add(noiseMapData.worldNoiseRange.y);
+  stableHash.add(noiseMapData.heightCurve.type);
+  stableHash.add(noiseMapData.heightCurve.coefficients.size());
+  for (const auto coefficient : noiseMapData.heightCurve.coefficients) {
+    stableHash.add(coefficient);
+  }
+  stableHash.add(noiseMapData.heightCurve.controlPoints.size());
+  for (const auto &controlPoint : noiseMapData.heightCurve.controlPoints) {
+    stableHash.add(controlPoint.x);
+    stableHash.add(controlPoint.y);
+  }
+  stableHash.add(useFalloffMap);
+  return stableHash.hash();
+}
+
+static std::string getDiskCacheFilePath(const std::string &diskCachePath, const uint64_t hash) {
+  char fileName[32];
+  std::snprintf(fileName, sizeof(fileName), "%016llx.noisemap", static_cast<unsigned long long>(hash));
+  return (std::filesystem::path(diskCachePath) / fileName).string();
+}
+
+static size_t getNoiseMapFileSize(const int width, const int height) {
+  return sizeof(NoiseMapFileHeader) + size_t(width) * size_t(height) * sizeof(float);
+}
+
+// The inverse of getDiskCacheFilePath, false for any other file
+static bool parseDiskCacheFileName(const std::filesystem::path &filePath, uint64_t *hash) {
+  const auto stem = filePath.stem().string();
+  if (filePath.extension() != ".noisemap" || stem.size() != 16) {
+    return false;
+  }
+
+  char *end;
+  *hash = std::strtoull(stem.c_str(), &end, 16);
+  return *end == '\0';
+}
+
+NoiseMapCache::NoiseMapCache(const size_t memoryBudgetInBytes, const size_t diskBudgetInBytes)
+    : _memoryCache(memoryBudgetInBytes), _diskBudgetInBytes(diskBudgetInBytes) {}
+
+NoiseMapCache::~NoiseMapCache() {
+  {
+    std::lock_guard lock(_diskMutex);
+    _pendingDiskWrite.reset();
+  }
+  getThreadPool().wait(_diskWriteJob);
+}
+
+std::shared_ptr<const NoiseMap> NoiseMapCache::find(const NoiseMapData &noiseMapData,
+                                                    const bool useFalloffMap) {
+  const auto hash = getNoiseMapHash(noiseMapData, useFalloffMap);
+
+  if (auto noiseMap = _memoryCache.find(hash)) {
+    ++_memoryHitCount;
+    return noiseMap;
+  }
+
+  if (auto noiseMap = readFromDisk(hash)) {
+    ++_diskHitCount;
+    _memoryCache.insert(hash, noiseMap);
+    return noiseMap;
+  }
+
+  ++_missCount;
+  return nullptr;
+}
+
+void NoiseMapCache::insert(const NoiseMapData &noiseMapData, const bool useFalloffMap,
+                           std::shared_ptr<const NoiseMap> noiseMap) {
+  const auto hash = getNoiseMapHash(noiseMapData, useFalloffMap);
+  _memoryCache.insert(hash, noiseMap);
+
+  bool isDiskWriteScheduled;
+  {
+    std::lock_guard lock(_diskMutex);
+    if (_diskCachePath.empty() || _hashToDiskCacheFile.contains(hash) ||
+        getNoiseMapFileSize(noiseMap->width(), noiseMap->height()) > _diskBudgetInBytes) {
+      return;
+    }
+    _pendingDiskWrite = PendingDiskWrite{hash, std::move(noiseMap)};
+    isDiskWriteScheduled = std::exchange(_isDiskWriteScheduled, true);
+  }
+
+  // Outside the lock, a single threaded pool runs the job right away
+  if (!isDiskWriteScheduled) {
+    _diskWriteJob = getThreadPool().schedule([this] { runDiskWrites(); });
+  }
+}
+
+void NoiseMapCache::setDiskCachePath(const std::string &diskCachePath) {
+  std::vector<std::pair<std::filesystem::file_time_type, DiskCacheFile>> diskCacheFiles;
+  if (!diskCachePath.empty()) {
+    std::error_code errorCode;
+    std::filesystem::create_directories(diskCachePath, errorCode);
+
+    for (const auto &entry : std::filesystem::directory_iterator(diskCachePath, errorCode)) {
+      uint64_t hash;
+      if (entry.path().extension() == ".tmp") {
+        // Left behind by a write that never finished
+        std::filesystem::remove(entry.path(), errorCode);
+      } else if (entry.is_regular_file(errorCode) && parseDiskCacheFileName(entry.path(), &hash)) {
+        diskCacheFiles.emplace_back(entry.last_write_time(errorCode),
+                                    DiskCacheFile{hash, size_t(entry.file_size(errorCode))});
+      }
+    }
+  }
+  std::sort(diskCacheFiles.begin(), diskCacheFiles.end(),
+            [](const auto &a, const auto &b) { return a.first > b.first; });
+
+  std::lock_guard lock(_diskMutex);
+  _diskCachePath = diskCachePath;
+  _diskUsageInBytes = 0;
+  _diskCacheFiles.clear();
+  _hashToDiskCacheFile.clear();
+  for (const auto &[lastWriteTime, diskCacheFile] : diskCacheFiles) {
+    _diskUsageInBytes += diskCacheFile.sizeInBytes;
+    _hashToDiskCacheFile[diskCacheFile.hash] = _diskCacheFiles.insert(_diskCacheFiles.end(), diskCacheFile);
+  }
+  evictToDiskBudget();
+}
+
+std::string NoiseMapCache::diskCachePath() const {
+  std::lock_guard lock(_diskMutex);
+  return _diskCachePath;
+}
+
+void NoiseMapCache::setDiskBudget(const size_t diskBudgetInBytes) {
+  std::lock_guard lock(_diskMutex);
+  _diskBudgetInBytes = diskBudgetInBytes;
+  evictToDiskBudget();
+}
+
+size_t NoiseMapCache::diskBudget() const {
+  std::lock_guard lock(_diskMutex);
+  return _diskBudgetInBytes;
+}
+
+size_t NoiseMapCache::diskUsage() const {
+  std::lock_guard lock(_diskMutex);
+  return _diskUsageInBytes;
+}
+
+size_t NoiseMapCache::diskMapCount() const {
+  std::lock_guard lock(_diskMutex);
+  return _diskCacheFiles.size();
+}
+
+std::shared_ptr<const NoiseMap> NoiseMapCache::readFromDisk(const uint64_t hash) {
+  std::string diskCachePath;
+  size_t fileSize;
+  {
+    std::lock_guard lock(_diskMutex);
+    const auto it = _hashToDiskCacheFile.find(hash);
+    if (it == _hashToDiskCacheFile.end()) {
+      return nullptr;
+    }
+    _diskCacheFiles.splice(_diskCacheFiles.begin(), _diskCacheFiles, it->second);
+    diskCachePath = _diskCachePath;
+    fileSize = it->second->sizeInBytes;
+  }
+  const auto filePath = getDiskCacheFilePath(diskCachePath, hash);
+
+  // Read straight in to the rows, the published snapshot owns its heightfield so a mapping would be copied
+  // all the same
+  MemoryTagScope memoryTagScope(MEMORY_TAG::CACHES);
+  std::ifstream file(filePath, std::ios::binary);
+  NoiseMapFileHeader header;
+  std::shared_ptr<NoiseMap> noiseMap;
+  if (file.read(reinterpret_cast<char *>(&header), sizeof(header)) && header.magic == kNoiseMapFileMagic &&
+      header.generatorVersion == kNoiseMapGeneratorVersion && header.hash == hash && header.width > 0 &&
+      header.height > 0 && fileSize == getNoiseMapFileSize(header.width, header.height)) {
+    noiseMap = std::make_shared<NoiseMap>(header.width, header.height);
+    for (int i = 0; i < header.height && file; ++i) {
+      file.read(reinterpret_cast<char *>(noiseMap->row(i).data()),
+                std::streamsize(size_t(header.width) * sizeof(float)));
+    }
+  }
+
+  if (!noiseMap || !file) {
+    std::lock_guard lock(_diskMutex);
+    if (_diskCachePath == diskCachePath) {
+      removeDiskCacheFile(hash);
+    }
+    return nullptr;
+  }
+
+  // Keeps the least recently used order for the next start
+  std::error_code errorCode;
+  std::filesystem::last_write_time(filePath, std::filesystem::file_time_type::clock::now(), errorCode);
+  return noiseMap;
+}
+
+void NoiseMapCache::runDiskWrites() {
+  while (true) {
+    PendingDiskWrite pendingDiskWrite;
+    {
+      std::lock_guard lock(_diskMutex);
+      if (!_pendingDiskWrite) {
+        _isDiskWriteScheduled = false;
+        return;
+      }
+      pendingDiskWrite = std::move(*_pendingDiskWrite);
+      _pendingDiskWrite.reset();
+    }
+
+    writeToDisk(pendingDiskWrite.hash, *pendingDiskWrite.noiseMap);
+  }
+}
+
+void NoiseMapCache::writeToDisk(const uint64_t hash, const NoiseMap &noiseMap) {
+  const auto diskCachePath = this->diskCachePath();
+  if (diskCachePath.empty()) {
+    return;
+  }
+  const auto filePath = getDiskCacheFilePath(diskCachePath, hash);
+
+  NoiseMapFileHeader header = {};
+  header.magic = kNoiseMapFileMagic;
+  header.generatorVersion = kNoiseMapGeneratorVersion;
+  header.hash = hash;
+  header.width = noiseMap.width();
+  header.height = noiseMap.height();
+
+  // Written next to the final file and renamed, so a reader never sees a partially written map
+  const auto temporaryFilePath = filePath + ".tmp";
+  {
+    std::ofstream file(temporaryFilePath, std::ios::binary | std::ios::trunc);
+    file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    for (int i = 0; i < noiseMap.height(); ++i) {
+      file.write(reinterpret_cast<const char *>(noiseMap.row(i).data()),
+                 std::streamsize(size_t(noiseMap.width()) * sizeof(float)));
+    }
+  }
+
+  const auto fileSize = getNoiseMapFileSize(noiseMap.width(), noiseMap.height());
+  std::error_code errorCode;
+  if (std::filesystem::file_size(temporaryFilePath, errorCode) != fileSize) {
+    std::filesystem::remove(temporaryFilePath, errorCode);
+    return;
+  }
+
+  std::filesystem::rename(temporaryFilePath, filePath, errorCode);
+  if (errorCode) {
+    std::filesystem::remove(temporaryFilePath, errorCode);
+    return;
+  }
+
+  std::lock_guard lock(_diskMutex);
+  // The path may have changed while writing, the file then belongs to a directory that is no longer indexed
+  if (_diskCachePath != diskCachePath) {
+    return;
+  }
+  if (const auto it = _hashToDiskCacheFile.find(hash); it != _hashToDiskCacheFile.end()) {
+    _diskUsageInBytes -= it->second->sizeInBytes;
+    _diskCacheFiles.erase(it->second);
+  }
+  _diskCacheFiles.push_front({hash, fileSize});
+  _hashToDiskCacheFile[hash] = _diskCacheFiles.begin();
+  _diskUsageInBytes += fileSize;
+  evictToDiskBudget();
+}
+
+void NoiseMapCache::removeDiskCacheFile(const uint64_t hash) {
+  const auto it = _hashToDiskCacheFile.find(hash);
+  if (it == _hashToDiskCacheFile.end()) {
+    return;
+  }
+
+  std::error_code errorCode;
+  std::filesystem::remove(getDiskCacheFilePath(_diskCachePath, hash), errorCode);
+  _diskUsageInBytes -= it->second->sizeInBytes;
+  _diskCacheFiles.erase(it->second);
+  _hashToDiskCacheFile.erase(it);
+}
+
+void NoiseMapCache::evictToDiskBudget() {
+  while (_diskUsageInBytes > _diskBudgetInBytes && !_diskCacheFiles.empty()) {
+    removeDiskCacheFile(_diskCacheFiles.back().hash);
+  }
+}
+
+NoiseMapCache &getNoiseMapCache() {
+  // The pool has to outlive the cache, which waits for its last write when it is destroyed
+  getThreadPool();
+  static NoiseMapCache noiseMapCache(kDefaultNoiseMapCacheBudget, kDefaultNoiseMapDiskCacheBudget);
+  return noiseMapCache;
+}
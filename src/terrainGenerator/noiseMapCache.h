@@ -0,0 +1,96 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <unordered_map>
+
+#include "heightfieldCache.h"
+#include "noiseMapGenerator.h"
+#include "threadPool.h"
+
+// Stable across runs and machines with the same SIMD level: covers every NoiseMapData field, the falloff
+// flag and kNoiseMapGeneratorVersion
+uint64_t getNoiseMapHash(const NoiseMapData &noiseMapData, const bool useFalloffMap);
+
+// Content addressed cache of generated noise maps. The first tier keeps recent maps in memory within a
+// budget, the second stores maps as raw float files named after their hash within a disk budget, evicting
+// the least recently used files. Files found again (also after a restart) are read back in to memory.
+//
+// Files are written by a background job, so inserting never waits for the disk. Only the newest map waiting
+// to be written is kept, maps replaced while a write is in flight (dragging a slider) stay in memory only.
+class NoiseMapCache {
+public:
+  NoiseMapCache(const size_t memoryBudgetInBytes, const size_t diskBudgetInBytes);
+  // Waits for the write in flight, maps still waiting are not written
+  ~NoiseMapCache();
+
+  std::shared_ptr<const NoiseMap> find(const NoiseMapData &noiseMapData, const bool useFalloffMap);
+  void insert(const NoiseMapData &noiseMapData, const bool useFalloffMap,
+              std::shared_ptr<const NoiseMap> noiseMap);
+
+  // Empty disables the disk tier. Files already in the directory are indexed, by last write time for the
+  // least recently used order.
+  void setDiskCachePath(const std::string &diskCachePath);
+  std::string diskCachePath() const;
+
+  void setDiskBudget(const size_t diskBudgetInBytes);
+  size_t diskBudget() const;
+  size_t diskUsage() const;
+  size_t diskMapCount() const;
+
+  void setMemoryBudget(const size_t memoryBudgetInBytes) {
+    _memoryCache.setMemoryBudget(memoryBudgetInBytes);
+  }
+  size_t memoryBudget() const { return _memoryCache.memoryBudget(); }
+  size_t memoryUsage() const { return _memoryCache.memoryUsage(); }
+  size_t mapCount() const { return _memoryCache.size(); }
+  // Clears the memory tier only, files on disk are kept
+  void clear() { _memoryCache.clear(); }
+
+  uint64_t memoryHitCount() const { return _memoryHitCount; }
+  uint64_t diskHitCount() const { return _diskHitCount; }
+  uint64_t missCount() const { return _missCount; }
+
+private:
+  struct DiskCacheFile {
+    uint64_t hash;
+    size_t sizeInBytes;
+  };
+
+  struct PendingDiskWrite {
+    uint64_t hash;
+    std::shared_ptr<const NoiseMap> noiseMap;
+  };
+
+  std::shared_ptr<const NoiseMap> readFromDisk(const uint64_t hash);
+  void runDiskWrites();
+  void writeToDisk(const uint64_t hash, const NoiseMap &noiseMap);
+  // Both expect _diskMutex to be locked
+  void removeDiskCacheFile(const uint64_t hash);
+  void evictToDiskBudget();
+
+  HeightfieldCache<uint64_t> _memoryCache;
+
+  mutable std::mutex _diskMutex;
+  std::string _diskCachePath;
+  size_t _diskBudgetInBytes;
+  size_t _diskUsageInBytes = 0;
+  std::list<DiskCacheFile> _diskCacheFiles; // Most recently used first
+  std::unordered_map<uint64_t, std::list<DiskCacheFile>::iterator> _hashToDiskCacheFile;
+  std::optional<PendingDiskWrite> _pendingDiskWrite;
+  bool _isDiskWriteScheduled = false;
+  JobHandle _diskWriteJob; // The last write job, only used on the thread that inserts maps
+
+  std::atomic<uint64_t> _memoryHitCount = 0;
+  std::atomic<uint64_t> _diskHitCount = 0;
+  std::atomic<uint64_t> _missCount = 0;
+};
+
+// Shared cache used by the UI, 512 MiB in memory and 2 GiB on disk by default, with no disk tier until a
+// path is set
+NoiseMapCache &getNoiseMapCache();
@@ -1,124 +1,666 @@
 #include "noiseMapGenerator.h"
 
 #include "FastNoise/FastNoise.h"
+#include "FastNoiseSIMD/FastNoiseSIMD.h"
 #include "falloffMapGenerator.h"
+#include "heightfieldKernels.h"
+#include "linearArena.h"
+#include "memoryTracking.h"
+#include "noiseLayerCache.h"
+#include "profiler.h"
+#include "threadPool.h"
+#include <algorithm>
 #include <array>
+#include <cstring>
 #include <memory>
 #include <numeric>
 #include <random>
 
-/*
-NoiseMap generateNoiseMapSIMD(const NoiseMapData &noiseMapData) {
-  std::unique_ptr<FastNoiseSIMD> myNoise(FastNoiseSIMD::NewFastNoiseSIMD(noiseMapData.seed));
+// FastNoise scales every coordinate by its default frequency, the SIMD backend has to do the same
+static constexpr auto kPerlinFrequency = 0.01f;
 
-  myNoise.get()->SetFractalOctaves(noiseMapData.octaves);
-  myNoise.get()->SetFractalLacunarity(noiseMapData.lacunarity);
-  myNoise.get()->SetFractalGain(noiseMapData.persistance);
+// 128x128 floats (64 KiB) per tile keeps a tile and its scratch rows in L2 while it is processed
+static constexpr auto kNoiseMapTileSize = 128;
 
-  const auto perlinFractal =
-      myNoise.get()->GetPerlinFractalSet(0, 0, 0, noiseMapData.width, noiseMapData.height, 1, noiseMapData.scale);
+struct NoiseMapTile {
+  int x, y;
+  int width, height;
+};
 
-  std::vector<std::vector<float>> noiseMap;
-  noiseMap.reserve(noiseMapData.height);
+struct NoiseRange {
+  float min = std::numeric_limits<float>::max();
+  float max = std::numeric_limits<float>::lowest();
+};
 
-  float maxNoiseHeight = std::numeric_limits<float>::min();
-  float minNoiseHeight = std::numeric_limits<float>::max();
+// Samples one unweighted octave of Perlin noise for a segment of a map row, step texels apart
+class OctaveRowSampler {
+public:
+  OctaveRowSampler(const NoiseMapData &noiseMapData, const int maxRowWidth, const int step = 1)
+      : _noiseMapData(noiseMapData), _fastNoise(noiseMapData.seed), _step(step) {
+    if (noiseMapData.noiseBackend == NOISE_BACKEND::SIMD) {
+      // Picks the widest instruction set supported by the CPU, set up once before samplers race on it
+      getNoiseSIMDLevel();
+      _fastNoiseSIMD.reset(FastNoiseSIMD::NewFastNoiseSIMD(noiseMapData.seed));
+      _fastNoiseSIMD->SetNoiseType(FastNoiseSIMD::Perlin);
 
-  int index = 0;
-  for (int i = 0; i < noiseMapData.height; ++i) {
-    std::vector<float> noiseValues;
-    noiseValues.reserve(noiseMapData.width);
-    for (int j = 0; j < noiseMapData.width; ++j) {
-      const auto noiseHeight = perlinFractal[index++];
+      // FastNoiseSIMD evaluates (position + offset) * frequency
+      _rowVectorSet.SetSize(maxRowWidth);
+      for (int j = 0; j < maxRowWidth; ++j) {
+        _rowVectorSet.xSet[j] = float(j * step);
+        _rowVectorSet.ySet[j] = 0.0f;
+        _rowVectorSet.zSet[j] = 0.0f;
+      }
+    } else {
+      _fastNoise.SetNoiseType(FastNoise::Perlin);
+    }
+  }
+
+  // noiseValues must be 64-byte aligned and padded to a multiple of 16 floats, the SIMD backend
+  // writes whole vectors
+  void sample(const float frequency, const int x, const int y, const int width, float *noiseValues) {
+    const auto halfMapWidth = _noiseMapData.width / 2;
+    const auto halfMapHeight = halfMapWidth;
+
+    if (_fastNoiseSIMD) {
+      assert(width == _rowVectorSet.size);
 
-      if (noiseHeight > maxNoiseHeight)
-        maxNoiseHeight = noiseHeight;
-      else if (noiseHeight < minNoiseHeight)
-        minNoiseHeight = noiseHeight;
+      // Same offsets as the scalar path, the division by scale is folded in to the frequency
+      const auto offsetX = x - halfMapWidth + _noiseMapData.octaveOffset.x;
+      const auto offsetY = y - halfMapHeight - _noiseMapData.octaveOffset.y;
 
-      noiseValues.push_back(noiseHeight);
+      _fastNoiseSIMD->SetFrequency(kPerlinFrequency * frequency / _noiseMapData.scale);
+      _fastNoiseSIMD->FillNoiseSet(noiseValues, &_rowVectorSet, offsetX, offsetY, 0.0f);
+      return;
+    }
+
+    for (int j = 0; j < width; ++j) {
+      // Minus half map dimensions to scale in to the center instead of corner
+      const auto sampleX =
+          (x + j * _step - halfMapWidth + _noiseMapData.octaveOffset.x) / _noiseMapData.scale * frequency;
+      const auto sampleY = (y - halfMapHeight - _noiseMapData.octaveOffset.y) / _noiseMapData.scale * frequency;
+      noiseValues[j] = _fastNoise.GetNoise(sampleX, sampleY);
     }
-    noiseMap.push_back(noiseValues);
   }
 
-  FastNoiseSIMD::FreeNoiseSet(perlinFractal);
+private:
+  const NoiseMapData &_noiseMapData;
+  FastNoise _fastNoise;
+  std::unique_ptr<FastNoiseSIMD> _fastNoiseSIMD;
+  FastNoiseVectorSet _rowVectorSet;
+  int _step;
+};
 
-  const auto noiseHeightDiffInverse = 1.0f / (maxNoiseHeight - minNoiseHeight);
-  for (size_t i = 0; i < noiseMapData.height; ++i) {
-    for (size_t j = 0; j < noiseMapData.width; ++j) {
-      noiseMap[i][j] = (noiseMap[i][j] - minNoiseHeight) * noiseHeightDiffInverse;
+static std::vector<NoiseMapTile> splitInToTiles(const int mapWidth, const int mapHeight) {
+  std::vector<NoiseMapTile> tiles;
+  for (int y = 0; y < mapHeight; y += kNoiseMapTileSize) {
+    for (int x = 0; x < mapWidth; x += kNoiseMapTileSize) {
+      tiles.push_back(
+          {x, y, std::min(kNoiseMapTileSize, mapWidth - x), std::min(kNoiseMapTileSize, mapHeight - y)});
     }
   }
+  return tiles;
+}
 
-  return noiseMap;
-}*/
+// Kernels work on groups of 4 floats, tiles ending at the map edge spill in to the row padding
+static int getPaddedWidth(const int width) { return (width + 3) & ~3; }
+
+static float getOctaveFrequency(const NoiseMapData &noiseMapData, const int octave) {
+  float frequency = 1.0f;
+  for (int i = 0; i < octave; ++i) {
+    frequency *= noiseMapData.lacunarity;
+  }
+  return frequency;
+}
 
-static float getCurveValue(const float value) {
-  return ((-0.635179f * value * value * value * value) + (2.35243f * value * value) + (-0.72331f * value) + -0.000937f);
+static NoiseRange getNoiseRowRange(const std::span<const float> noiseValues, NoiseRange noiseRange) {
+  const auto [minNoiseValue, maxNoiseValue] = std::minmax_element(noiseValues.begin(), noiseValues.end());
+  noiseRange.min = std::min(noiseRange.min, *minNoiseValue);
+  noiseRange.max = std::max(noiseRange.max, *maxNoiseValue);
+  return noiseRange;
 }
 
-NoiseMap generateNoiseMap(const NoiseMapData &noiseMapData, const bool useFalloffMap) {
-  assert(noiseMapData.width == noiseMapData.height);
+// Zeroed row of at least width floats, aligned and padded like a Heightfield row
+static std::span<float> allocateScratchRow(LinearArena *arena, const int width) {
+  constexpr auto kStrideAlignment = Heightfield::kStrideAlignment;
+  const auto paddedWidth = (width + kStrideAlignment - 1) / kStrideAlignment * kStrideAlignment;
+  const auto row = arena->allocateArray<float>(size_t(paddedWidth), Heightfield::kAlignment);
+  std::fill(row.begin(), row.end(), 0.0f);
+  return row;
+}
+
+// Weighted octave sum of width texels of map row y starting at x, the sampler decides how far apart they are.
+// Rows are accumulated in aligned scratch rows since the texels do not have to start on a SIMD boundary.
+static void sampleNoiseRow(const NoiseMapData &noiseMapData, const int x, const int y, const int width,
+                           OctaveRowSampler *octaveRowSampler, const std::span<float> octaveNoiseValues,
+                           const std::span<float> noiseValues) {
+  std::fill(noiseValues.begin(), noiseValues.end(), 0.0f);
 
-  FastNoise fastNoise(noiseMapData.seed);
-  fastNoise.SetNoiseType(FastNoise::Perlin);
+  float amplitude = 1.0f;
+  float frequency = 1.0f;
+  for (int octave = 0; octave < noiseMapData.octaves; ++octave) {
+    octaveRowSampler->sample(frequency, x, y, width, octaveNoiseValues.data());
+    addWeightedRow(noiseValues.data(), octaveNoiseValues.data(), amplitude, getPaddedWidth(width));
 
-  std::vector<std::vector<float>> noiseMap;
-  noiseMap.reserve(noiseMapData.height);
+    amplitude *= noiseMapData.persistance;
+    frequency *= noiseMapData.lacunarity;
+  }
+}
 
-  const auto halfMapWidth = noiseMapData.width / 2;
-  const auto halfMapHeight = halfMapWidth;
+// Samples the weighted octave sum of any rectangle of a map whose texels are step full resolution
+// texels apart
+static void sampleNoiseTile(const NoiseMapData &noiseMapData, const NoiseMapTile &tile, const int step,
+                            NoiseMap *noiseMap) {
+  PROFILE_ZONE("Sample noise tile");
 
-  float maxNoiseHeight = std::numeric_limits<float>::min();
-  float minNoiseHeight = std::numeric_limits<float>::max();
+  OctaveRowSampler octaveRowSampler(noiseMapData, tile.width, step);
+  ScratchArenaScope scratch;
+  const auto octaveNoiseValues = allocateScratchRow(&scratch.arena(), tile.width);
+  const auto noiseValues = allocateScratchRow(&scratch.arena(), tile.width);
 
-  for (int i = 0; i < noiseMapData.height; ++i) {
-    std::vector<float> noiseValues;
-    noiseValues.reserve(noiseMapData.width);
-    for (int j = 0; j < noiseMapData.width; ++j) {
-      float amplitude = 1.0f;
-      float frequency = 1.0f;
-      float noiseHeight = 0.0f;
+  for (int i = tile.y; i < tile.y + tile.height; ++i) {
+    sampleNoiseRow(noiseMapData, tile.x * step, i * step, tile.width, &octaveRowSampler, octaveNoiseValues,
+                   noiseValues);
+    std::copy_n(noiseValues.data(), tile.width, noiseMap->row(i).data() + tile.x);
+  }
+}
 
-      for (int octave = 0; octave < noiseMapData.octaves; ++octave) {
-        // Minus half map dimensions to scale in to the center instead of corner
-        const auto sampleX = (j - halfMapWidth + noiseMapData.octaveOffset.x) / noiseMapData.scale * frequency;
-        const auto sampleY = (i - halfMapHeight - noiseMapData.octaveOffset.y) / noiseMapData.scale * frequency;
+// Texels on even rows and columns of a level were already sampled by the next coarser level, only the other
+// three quarters are sampled
+static void refineNoiseTile(const NoiseMapData &noiseMapData, const NoiseMapTile &tile, const int step,
+                            const NoiseMap &coarserNoiseMap, NoiseMap *noiseMap) {
+  assert(tile.x % 2 == 0 && tile.y % 2 == 0);
+  PROFILE_ZONE("Refine noise tile");
 
-        const auto perlinNoiseValue = fastNoise.GetNoise(sampleX, sampleY);
-        noiseHeight += perlinNoiseValue * amplitude;
+  const auto oddColumnCount = tile.width / 2;
+  OctaveRowSampler rowSampler(noiseMapData, tile.width, step);
+  OctaveRowSampler oddColumnSampler(noiseMapData, std::max(1, oddColumnCount), 2 * step);
+  ScratchArenaScope scratch;
+  const auto octaveNoiseValues = allocateScratchRow(&scratch.arena(), tile.width);
+  const auto noiseValues = allocateScratchRow(&scratch.arena(), tile.width);
 
+  for (int i = tile.y; i < tile.y + tile.height; ++i) {
+    const auto levelNoiseValues = noiseMap->row(i);
+
+    if (i % 2 == 1) {
+      sampleNoiseRow(noiseMapData, tile.x * step, i * step, tile.width, &rowSampler, octaveNoiseValues,
+                     noiseValues);
+      std::copy_n(noiseValues.data(), tile.width, levelNoiseValues.data() + tile.x);
+      continue;
+    }
+
+    const auto coarserNoiseValues = coarserNoiseMap.row(i / 2);
+    for (int j = tile.x; j < tile.x + tile.width; j += 2) {
+      levelNoiseValues[j] = coarserNoiseValues[j / 2];
+    }
+
+    if (oddColumnCount > 0) {
+      sampleNoiseRow(noiseMapData, (tile.x + 1) * step, i * step, oddColumnCount, &oddColumnSampler,
+                     octaveNoiseValues, noiseValues);
+      for (int j = 0; j < oddColumnCount; ++j) {
+        levelNoiseValues[tile.x + 1 + 2 * j] = noiseValues.data()[j];
+      }
+    }
+  }
+}
+
+static NoiseRange getNoiseTileRange(const NoiseMap &noiseMap, const NoiseMapTile &tile) {
+  NoiseRange noiseRange;
+  for (int i = tile.y; i < tile.y + tile.height; ++i) {
+    noiseRange = getNoiseRowRange(noiseMap.row(i).subspan(tile.x, tile.width), noiseRange);
+  }
+  return noiseRange;
+}
+
+static bool isGenerationCancelled(const NoiseMapGenerationContext &context) {
+  return context.isCancelled && context.isCancelled();
+}
+
+static NoiseLayer sampleNoiseLayer(const NoiseMapData &noiseMapData, const std::vector<NoiseMapTile> &tiles,
+                                   const int octave, const NoiseMapGenerationContext &context,
+                                   ThreadPool *threadPool) {
+  // Layers are only kept by the layer cache
+  MemoryTagScope memoryTagScope(MEMORY_TAG::CACHES);
+  auto noiseLayer = std::make_shared<Heightfield>(noiseMapData.width, noiseMapData.height);
+  const auto frequency = getOctaveFrequency(noiseMapData, octave);
+
+  threadPool->parallelFor(int(tiles.size()), [&](const int tileIndex) {
+    if (isGenerationCancelled(context)) {
+      return;
+    }
+
+    PROFILE_ZONE("Sample noise layer tile");
+    const auto &tile = tiles[tileIndex];
+    OctaveRowSampler octaveRowSampler(noiseMapData, tile.width);
+    for (int i = tile.y; i < tile.y + tile.height; ++i) {
+      octaveRowSampler.sample(frequency, tile.x, i, tile.width, noiseLayer->row(i).data() + tile.x);
+    }
+  });
+
+  return isGenerationCancelled(context) ? nullptr : noiseLayer;
+}
+
+// Sums cached octave layers in the same order as sampleNoiseTile, so both give identical maps
+// Layers completed before a cancellation stay in the cache for the next generation
+static std::vector<NoiseRange> blendNoiseLayers(const NoiseMapData &noiseMapData,
+                                                const std::vector<NoiseMapTile> &tiles,
+                                                const NoiseMapGenerationContext &context,
+                                                ThreadPool *threadPool, NoiseMap *noiseMap) {
+  auto noiseLayerCache = context.noiseLayerCache;
+
+  std::vector<NoiseLayer> noiseLayers;
+  for (int octave = 0; octave < noiseMapData.octaves; ++octave) {
+    const auto noiseLayerKey = createNoiseLayerKey(noiseMapData, octave);
+    auto noiseLayer = noiseLayerCache->find(noiseLayerKey);
+    if (!noiseLayer) {
+      noiseLayer = sampleNoiseLayer(noiseMapData, tiles, octave, context, threadPool);
+      if (!noiseLayer) {
+        return {};
+      }
+      noiseLayerCache->insert(noiseLayerKey, noiseLayer);
+    }
+    noiseLayers.push_back(std::move(noiseLayer));
+  }
+
+  std::vector<NoiseRange> tileNoiseRanges(tiles.size());
+  threadPool->parallelFor(int(tiles.size()), [&](const int tileIndex) {
+    if (isGenerationCancelled(context)) {
+      return;
+    }
+
+    PROFILE_ZONE("Blend noise layers");
+    const auto &tile = tiles[tileIndex];
+    for (int i = tile.y; i < tile.y + tile.height; ++i) {
+      float amplitude = 1.0f;
+      for (const auto &noiseLayer : noiseLayers) {
+        addWeightedRow(noiseMap->row(i).data() + tile.x, noiseLayer->row(i).data() + tile.x, amplitude,
+                       getPaddedWidth(tile.width));
         amplitude *= noiseMapData.persistance;
-        frequency *= noiseMapData.lacunarity;
       }
 
-      if (noiseHeight > maxNoiseHeight)
-        maxNoiseHeight = noiseHeight;
-      else if (noiseHeight < minNoiseHeight)
-        minNoiseHeight = noiseHeight;
+      tileNoiseRanges[tileIndex] =
+          getNoiseRowRange(noiseMap->row(i).subspan(tile.x, tile.width), tileNoiseRanges[tileIndex]);
+    }
+  });
+
+  return tileNoiseRanges;
+}
+
+// Normalisation and height curve are only applied in the post-process, they do not change the raw noise
+static bool hasSameRawNoise(const NoiseMapData &noiseMapData, const NoiseMapData &otherNoiseMapData) {
+  auto rawNoiseMapData = noiseMapData;
+  rawNoiseMapData.normalization = otherNoiseMapData.normalization;
+  rawNoiseMapData.worldNoiseRange = otherNoiseMapData.worldNoiseRange;
+  rawNoiseMapData.heightCurve = otherNoiseMapData.heightCurve;
+  return rawNoiseMapData == otherNoiseMapData;
+}
+
+// A change of octaveOffset by whole texels moves the map content without changing any sample. Returns
+// false if anything else affecting the raw noise changed or nothing of the previous map stays visible.
+static bool getNoiseMapShift(const NoiseMapData &previousNoiseMapData, const NoiseMapData &noiseMapData,
+                             glm::ivec2 *shift) {
+  auto offsetOnlyNoiseMapData = noiseMapData;
+  offsetOnlyNoiseMapData.octaveOffset = previousNoiseMapData.octaveOffset;
+  if (!hasSameRawNoise(offsetOnlyNoiseMapData, previousNoiseMapData)) {
+    return false;
+  }
+
+  const auto offsetChange = noiseMapData.octaveOffset - previousNoiseMapData.octaveOffset;
+  if (offsetChange != glm::round(offsetChange)) {
+    return false;
+  }
+
+  // New texel (j, i) samples what the previous map stored at (j + shift.x, i + shift.y)
+  *shift = glm::ivec2(int(offsetChange.x), -int(offsetChange.y));
+  return std::abs(shift->x) < noiseMapData.width && std::abs(shift->y) < noiseMapData.height;
+}
+
+// Moves the content of the raw map in place and samples the rows and columns that scrolled in to view
+static void scrollNoiseMap(const NoiseMapData &noiseMapData, const glm::ivec2 &shift, ThreadPool *threadPool,
+                           NoiseMap *noiseMap) {
+  if (shift == glm::ivec2(0)) {
+    return;
+  }
+  PROFILE_ZONE("Scroll noise map");
 
-      noiseValues.push_back(noiseHeight);
+  const auto width = noiseMapData.width;
+  const auto height = noiseMapData.height;
+  const auto keptWidth = width - std::abs(shift.x);
+  const auto keptHeight = height - std::abs(shift.y);
+
+  const auto moveRow = [&](const int i) {
+    std::memmove(noiseMap->row(i).data() + std::max(0, -shift.x),
+                 noiseMap->row(i + shift.y).data() + std::max(0, shift.x), keptWidth * sizeof(float));
+  };
+
+  // Walk away from the rows being read so no source row is overwritten before it is moved
+  if (shift.y >= 0) {
+    for (int i = 0; i < keptHeight; ++i) {
+      moveRow(i);
+    }
+  } else {
+    for (int i = height - 1; i >= height - keptHeight; --i) {
+      moveRow(i);
     }
-    noiseMap.push_back(noiseValues);
   }
 
-  FalloffMap falloffMap;
-  if (useFalloffMap) {
-    falloffMap = generateFalloffMap(noiseMapData.width);
+  const auto keptRowsBegin = std::max(0, -shift.y);
+  const auto exposedRowsBegin = shift.y >= 0 ? keptHeight : 0;
+  const auto exposedColumnsBegin = shift.x >= 0 ? keptWidth : 0;
+
+  std::vector<NoiseMapTile> exposedTiles;
+  for (const auto &tile : splitInToTiles(width, std::abs(shift.y))) {
+    exposedTiles.push_back({tile.x, exposedRowsBegin + tile.y, tile.width, tile.height});
   }
+  for (const auto &tile : splitInToTiles(std::abs(shift.x), keptHeight)) {
+    exposedTiles.push_back({exposedColumnsBegin + tile.x, keptRowsBegin + tile.y, tile.width, tile.height});
+  }
+
+  threadPool->parallelFor(int(exposedTiles.size()), [&](const int tileIndex) {
+    sampleNoiseTile(noiseMapData, exposedTiles[tileIndex], 1, noiseMap);
+  });
+}
 
-  const auto noiseHeightDiffInverse = 1.0f / (maxNoiseHeight - minNoiseHeight);
-  for (size_t i = 0; i < noiseMapData.height; ++i) {
-    for (size_t j = 0; j < noiseMapData.width; ++j) {
-      noiseMap[i][j] = (noiseMap[i][j] - minNoiseHeight) * noiseHeightDiffInverse;
+static void postProcessNoiseTile(const NoiseRange &noiseRange, const Heightfield *falloffMap,
+                                 const HeightCurveTable &heightCurveTable, const NoiseMapTile &tile,
+                                 NoiseMap *noiseMap) {
+  PROFILE_ZONE("Normalize noise tile");
+
+  const auto noiseHeightDiffInverse = 1.0f / (noiseRange.max - noiseRange.min);
+  const auto paddedWidth = getPaddedWidth(tile.width);
+  for (int i = tile.y; i < tile.y + tile.height; ++i) {
+    const auto falloffValues = falloffMap != nullptr ? falloffMap->row(i).data() + tile.x : nullptr;
+    postProcessNoiseRow(noiseMap->row(i).data() + tile.x, falloffValues, noiseRange.min,
+                        noiseHeightDiffInverse, heightCurveTable.data(), int(heightCurveTable.size()),
+                        paddedWidth);
+  }
+}
+
+// Perlin noise is within [-1, 1], so the weighted octave sum is within the sum of the amplitudes
+static NoiseRange getFractalNoiseRange(const NoiseMapData &noiseMapData) {
+  float amplitude = 1.0f;
+  float amplitudeSum = 0.0f;
+  for (int octave = 0; octave < noiseMapData.octaves; ++octave) {
+    amplitudeSum += amplitude;
+    amplitude *= noiseMapData.persistance;
+  }
+  return {-amplitudeSum, amplitudeSum};
+}
 
-      if (useFalloffMap) {
-        noiseMap[i][j] = glm::clamp(noiseMap[i][j] - falloffMap[noiseMapData.width * j + i].x, 0.0f, 1.0f);
+static NoiseRange getNormalizationRange(const NoiseMapData &noiseMapData,
+                                        const std::vector<NoiseRange> &tileNoiseRanges) {
+  switch (noiseMapData.normalization) {
+  case NOISE_NORMALIZATION::FRACTAL_BOUNDS:
+    return getFractalNoiseRange(noiseMapData);
+  case NOISE_NORMALIZATION::WORLD_RANGE:
+    return {noiseMapData.worldNoiseRange.x, noiseMapData.worldNoiseRange.y};
+  case NOISE_NORMALIZATION::LOCAL:
+    break;
+  default:
+    assert(false);
+    break;
+  }
+
+  NoiseRange noiseRange;
+  for (const auto &tileNoiseRange : tileNoiseRanges) {
+    noiseRange.min = std::min(noiseRange.min, tileNoiseRange.min);
+    noiseRange.max = std::max(noiseRange.max, tileNoiseRange.max);
+  }
+  return noiseRange;
+}
+
+// Normalisation, falloff and curve in a single pass over each tile while it is still in cache
+static void postProcessNoiseMap(const NoiseMapData &noiseMapData, const std::vector<NoiseMapTile> &tiles,
+                                const std::vector<NoiseRange> &tileNoiseRanges, const Heightfield *falloffMap,
+                                const NoiseMapGenerationContext &context, ThreadPool *threadPool,
+                                NoiseMap *noiseMap) {
+  const auto noiseRange = getNormalizationRange(noiseMapData, tileNoiseRanges);
+
+  const auto heightCurveTable = bakeHeightCurve(noiseMapData.heightCurve);
+
+  threadPool->parallelFor(int(tiles.size()), [&](const int tileIndex) {
+    if (isGenerationCancelled(context)) {
+      return;
+    }
+
+    postProcessNoiseTile(noiseRange, falloffMap, heightCurveTable, tiles[tileIndex], noiseMap);
+  });
+}
+
+NoiseMap generateNoiseMap(const NoiseMapData &noiseMapData, const bool useFalloffMap,
+                          const NoiseMapGenerationContext &context) {
+  assert(noiseMapData.width == noiseMapData.height);
+  PROFILE_ZONE("Generate noise map");
+  MemoryTagScope memoryTagScope(MEMORY_TAG::NOISE_MAPS);
+
+  auto threadPool = context.threadPool != nullptr ? context.threadPool : &getThreadPool();
+
+  const auto tiles = splitInToTiles(noiseMapData.width, noiseMapData.height);
+
+  // Every texel only depends on its own coordinates and the min/max reduction is exact, so the result
+  // is the same for any number of threads
+  NoiseMap noiseMap;
+  std::vector<NoiseRange> tileNoiseRanges(tiles.size());
+
+  // Scrolling is cheap and changes the raw map in place, so it always runs to completion. Everything else
+  // only touches the raw map once sampling is done.
+  glm::ivec2 shift;
+  auto rawNoiseMap = context.rawNoiseMap;
+  if (rawNoiseMap != nullptr && !rawNoiseMap->noiseMap.empty() &&
+      getNoiseMapShift(rawNoiseMap->noiseMapData, noiseMapData, &shift)) {
+    scrollNoiseMap(noiseMapData, shift, threadPool, &rawNoiseMap->noiseMap);
+    rawNoiseMap->noiseMapData = noiseMapData;
+    threadPool->parallelFor(int(tiles.size()), [&](const int tileIndex) {
+      tileNoiseRanges[tileIndex] = getNoiseTileRange(rawNoiseMap->noiseMap, tiles[tileIndex]);
+    });
+    noiseMap = rawNoiseMap->noiseMap.clone();
+  } else {
+    noiseMap = NoiseMap(noiseMapData.width, noiseMapData.height);
+    if (context.noiseLayerCache != nullptr) {
+      tileNoiseRanges = blendNoiseLayers(noiseMapData, tiles, context, threadPool, &noiseMap);
+    } else {
+      threadPool->parallelFor(int(tiles.size()), [&](const int tileIndex) {
+        if (isGenerationCancelled(context)) {
+          return;
+        }
+
+        sampleNoiseTile(noiseMapData, tiles[tileIndex], 1, &noiseMap);
+        tileNoiseRanges[tileIndex] = getNoiseTileRange(noiseMap, tiles[tileIndex]);
+      });
+    }
+
+    if (isGenerationCancelled(context)) {
+      return NoiseMap();
+    }
+
+    if (rawNoiseMap != nullptr) {
+      rawNoiseMap->noiseMapData = noiseMapData;
+      rawNoiseMap->noiseMap = noiseMap.clone();
+    }
+  }
+
+  const auto falloffMap = useFalloffMap ? getFalloffMap(noiseMapData.width) : nullptr;
+  postProcessNoiseMap(noiseMapData, tiles, tileNoiseRanges, falloffMap.get(), context, threadPool, &noiseMap);
+
+  if (isGenerationCancelled(context)) {
+    return NoiseMap();
+  }
+
+  return noiseMap;
+}
+
+bool canReuseRawNoiseMap(const RawNoiseMap &rawNoiseMap, const NoiseMapData &noiseMapData) {
+  glm::ivec2 shift;
+  return !rawNoiseMap.noiseMap.empty() && getNoiseMapShift(rawNoiseMap.noiseMapData, noiseMapData, &shift);
+}
+
+int getNoiseMapLevelSize(const int mapSize, const int level) { return std::max(1, mapSize >> level); }
+
+NoiseMap generateNoiseMapLevel(const NoiseMapData &noiseMapData, const bool useFalloffMap, const int level,
+                               const NoiseMapGenerationContext &context, RawNoiseMapLevel *rawNoiseMapLevel) {
+  assert(noiseMapData.width == noiseMapData.height && level >= 0);
+  PROFILE_ZONE("Generate noise map level");
+  MemoryTagScope memoryTagScope(MEMORY_TAG::NOISE_MAPS);
+
+  auto threadPool = context.threadPool != nullptr ? context.threadPool : &getThreadPool();
+
+  const auto step = 1 << level;
+  const auto levelSize = getNoiseMapLevelSize(noiseMapData.width, level);
+  const auto tiles = splitInToTiles(levelSize, levelSize);
+
+  const auto &coarserNoiseMap = rawNoiseMapLevel->noiseMap;
+  const auto canRefineCoarserLevel = rawNoiseMapLevel->level == level + 1 &&
+                                     hasSameRawNoise(rawNoiseMapLevel->noiseMapData, noiseMapData) &&
+                                     coarserNoiseMap.width() * 2 == levelSize;
+
+  NoiseMap noiseMap(levelSize, levelSize);
+  std::vector<NoiseRange> tileNoiseRanges(tiles.size());
+  threadPool->parallelFor(int(tiles.size()), [&](const int tileIndex) {
+    if (isGenerationCancelled(context)) {
+      return;
+    }
+
+    if (canRefineCoarserLevel) {
+      refineNoiseTile(noiseMapData, tiles[tileIndex], step, coarserNoiseMap, &noiseMap);
+    } else {
+      sampleNoiseTile(noiseMapData, tiles[tileIndex], step, &noiseMap);
+    }
+    tileNoiseRanges[tileIndex] = getNoiseTileRange(noiseMap, tiles[tileIndex]);
+  });
+
+  if (isGenerationCancelled(context)) {
+    return NoiseMap();
+  }
+
+  rawNoiseMapLevel->noiseMapData = noiseMapData;
+  rawNoiseMapLevel->level = level;
+  rawNoiseMapLevel->noiseMap = noiseMap.clone();
+
+  Heightfield falloffMapLevel;
+  if (useFalloffMap) {
+    const auto falloffMap = getFalloffMap(noiseMapData.width);
+    falloffMapLevel = Heightfield(levelSize, levelSize);
+    for (int i = 0; i < levelSize; ++i) {
+      const auto falloffValues = falloffMap->row(i * step);
+      const auto falloffLevelValues = falloffMapLevel.row(i);
+      for (int j = 0; j < levelSize; ++j) {
+        falloffLevelValues[j] = falloffValues[j * step];
       }
+    }
+  }
+
+  postProcessNoiseMap(noiseMapData, tiles, tileNoiseRanges, useFalloffMap ? &falloffMapLevel : nullptr,
+                      context, threadPool, &noiseMap);
 
-      noiseMap[i][j] = glm::clamp(getCurveValue(noiseMap[i][j]), 0.0f, 1.0f);
+  if (isGenerationCancelled(context)) {
+    return NoiseMap();
+  }
+
+  return noiseMap;
+}
+
+// Samples and post-processes one tile of generateNoiseMapTiles in to a map of its own
+static NoiseMap generateStreamedNoiseTile(const NoiseMapData &noiseMapData, const bool useFalloffMap,
+                                          const NoiseRange &noiseRange,
+                                          const HeightCurveTable &heightCurveTable,
+                                          const NoiseMapTile &tile) {
+  PROFILE_ZONE("Generate streamed noise tile");
+
+  // FastNoiseSIMD rounds differently depending on where a row segment starts, so rows are sampled in the
+  // same columns of kNoiseMapTileSize texels as generateNoiseMap to give identical maps
+  NoiseMap noiseMap(tile.width, tile.height);
+  const auto firstColumnX = tile.x / kNoiseMapTileSize * kNoiseMapTileSize;
+  for (auto columnX = firstColumnX; columnX < tile.x + tile.width; columnX += kNoiseMapTileSize) {
+    const auto columnWidth = std::min(kNoiseMapTileSize, noiseMapData.width - columnX);
+    const auto copyBegin = std::max(tile.x, columnX);
+    const auto copyEnd = std::min(tile.x + tile.width, columnX + columnWidth);
+
+    OctaveRowSampler octaveRowSampler(noiseMapData, columnWidth);
+    ScratchArenaScope scratch;
+    const auto octaveNoiseValues = allocateScratchRow(&scratch.arena(), columnWidth);
+    const auto noiseValues = allocateScratchRow(&scratch.arena(), columnWidth);
+    for (int i = 0; i < tile.height; ++i) {
+      sampleNoiseRow(noiseMapData, columnX, tile.y + i, columnWidth, &octaveRowSampler, octaveNoiseValues,
+                     noiseValues);
+      std::copy(noiseValues.data() + (copyBegin - columnX), noiseValues.data() + (copyEnd - columnX),
+                noiseMap.row(i).data() + (copyBegin - tile.x));
     }
   }
 
+  const auto falloffMap =
+      useFalloffMap ? generateFalloffMapTile(noiseMapData.width, tile.x, tile.y, tile.width, tile.height)
+                    : Heightfield();
+  postProcessNoiseTile(noiseRange, useFalloffMap ? &falloffMap : nullptr, heightCurveTable,
+                       {0, 0, tile.width, tile.height}, &noiseMap);
   return noiseMap;
-}
\ No newline at end of file
+}
+
+bool generateNoiseMapTiles(const NoiseMapData &noiseMapData, const bool useFalloffMap, const int tileSize,
+                           const NoiseMapGenerationContext &context, const NoiseMapTileCallback &onTile) {
+  assert(noiseMapData.width == noiseMapData.height && tileSize > 0);
+  if (noiseMapData.normalization == NOISE_NORMALIZATION::LOCAL) {
+    return false;
+  }
+  PROFILE_ZONE("Generate noise map tiles");
+  MemoryTagScope memoryTagScope(MEMORY_TAG::NOISE_MAPS);
+
+  auto threadPool = context.threadPool != nullptr ? context.threadPool : &getThreadPool();
+
+  const auto noiseRange = getNormalizationRange(noiseMapData, {});
+  const auto heightCurveTable = bakeHeightCurve(noiseMapData.heightCurve);
+
+  // Only one row of tiles is held at a time
+  const auto tileColumnCount = (noiseMapData.width + tileSize - 1) / tileSize;
+  std::vector<NoiseMap> rowTiles(tileColumnCount);
+  for (int y = 0; y < noiseMapData.height; y += tileSize) {
+    threadPool->parallelFor(tileColumnCount, [&](const int column) {
+      if (isGenerationCancelled(context)) {
+        return;
+      }
+
+      const auto x = column * tileSize;
+      const NoiseMapTile tile = {x, y, std::min(tileSize, noiseMapData.width - x),
+                                 std::min(tileSize, noiseMapData.height - y)};
+      rowTiles[column] =
+          generateStreamedNoiseTile(noiseMapData, useFalloffMap, noiseRange, heightCurveTable, tile);
+    });
+
+    if (isGenerationCancelled(context)) {
+      return false;
+    }
+
+    for (int column = 0; column < tileColumnCount; ++column) {
+      if (!onTile(column * tileSize, y, rowTiles[column])) {
+        return false;
+      }
+    }
+  }
+
+  return true;
+}
+
+int getNoiseSIMDLevel() {
+  // Creating an instance also sets up the constants of the detected level, function local statics are
+  // initialised once even if several threads get here at the same time
+  static const auto simdLevel = [] {
+    delete FastNoiseSIMD::NewFastNoiseSIMD();
+    return FastNoiseSIMD::GetSIMDLevel();
+  }();
+  return simdLevel;
+}
+
+const char *getNoiseSIMDLevelName() {
+  switch (getNoiseSIMDLevel()) {
+  case FN_NEON:
+    return "NEON";
+  case FN_AVX512:
+    return "AVX-512";
+  case FN_AVX2:
+    return "AVX2";
+  case FN_SSE41:
+    return "SSE4.1";
+  case FN_SSE2:
+    return "SSE2";
+  default:
+    return "No SIMD";
+  }
+}
@@ -1,10 +1,31 @@
 #pragma once
+#include <cstdint>
+#include <functional>
 #include <vector>
 
 #include "falloffMapGenerator.h"
+#include "heightCurve.h"
+#include "heightfield.h"
 
 #include "glm/glm.hpp"
 
+class NoiseLayerCache;
+class ThreadPool;
+
+// Bump whenever the maps generated for the same settings change, invalidates maps cached on disk
+constexpr uint32_t kNoiseMapGeneratorVersion = 1;
+
+enum class NOISE_BACKEND { SCALAR, SIMD };
+
+// LOCAL stretches the min/max of each map to [0, 1], so maps with different offsets do not line up at
+// their borders. The other modes map the same raw noise to the same height everywhere, so any part of the
+// world can be generated separately (falloff aside, it is relative to the map).
+enum class NOISE_NORMALIZATION {
+  LOCAL,
+  FRACTAL_BOUNDS, // Analytic octave sum bounds, like FastNoise's fractal bounding
+  WORLD_RANGE     // Fixed raw noise range, worldNoiseRange
+};
+
 struct NoiseMapData {
   int width, height;
   float scale;
@@ -13,8 +34,71 @@ struct NoiseMapData {
   float lacunarity;
   int seed;
   glm::vec2 octaveOffset;
+  NOISE_BACKEND noiseBackend = NOISE_BACKEND::SCALAR;
+  NOISE_NORMALIZATION normalization = NOISE_NORMALIZATION::LOCAL;
+  glm::vec2 worldNoiseRange = glm::vec2(-1.0f, 1.0f); // Raw noise mapped to [0, 1] with WORLD_RANGE
+  HeightCurve heightCurve;
+
+  bool operator==(const NoiseMapData &other) const = default;
+};
+
+using NoiseMap = Heightfield;
+
+// Raw (summed octaves, not yet normalised) noise of the previous generation. When only octaveOffset
+// changed by whole texels the map is shifted in place and only the exposed rows and columns are sampled.
+struct RawNoiseMap {
+  NoiseMapData noiseMapData = {};
+  NoiseMap noiseMap;
 };
 
-using NoiseMap = std::vector<std::vector<float>>;
+struct NoiseMapGenerationContext {
+  ThreadPool *threadPool = nullptr; // Shared pool if not set
+  // Keeps raw octave layers between generations, so changes to persistance or a lower octave count
+  // only re-blend cached layers instead of sampling noise again
+  NoiseLayerCache *noiseLayerCache = nullptr;
+  RawNoiseMap *rawNoiseMap = nullptr;
+  // Polled between tiles. Once it returns true generation stops early and an empty map is returned,
+  // nothing partially generated is kept in the raw map or the layer cache.
+  std::function<bool()> isCancelled;
+};
+
+// Generates the map in tiles spread over the context's thread pool
+NoiseMap generateNoiseMap(const NoiseMapData &noiseMapData, const bool useFalloffMap,
+                          const NoiseMapGenerationContext &context = {});
+
+// True if generating noiseMapData with rawNoiseMap in the context only scrolls or re-post-processes it
+bool canReuseRawNoiseMap(const RawNoiseMap &rawNoiseMap, const NoiseMapData &noiseMapData);
+
+// Raw noise of a reduced resolution level, see generateNoiseMapLevel
+struct RawNoiseMapLevel {
+  NoiseMapData noiseMapData = {};
+  int level = -1;
+  NoiseMap noiseMap;
+};
+
+// max(1, mapSize >> level), the same as the size of the texture mip level
+int getNoiseMapLevelSize(const int mapSize, const int level);
+
+// Generates the map at 1 / 2^level resolution for previews, texel (j, i) is full resolution texel
+// (j << level, i << level) normalised with the min/max of the level. If rawNoiseMapLevel holds the next
+// coarser level of the same noise its samples are reused, so only three quarters of the texels are sampled.
+// Either way it receives the raw noise of this level.
+NoiseMap generateNoiseMapLevel(const NoiseMapData &noiseMapData, const bool useFalloffMap, const int level,
+                               const NoiseMapGenerationContext &context, RawNoiseMapLevel *rawNoiseMapLevel);
+
+// (x, y) is the top left texel of the tile in the map. Returning false stops the generation.
+using NoiseMapTileCallback = std::function<bool(const int x, const int y, const HeightfieldView &tile)>;
+
+// Generates the map in tileSize square tiles (smaller at the right and bottom edge) without ever holding the
+// whole map, for maps larger than memory. Each row of tiles is generated on the context's thread pool, then
+// handed to onTile on the calling thread in row-major order. The tiles are identical to the same texels of
+// generateNoiseMap, but LOCAL normalisation needs the whole map and is not supported. Returns false if the
+// normalisation is LOCAL or the generation was cancelled or stopped by onTile.
+bool generateNoiseMapTiles(const NoiseMapData &noiseMapData, const bool useFalloffMap, const int tileSize,
+                           const NoiseMapGenerationContext &context, const NoiseMapTileCallback &onTile);
 
-NoiseMap generateNoiseMap(const NoiseMapData &noiseMapData, const bool useFalloffMap);
\ No newline at end of file
+// Widest instruction set FastNoiseSIMD detected at runtime (an FN_* level), used by the SIMD backend.
+// FastNoiseSIMD detects it and sets up its constants on first use behind plain flags, this does both once
+// and is safe to call from any thread.
+int getNoiseSIMDLevel();
+const char *getNoiseSIMDLevelName();
@@ -0,0 +1,173 @@
+#include "profiler.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+// 24 bytes per zone, 768 KiB per thread
+static constexpr uint64_t kZonesPerThread = uint64_t(1) << 15;
+
+// Single producer ring, only the owning thread pushes. Readers copy without stopping it and throw away
+// whatever the owner may have overwritten in the meantime. The zone fields are relaxed atomics so these
+// concurrent copies are well defined, on x64 they are plain loads and stores.
+class ProfilerThreadBuffer {
+public:
+  explicit ProfilerThreadBuffer(const uint32_t threadId) : threadId(threadId), _zones(kZonesPerThread) {}
+
+  void push(const ProfilerZone &zone) {
+    const auto writeIndex = _writeIndex.load(std::memory_order_relaxed);
+    // A reader that copies any field below also sees writeIndex published by the previous push
+    std::atomic_thread_fence(std::memory_order_release);
+    auto &slot = _zones[writeIndex & (kZonesPerThread - 1)];
+    slot.name.store(zone.name, std::memory_order_relaxed);
+    slot.start.store(zone.start, std::memory_order_relaxed);
+    slot.end.store(zone.end, std::memory_order_relaxed);
+    _writeIndex.store(writeIndex + 1, std::memory_order_release);
+  }
+
+  std::vector<ProfilerZone> copyZones() const {
+    const auto end = _writeIndex.load(std::memory_order_acquire);
+    const auto begin = end > kZonesPerThread ? end - kZonesPerThread : 0;
+
+    std::vector<ProfilerZone> zones;
+    zones.reserve(size_t(end - begin));
+    for (auto i = begin; i < end; ++i) {
+      const auto &slot = _zones[i & (kZonesPerThread - 1)];
+      zones.push_back({slot.name.load(std::memory_order_relaxed), slot.start.load(std::memory_order_relaxed),
+                       slot.end.load(std::memory_order_relaxed)});
+    }
+
+    // One more than the owner has published may be half written
+    std::atomic_thread_fence(std::memory_order_acquire);
+    const auto endAfterCopy = _writeIndex.load(std::memory_order_relaxed) + 1;
+    const auto firstIntact = endAfterCopy > kZonesPerThread ? endAfterCopy - kZonesPerThread : 0;
+    if (firstIntact > begin) {
+      zones.erase(zones.begin(), zones.begin() + size_t(std::min(firstIntact - begin, end - begin)));
+    }
+    return zones;
+  }
+
+  const uint32_t threadId;
+  std::string threadName; // Guarded by threadBuffersMutex
+
+private:
+  struct ZoneSlot {
+    std::atomic<const char *> name = nullptr;
+    std::atomic<uint64_t> start = 0;
+    std::atomic<uint64_t> end = 0;
+  };
+
+  std::vector<ZoneSlot> _zones;
+  std::atomic<uint64_t> _writeIndex = 0;
+};
+
+struct ProfilerClockReference {
+  uint64_t timestamp;
+  std::chrono::steady_clock::time_point time;
+};
+
+static const ProfilerClockReference clockReference = {getProfilerTimestamp(),
+                                                      std::chrono::steady_clock::now()};
+
+// Buffers live until exit, so a thread's zones can still be exported after it ended
+static std::mutex threadBuffersMutex;
+static std::vector<std::unique_ptr<ProfilerThreadBuffer>> threadBuffers;
+static thread_local ProfilerThreadBuffer *threadBuffer = nullptr;
+
+static ProfilerThreadBuffer *getThreadBuffer() {
+  if (threadBuffer == nullptr) {
+    std::lock_guard lock(threadBuffersMutex);
+    threadBuffers.push_back(std::make_unique<ProfilerThreadBuffer>(uint32_t(threadBuffers.size()) + 1));
+    threadBuffer = threadBuffers.back().get();
+  }
+  return threadBuffer;
+}
+
+double getProfilerTicksPerNanosecond() {
+#ifdef PROFILER_RDTSC
+  // The longer since the reference the more accurate the ratio, but a few milliseconds are enough
+  auto time = std::chrono::steady_clock::now();
+  while (time - clockReference.time < std::chrono::milliseconds(10)) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    time = std::chrono::steady_clock::now();
+  }
+  const auto timestamp = getProfilerTimestamp();
+
+  const auto elapsedInNs = std::chrono::duration<double, std::nano>(time - clockReference.time).count();
+  return double(timestamp - clockReference.timestamp) / elapsedInNs;
+#else
+  using Period = std::chrono::steady_clock::period;
+  return double(Period::den) / double(Period::num) / 1e9;
+#endif
+}
+
+void recordProfilerZone(const char *name, const uint64_t start, const uint64_t end) {
+  getThreadBuffer()->push({name, start, end});
+}
+
+void setProfilerThreadName(const std::string &threadName) {
+  const auto buffer = getThreadBuffer();
+  std::lock_guard lock(threadBuffersMutex);
+  buffer->threadName = threadName;
+}
+
+std::vector<ProfilerThreadZones> collectProfilerZones() {
+  std::lock_guard lock(threadBuffersMutex);
+
+  std::vector<ProfilerThreadZones> threadZones;
+  threadZones.reserve(threadBuffers.size());
+  for (const auto &buffer : threadBuffers) {
+    threadZones.push_back({buffer->threadId, buffer->threadName, buffer->copyZones()});
+  }
+  return threadZones;
+}
+
+bool writeChromeTrace(const std::string &filePath, const uint64_t windowStart, const uint64_t windowEnd) {
+  auto threadZones = collectProfilerZones();
+  for (auto &[threadId, threadName, zones] : threadZones) {
+    std::erase_if(zones, [&](const ProfilerZone &zone) {
+      return zone.end < windowStart || zone.start > windowEnd;
+    });
+  }
+  const auto ticksPerMicrosecond = getProfilerTicksPerNanosecond() * 1000.0;
+
+  auto firstStart = std::numeric_limits<uint64_t>::max();
+  for (const auto &[threadId, threadName, zones] : threadZones) {
+    for (const auto &zone : zones) {
+      firstStart = std::min(firstStart, zone.start);
+    }
+  }
+
+  std::ofstream file(filePath);
+  if (!file) {
+    return false;
+  }
+
+  file << "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [\n";
+  auto separator = "";
+  char event[512];
+  for (const auto &[threadId, threadName, zones] : threadZones) {
+    snprintf(event, sizeof(event),
+             "%s{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": %u, "
+             "\"args\": {\"name\": \"%s\"}}",
+             separator, threadId,
+             threadName.empty() ? ("Thread " + std::to_string(threadId)).c_str() : threadName.c_str());
+    file << event;
+    separator = ",\n";
+
+    for (const auto &zone : zones) {
+      snprintf(event, sizeof(event),
+               ",\n{\"name\": \"%s\", \"ph\": \"X\", \"pid\": 1, \"tid\": %u, \"ts\": %.3f, \"dur\": %.3f}",
+               zone.name, threadId, double(zone.start - firstStart) / ticksPerMicrosecond,
+               double(zone.end - zone.start) / ticksPerMicrosecond);
+      file << event;
+    }
+  }
+  file << "\n]}\n";
+
+  return bool(file);
+}
@@ -0,0 +1,77 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <limits>
+#include <string>
+#include <vector>
+
+#if defined(_M_X64) || defined(__x86_64__)
+#ifdef _MSC_VER
+#include <intrin.h>
+#else
+#include <x86intrin.h>
+#endif
+#define PROFILER_RDTSC
+#endif
+
+// Raw timestamp of the profiler clock, the TSC on x64. Converted to time only when zones are exported.
+inline uint64_t getProfilerTimestamp() {
+#ifdef PROFILER_RDTSC
+  return __rdtsc();
+#else
+  return uint64_t(std::chrono::steady_clock::now().time_since_epoch().count());
+#endif
+}
+
+// Profiler timestamps per nanosecond, calibrated against steady_clock
+double getProfilerTicksPerNanosecond();
+
+struct ProfilerZone {
+  const char *name; // Has to outlive the profiler, zones are given string literals
+  uint64_t start;
+  uint64_t end;
+};
+
+// Appends to the calling thread's ring of recent zones, the oldest zone is overwritten once it is full.
+// Each thread only writes its own ring, so recording takes no locks.
+void recordProfilerZone(const char *name, const uint64_t start, const uint64_t end);
+
+// Names the calling thread in exported traces, threads are numbered otherwise
+void setProfilerThreadName(const std::string &threadName);
+
+struct ProfilerThreadZones {
+  uint32_t threadId;
+  std::string threadName;
+  std::vector<ProfilerZone> zones; // In the order they ended
+};
+
+// Copies the zones still held by every thread's ring. Safe to call while other threads record zones.
+std::vector<ProfilerThreadZones> collectProfilerZones();
+
+// Chrome trace event JSON of collectProfilerZones, for chrome://tracing or ui.perfetto.dev. Only zones
+// overlapping [windowStart, windowEnd] (profiler timestamps) are written.
+bool writeChromeTrace(const std::string &filePath, const uint64_t windowStart = 0,
+                      const uint64_t windowEnd = std::numeric_limits<uint64_t>::max());
+
+class ProfileZone {
+public:
+  explicit ProfileZone(const char *name) : _name(name), _start(getProfilerTimestamp()) {}
+  ~ProfileZone() { recordProfilerZone(_name, _start, getProfilerTimestamp()); }
+
+  ProfileZone(const ProfileZone &) = delete;
+  ProfileZone &operator=(const ProfileZone &) = delete;
+
+private:
+  const char *_name;
+  uint64_t _start;
+};
+
+// Times the rest of the enclosing scope. Compiles to nothing unless TERRAIN_GENERATOR_PROFILING is defined.
+#ifdef TERRAIN_GENERATOR_PROFILING
+#define PROFILE_ZONE_CONCAT_IMPL(a, b) a##b
+#define PROFILE_ZONE_CONCAT(a, b) PROFILE_ZONE_CONCAT_IMPL(a, b)
+#define PROFILE_ZONE(name) ProfileZone PROFILE_ZONE_CONCAT(profileZone, __LINE__)(name)
+#else
+#define PROFILE_ZONE(name)
+#endif
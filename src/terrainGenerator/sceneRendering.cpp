@@ -1,6 +1,8 @@
 #include "sceneRendering.h"
 
 #include "lightDefs.h"
+#include "linearArena.h"
+#include "profiler.h"
 #include "sceneDefs.h"
 #include "shaderLoader.h"
 #include "uniformDefs.h"
@@ -8,6 +10,8 @@
 
 static void renderSkybox(const Mesh &skyboxMesh, const glm::mat4 &viewMatrix,
                          const glm::mat4 &viewToClipMatrix, const GLuint skyboxProgramObject) {
+  PROFILE_ZONE("Skybox pass");
+
   glDepthFunc(GL_LEQUAL);
 
   glBindVertexArray(skyboxMesh.vaoHandle);
@@ -27,10 +31,20 @@ static void renderSkybox(const Mesh &skyboxMesh, const glm::mat4 &viewMatrix,
   glDepthFunc(GL_LESS);
 }
 
+// Terrain settings the map passes draw with instead of those of the scene
+struct TerrainPassOverrides {
+  std::span<const float> colorStrengths;
+  float heightMultiplier;
+  int pixelsPerTriangle;
+};
+
 static void renderTerrain(const SceneData &sceneData, const unsigned int frameBufferWidth,
                           const unsigned int frameBufferHeight, const glm::mat4 &viewMatrix,
                           const glm::mat4 &viewToClipMatrix, const bool isWireFrame,
-                          const GLuint terrainGeneratorProgramObject) {
+                          const GLuint terrainGeneratorProgramObject,
+                          const TerrainPassOverrides *overrides = nullptr) {
+  PROFILE_ZONE("Terrain pass");
+
   if (isWireFrame) {
     glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
   } else {
@@ -48,29 +62,39 @@ static void renderTerrain(const SceneData &sceneData, const unsigned int frameBu
 
   glActiveTexture(GL_TEXTURE2);
   glBindTexture(GL_TEXTURE_2D_ARRAY, terrainMesh.textureHandles[2]);
-  setUniform(terrainGeneratorProgramObject, ufTerrainTextureScalings,
-             sceneData.terrainData.terrainProperties.textureScalings);
 
-  setUniform(terrainGeneratorProgramObject, ufModelToWorldMatrixName, terrainMesh.modelTransformation);
-  setUniform(terrainGeneratorProgramObject, ufWorldToViewMatrixName, viewMatrix);
-  setUniform(terrainGeneratorProgramObject, ufNormalMatrix,
-             glm::transpose(glm::inverse(glm::mat3(viewMatrix * terrainMesh.modelTransformation))));
-  setUniform(terrainGeneratorProgramObject, ufViewToClipMatrixName, viewToClipMatrix);
-  setUniform(terrainGeneratorProgramObject, ufViewportSizeName,
-             glm::vec2(frameBufferWidth, frameBufferHeight));
-  setUniform(terrainGeneratorProgramObject, ufTerrainGridPointSpacingName,
-             sceneData.terrainData.gridPointSpacing);
-  setUniform(terrainGeneratorProgramObject, ufHeightMultiplierName, sceneData.terrainData.heightMultiplier);
-  setUniform(terrainGeneratorProgramObject, ufPixelsPerTriangleName, sceneData.terrainData.pixelsPerTriangle);
-  setUniform(terrainGeneratorProgramObject, ufTerrainColors, sceneData.terrainData.terrainProperties.colors);
-  setUniform(terrainGeneratorProgramObject, ufTerrainColorStrengths,
-             sceneData.terrainData.terrainProperties.colorStrengths);
-  setUniform(terrainGeneratorProgramObject, ufTerrainHeights,
-             sceneData.terrainData.terrainProperties.heights);
-  setUniform(terrainGeneratorProgramObject, ufTerrainBlends, sceneData.terrainData.terrainProperties.blends);
-
-  setUniform(terrainGeneratorProgramObject, ufWorldLightPositionsName, sceneData.lightData.positions);
-  setUniform(terrainGeneratorProgramObject, ufLightColorsName, sceneData.lightData.colors);
+  {
+    PROFILE_ZONE("Terrain shader setup");
+    setUniform(terrainGeneratorProgramObject, ufTerrainTextureScalings,
+               sceneData.terrainData.terrainProperties.textureScalings);
+
+    setUniform(terrainGeneratorProgramObject, ufModelToWorldMatrixName, terrainMesh.modelTransformation);
+    setUniform(terrainGeneratorProgramObject, ufWorldToViewMatrixName, viewMatrix);
+    setUniform(terrainGeneratorProgramObject, ufNormalMatrix,
+               glm::transpose(glm::inverse(glm::mat3(viewMatrix * terrainMesh.modelTransformation))));
+    setUniform(terrainGeneratorProgramObject, ufViewToClipMatrixName, viewToClipMatrix);
+    setUniform(terrainGeneratorProgramObject, ufViewportSizeName,
+               glm::vec2(frameBufferWidth, frameBufferHeight));
+    setUniform(terrainGeneratorProgramObject, ufTerrainGridPointSpacingName,
+               sceneData.terrainData.gridPointSpacing);
+    setUniform(terrainGeneratorProgramObject, ufHeightMultiplierName,
+               overrides != nullptr ? overrides->heightMultiplier : sceneData.terrainData.heightMultiplier);
+    setUniform(terrainGeneratorProgramObject, ufPixelsPerTriangleName,
+               overrides != nullptr ? overrides->pixelsPerTriangle : sceneData.terrainData.pixelsPerTriangle);
+    setUniform(terrainGeneratorProgramObject, ufTerrainColors,
+               sceneData.terrainData.terrainProperties.colors);
+    const auto &terrainProperties = sceneData.terrainData.terrainProperties;
+    setUniform(terrainGeneratorProgramObject, ufTerrainColorStrengths,
+               overrides != nullptr ? overrides->colorStrengths
+                                    : std::span<const float>(terrainProperties.colorStrengths));
+    setUniform(terrainGeneratorProgramObject, ufTerrainHeights,
+               sceneData.terrainData.terrainProperties.heights);
+    setUniform(terrainGeneratorProgramObject, ufTerrainBlends,
+               sceneData.terrainData.terrainProperties.blends);
+
+    setUniform(terrainGeneratorProgramObject, ufWorldLightPositionsName, sceneData.lightData.positions);
+    setUniform(terrainGeneratorProgramObject, ufLightColorsName, sceneData.lightData.colors);
+  }
 
   validateProgramObject(terrainGeneratorProgramObject);
   glUseProgram(terrainGeneratorProgramObject);
@@ -80,14 +104,15 @@ static void renderTerrain(const SceneData &sceneData, const unsigned int frameBu
   glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
 }
 
-void renderWaterDebug(const Mesh &waterMesh, const SceneData &sceneData, const unsigned int frameBufferWidth,
-                      const unsigned int frameBufferHeight, const glm::mat4 &viewMatrix,
-                      const glm::mat4 &viewToClipMatrix, const GLuint waterDebugProgramObject) {
+static void renderWaterDebug(const Mesh &waterMesh, const glm::mat4 &modelToWorldMatrix,
+                             const SceneData &sceneData, const unsigned int frameBufferWidth,
+                             const unsigned int frameBufferHeight, const glm::mat4 &viewMatrix,
+                             const glm::mat4 &viewToClipMatrix, const GLuint waterDebugProgramObject) {
   glViewport(0, 0, frameBufferWidth, frameBufferHeight);
 
   glBindVertexArray(waterMesh.vaoHandle);
 
-  setUniform(waterDebugProgramObject, ufModelToWorldMatrixName, waterMesh.modelTransformation);
+  setUniform(waterDebugProgramObject, ufModelToWorldMatrixName, modelToWorldMatrix);
   setUniform(waterDebugProgramObject, ufWorldToViewMatrixName, viewMatrix);
   setUniform(waterDebugProgramObject, ufViewToClipMatrixName, viewToClipMatrix);
 
@@ -118,6 +143,8 @@ static void renderMaps(const Mesh &terrainMesh, const glm::mat4 &viewMatrix,
 
 void renderNoiseMap(const Mesh &terrainMesh, const glm::mat4 &viewMatrix, const glm::mat4 &viewToClipMatrix,
                     const GLuint terrainGeneratorDebugProgramObject) {
+  PROFILE_ZONE("Noise map pass");
+
   glActiveTexture(GL_TEXTURE0);
   glBindTexture(GL_TEXTURE_2D, terrainMesh.textureHandles[0]);
   setUniform(terrainGeneratorDebugProgramObject, ufDebugSettings, glm::vec3(1.0f, 0.0f, 0.0f));
@@ -126,29 +153,25 @@ void renderNoiseMap(const Mesh &terrainMesh, const glm::mat4 &viewMatrix, const
 
 void renderColorMap(const WindowData &windowData, const SceneData &sceneData, const glm::mat4 &viewMatrix,
                     const glm::mat4 &viewToClipMatrix, const SceneProgramObjects &sceneProgramObjects) {
-  // Temp variables only for debugging purposes
-  auto sceneDataTmp = sceneData;
-  for (size_t i = 0; i < sceneDataTmp.terrainData.terrainCount; i++) {
-    sceneDataTmp.terrainData.terrainProperties.colorStrengths[i] = 1.0f;
-  }
+  PROFILE_ZONE("Color map pass");
 
-  sceneDataTmp.terrainData.heightMultiplier = 0.1f;
-  sceneDataTmp.terrainData.pixelsPerTriangle = 1;
+  // Every terrain at full color strength and flattened, the scene itself is left as is
+  const ArenaVector<float> colorStrengths(size_t(sceneData.terrainData.terrainCount), 1.0f, &getFrameArena());
+  const TerrainPassOverrides overrides = {colorStrengths, 0.1f, 1};
 
-  auto waterMeshTmp = sceneDataTmp.meshIdToMesh.at(kWaterMeshId);
-  waterMeshTmp.modelTransformation =
-      glm::translate(glm::identity<glm::mat4>(), glm::vec3(0.0f, -0.5f, 0.0f));
-
-  renderTerrain(sceneDataTmp, sceneData.frameBufferObject.width, sceneData.frameBufferObject.height,
-                viewMatrix, viewToClipMatrix, false,
-                sceneProgramObjects.at(kTerrainGeneratorProgramObjectName));
-  renderWaterDebug(waterMeshTmp, sceneDataTmp,
+  renderTerrain(sceneData, sceneData.frameBufferObject.width, sceneData.frameBufferObject.height, viewMatrix,
+                viewToClipMatrix, false, sceneProgramObjects.at(kTerrainGeneratorProgramObjectName),
+                &overrides);
+  renderWaterDebug(sceneData.meshIdToMesh.at(kWaterMeshId),
+                   glm::translate(glm::identity<glm::mat4>(), glm::vec3(0.0f, -0.5f, 0.0f)), sceneData,
                    sceneData.frameBufferObject.width, sceneData.frameBufferObject.height, viewMatrix,
                    viewToClipMatrix, sceneProgramObjects.at(kWaterDebugProgramObjectName));
 }
 
 void renderFalloffMap(const Mesh &terrainMesh, const glm::mat4 &viewMatrix, const glm::mat4 &viewToClipMatrix,
                       const GLuint terrainGeneratorDebugProgramObject) {
+  PROFILE_ZONE("Falloff map pass");
+
   glActiveTexture(GL_TEXTURE1);
   glBindTexture(GL_TEXTURE_2D, terrainMesh.textureHandles[1]);
   setUniform(terrainGeneratorDebugProgramObject, ufDebugSettings, glm::vec3(0.0f, 1.0f, 0.0f));
@@ -158,6 +181,8 @@ void renderFalloffMap(const Mesh &terrainMesh, const glm::mat4 &viewMatrix, cons
 void renderLight(const std::vector<Mesh> &lightMeshes, const unsigned int frameBufferWidth,
                  const unsigned int frameBufferHeight, const glm::mat4 &viewMatrix,
                  const glm::mat4 &viewToClipMatrix, const GLuint lightProgramObject) {
+  PROFILE_ZONE("Light pass");
+
   glViewport(0, 0, frameBufferWidth, frameBufferHeight);
 
   setUniform(lightProgramObject, ufWorldToViewMatrixName, viewMatrix);
@@ -176,6 +201,8 @@ void renderLight(const std::vector<Mesh> &lightMeshes, const unsigned int frameB
 void renderWater(const Mesh &waterMesh, const SceneData &sceneData, const unsigned int frameBufferWidth,
                  const unsigned int frameBufferHeight, const glm::mat4 &viewMatrix,
                  const glm::mat4 &viewToClipMatrix, const GLuint waterProgramObject) {
+  PROFILE_ZONE("Water pass");
+
   glViewport(0, 0, frameBufferWidth, frameBufferHeight);
 
   glBindVertexArray(waterMesh.vaoHandle);
@@ -187,25 +214,28 @@ void renderWater(const Mesh &waterMesh, const SceneData &sceneData, const unsign
   glActiveTexture(GL_TEXTURE2);
   glBindTexture(GL_TEXTURE_2D, sceneData.frameBufferObject.fboTexture);
 
-  setUniform(waterProgramObject, ufModelToWorldMatrixName, waterMesh.modelTransformation);
-  setUniform(waterProgramObject, ufWorldToViewMatrixName, viewMatrix);
-  setUniform(waterProgramObject, ufViewToClipMatrixName, viewToClipMatrix);
-  setUniform(waterProgramObject, ufNormalMatrix,
-             glm::transpose(glm::inverse(glm::mat3(viewMatrix * waterMesh.modelTransformation))));
-  setUniform(waterProgramObject, ufWaterDistortionMoveFactorName,
-             sceneData.waterData.waterDistortionMoveFactor);
-  setUniform(waterProgramObject, ufWaterColor,
-             sceneData.terrainData.terrainProperties.colors[0]); // [0] = Water;
-
-  setUniform(waterProgramObject, ufWorldCameraPosition, sceneData.fpsCamera.cameraPosition());
-
-  setUniform(waterProgramObject, ufWorldLightPositionsName, sceneData.lightData.positions);
-  setUniform(waterProgramObject, ufLightColorsName, sceneData.lightData.colors);
-  setUniform(waterProgramObject, ufSpecularLightColorsName, sceneData.lightData.specularData.colors);
-  setUniform(waterProgramObject, ufSpecularLightIntensitiesName,
-             sceneData.lightData.specularData.intensities);
-  setUniform(waterProgramObject, ufSpecularPowers, sceneData.lightData.specularData.powers);
-  setUniform(waterProgramObject, ufReflectionStrength, sceneData.lightData.reflectionStrength);
+  {
+    PROFILE_ZONE("Water shader setup");
+    setUniform(waterProgramObject, ufModelToWorldMatrixName, waterMesh.modelTransformation);
+    setUniform(waterProgramObject, ufWorldToViewMatrixName, viewMatrix);
+    setUniform(waterProgramObject, ufViewToClipMatrixName, viewToClipMatrix);
+    setUniform(waterProgramObject, ufNormalMatrix,
+               glm::transpose(glm::inverse(glm::mat3(viewMatrix * waterMesh.modelTransformation))));
+    setUniform(waterProgramObject, ufWaterDistortionMoveFactorName,
+               sceneData.waterData.waterDistortionMoveFactor);
+    setUniform(waterProgramObject, ufWaterColor,
+               sceneData.terrainData.terrainProperties.colors[0]); // [0] = Water;
+
+    setUniform(waterProgramObject, ufWorldCameraPosition, sceneData.fpsCamera.cameraPosition());
+
+    setUniform(waterProgramObject, ufWorldLightPositionsName, sceneData.lightData.positions);
+    setUniform(waterProgramObject, ufLightColorsName, sceneData.lightData.colors);
+    setUniform(waterProgramObject, ufSpecularLightColorsName, sceneData.lightData.specularData.colors);
+    setUniform(waterProgramObject, ufSpecularLightIntensitiesName,
+               sceneData.lightData.specularData.intensities);
+    setUniform(waterProgramObject, ufSpecularPowers, sceneData.lightData.specularData.powers);
+    setUniform(waterProgramObject, ufReflectionStrength, sceneData.lightData.reflectionStrength);
+  }
 
   validateProgramObject(waterProgramObject);
   glUseProgram(waterProgramObject);
@@ -216,6 +246,8 @@ void renderWater(const Mesh &waterMesh, const SceneData &sceneData, const unsign
 void renderSceneReflectionTexture(const SceneData &sceneData, const glm::mat4 &viewMatrix,
                                     const glm::mat4 &viewToClipMatrix,
                                     const SceneProgramObjects &sceneProgramObjects) {
+  PROFILE_ZONE("Reflection pass");
+
   glBindFramebuffer(GL_FRAMEBUFFER, sceneData.frameBufferObject.fboHandle);
   glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
   glEnable(GL_CLIP_DISTANCE0);
@@ -4,6 +4,7 @@
 #include "glm\glm.hpp"
 //#include "sceneDefs.h"
 #include "sceneShaders.h"
+#include <vector>
 
 struct Mesh;
 struct WindowData;
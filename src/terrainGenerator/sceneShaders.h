@@ -1,6 +1,6 @@
 #pragma once
 
-#include <string>
+#include <string_view>
 #include <unordered_map>
 
 #include "GL/glew.h"
@@ -15,6 +15,7 @@ constexpr auto kTerrainGeneratorDebugProgramObjectName = "terrainGeneratorDebug"
 constexpr auto kWaterProgramObjectName = "water";
 constexpr auto kWaterDebugProgramObjectName = "waterDebug";
 
-using SceneProgramObjects = std::unordered_map<std::string, GLuint>;
+// Keyed by the names above, looking one up does not build a string
+using SceneProgramObjects = std::unordered_map<std::string_view, GLuint>;
 
 SceneProgramObjects initSceneShaders(const WindowData &windowData, const SceneData &sceneData);
\ No newline at end of file
@@ -5,16 +5,32 @@
 #include "imGui/imgui_impl_glfw.h"
 #include "imGui/imgui_impl_opengl3.h"
 #include "lightDefs.h"
+#include "linearArena.h"
+#include "memoryTracking.h"
 #include "meshGenerator.h"
+#include "noiseLayerCache.h"
+#include "noiseMapCache.h"
+#include "profiler.h"
 #include "sceneShaders.h"
 #include "shaderLoader.h"
 #include "terrainDefs.h"
+#include "terrainRegenerator.h"
+#include "threadPool.h"
 #include "uniformDefs.h"
 #include "utils.h"
+#include <algorithm>
+#include <cstdio>
 #include <string>
 
 const std::string fontPath(getExePath() + "/resources/fonts/");
 
+static constexpr float kMinWorldNoiseRange = 0.01f;
+
+// Regenerated in the background, the result is uploaded by the render loop once it is ready
+static void updateTerrain(const TerrainData &terrainData) {
+  getTerrainRegenerator().requestRegeneration(terrainData);
+}
+
 void initUI(GLFWwindow *window, const std::string &glslVersion) {
   IMGUI_CHECKVERSION();
   ImGui::CreateContext();
@@ -34,7 +50,8 @@ void destroyUI() {
 }
 
 void handleUIInput(SceneSettings *sceneSettings, TerrainData *terrainData, SceneData::WaterData *waterData,
-                   LightData *lightData, SceneData::SkyBoxData *skyboxData, MeshIdToMesh *meshIdToMesh) {
+                   LightData *lightData, SceneData::SkyBoxData *skyboxData, MeshIdToMesh *meshIdToMesh,
+                   FrameStatistics *frameStatistics) {
   ImGui_ImplOpenGL3_NewFrame();
   ImGui_ImplGlfw_NewFrame();
   ImGui::NewFrame();
@@ -86,8 +103,9 @@ void handleUIInput(SceneSettings *sceneSettings, TerrainData *terrainData, Scene
   if (ImGui::TreeNode("Light settings")) {
     for (size_t i = 0; i < lightData->lightCount; ++i) {
       ImGui::PushID(int(i));
-      const std::string name("Light " + std::to_string(i));
-      if (ImGui::TreeNode(name.data())) {
+      char name[32];
+      snprintf(name, sizeof(name), "Light %zu", i);
+      if (ImGui::TreeNode(name)) {
         if (ImGui::ColorEdit3("Light color", glm::value_ptr(lightData->colors[i]),
                               ImGuiColorEditFlags_NoInputs)) {
           // Do nothing, just update the variable
@@ -152,9 +170,167 @@ void handleUIInput(SceneSettings *sceneSettings, TerrainData *terrainData, Scene
         ImGui::SliderFloat("Octave offset X", &terrainData->noiseMapData.octaveOffset.x, 0.0f, 2000.0f) ||
         ImGui::SliderFloat("Octave offset Y", &terrainData->noiseMapData.octaveOffset.y, 0.0f, 2000.0f) ||
         ImGui::SliderFloat("Scale", &terrainData->noiseMapData.scale, 1.0f, 10.0f)) {
-      updateTerrainMeshTexture(&meshIdToMesh->at(kTerrainMeshId), terrainData->noiseMapData,
-                               terrainData->useFalloffMap, terrainData->terrainProperties.colors,
-                               terrainData->terrainProperties.heights);
+      updateTerrain(*terrainData);
+    }
+
+    char simdBackendName[32];
+    snprintf(simdBackendName, sizeof(simdBackendName), "SIMD (%s)", getNoiseSIMDLevelName());
+    const std::array<const char *, 2> noiseBackendNames{"Scalar", simdBackendName};
+    if (ImGui::BeginCombo("Noise backend", noiseBackendNames[int(terrainData->noiseMapData.noiseBackend)])) {
+      for (int i = 0; i < noiseBackendNames.size(); ++i) {
+        const auto isSelected = int(terrainData->noiseMapData.noiseBackend) == i;
+        if (ImGui::Selectable(noiseBackendNames[i], isSelected)) {
+          terrainData->noiseMapData.noiseBackend = NOISE_BACKEND(i);
+          updateTerrain(*terrainData);
+        }
+
+        if (isSelected)
+          ImGui::SetItemDefaultFocus();
+      }
+      ImGui::EndCombo();
+    }
+
+    const std::array<const char *, 3> normalizationNames{"Local min/max", "Fractal bounds", "World range"};
+    const auto normalizationIndex = int(terrainData->noiseMapData.normalization);
+    if (ImGui::BeginCombo("Normalization", normalizationNames[normalizationIndex])) {
+      for (int i = 0; i < normalizationNames.size(); ++i) {
+        const auto isSelected = normalizationIndex == i;
+        if (ImGui::Selectable(normalizationNames[i], isSelected)) {
+          terrainData->noiseMapData.normalization = NOISE_NORMALIZATION(i);
+          updateTerrain(*terrainData);
+        }
+
+        if (isSelected)
+          ImGui::SetItemDefaultFocus();
+      }
+      ImGui::EndCombo();
+    }
+
+    auto &worldNoiseRange = terrainData->noiseMapData.worldNoiseRange;
+    if (terrainData->noiseMapData.normalization == NOISE_NORMALIZATION::WORLD_RANGE &&
+        ImGui::DragFloatRange2("World noise range", &worldNoiseRange.x, &worldNoiseRange.y, 0.01f, -4.0f,
+                               4.0f)) {
+      // The range is divided by, so it must not collapse
+      worldNoiseRange.x = std::min(worldNoiseRange.x, 4.0f - kMinWorldNoiseRange);
+      worldNoiseRange.y = std::max(worldNoiseRange.y, worldNoiseRange.x + kMinWorldNoiseRange);
+      updateTerrain(*terrainData);
+    }
+
+    if (ImGui::Checkbox("Cache octave layers", &terrainData->useNoiseLayerCache)) {
+      if (!terrainData->useNoiseLayerCache) {
+        getNoiseLayerCache().clear();
+      }
+    }
+
+    if (terrainData->useNoiseLayerCache) {
+      auto &noiseLayerCache = getNoiseLayerCache();
+      int memoryBudgetInMiB = int(noiseLayerCache.memoryBudget() / (1024 * 1024));
+      if (ImGui::SliderInt("Layer cache budget (MiB)", &memoryBudgetInMiB, 16, 4096)) {
+        noiseLayerCache.setMemoryBudget(size_t(memoryBudgetInMiB) * 1024 * 1024);
+      }
+      ImGui::Text("Cached layers: %zu (%.1f MiB)", noiseLayerCache.layerCount(),
+                  noiseLayerCache.memoryUsage() / (1024.0f * 1024.0f));
+    }
+
+    if (ImGui::Checkbox("Cache noise maps", &terrainData->useNoiseMapCache)) {
+      // Do nothing, just update the variable
+    }
+
+    if (terrainData->useNoiseMapCache) {
+      auto &noiseMapCache = getNoiseMapCache();
+      int memoryBudgetInMiB = int(noiseMapCache.memoryBudget() / (1024 * 1024));
+      if (ImGui::SliderInt("Map cache budget (MiB)", &memoryBudgetInMiB, 16, 4096)) {
+        noiseMapCache.setMemoryBudget(size_t(memoryBudgetInMiB) * 1024 * 1024);
+      }
+      ImGui::Text("Cached maps: %zu (%.1f MiB)", noiseMapCache.mapCount(),
+                  noiseMapCache.memoryUsage() / (1024.0f * 1024.0f));
+      int diskBudgetInMiB = int(noiseMapCache.diskBudget() / (1024 * 1024));
+      if (ImGui::SliderInt("Map disk cache budget (MiB)", &diskBudgetInMiB, 0, 16384)) {
+        noiseMapCache.setDiskBudget(size_t(diskBudgetInMiB) * 1024 * 1024);
+      }
+      ImGui::Text("Maps on disk: %zu (%.1f MiB)", noiseMapCache.diskMapCount(),
+                  noiseMapCache.diskUsage() / (1024.0f * 1024.0f));
+      ImGui::Text("Hits: %llu in memory, %llu on disk, misses: %llu",
+                  static_cast<unsigned long long>(noiseMapCache.memoryHitCount()),
+                  static_cast<unsigned long long>(noiseMapCache.diskHitCount()),
+                  static_cast<unsigned long long>(noiseMapCache.missCount()));
+    }
+
+    if (ImGui::Checkbox("Progressive preview", &terrainData->useProgressivePreview)) {
+      // Do nothing, just update the variable
+    }
+
+    if (getTerrainRegenerator().isRegenerating()) {
+      ImGui::Text("Regenerating terrain...");
+    }
+
+    const auto &heightfield = getTerrainRegenerator().heightfield();
+    ImGui::Text("Heightfield version: %llu, %d older still pinned",
+                static_cast<unsigned long long>(heightfield.version()), heightfield.retiredCount());
+
+    ImGui::TreePop();
+  }
+
+  if (ImGui::TreeNode("Height curve")) {
+    auto &heightCurve = terrainData->noiseMapData.heightCurve;
+    auto heightCurveChanged = false;
+
+    const std::array<const char *, 2> heightCurveTypeNames{"Polynomial", "Control points"};
+    if (ImGui::BeginCombo("Curve type", heightCurveTypeNames[int(heightCurve.type)])) {
+      for (int i = 0; i < heightCurveTypeNames.size(); ++i) {
+        const auto isSelected = int(heightCurve.type) == i;
+        if (ImGui::Selectable(heightCurveTypeNames[i], isSelected)) {
+          heightCurve.type = HEIGHT_CURVE_TYPE(i);
+          heightCurveChanged = true;
+        }
+
+        if (isSelected)
+          ImGui::SetItemDefaultFocus();
+      }
+      ImGui::EndCombo();
+    }
+
+    if (heightCurve.type == HEIGHT_CURVE_TYPE::POLYNOMIAL) {
+      for (size_t i = 0; i < heightCurve.coefficients.size(); ++i) {
+        char label[16];
+        snprintf(label, sizeof(label), "x^%zu", i);
+        heightCurveChanged |= ImGui::SliderFloat(label, &heightCurve.coefficients[i], -5.0f, 5.0f);
+      }
+    } else {
+      for (size_t i = 0; i < heightCurve.controlPoints.size(); ++i) {
+        ImGui::PushID(int(i));
+        heightCurveChanged |=
+            ImGui::SliderFloat2("Point", glm::value_ptr(heightCurve.controlPoints[i]), 0.0f, 1.0f);
+        if (heightCurve.controlPoints.size() > 2) {
+          ImGui::SameLine();
+          if (ImGui::Button("Remove")) {
+            heightCurve.controlPoints.erase(heightCurve.controlPoints.begin() + i);
+            heightCurveChanged = true;
+            ImGui::PopID();
+            break;
+          }
+        }
+        ImGui::PopID();
+      }
+
+      if (ImGui::Button("Add point")) {
+        heightCurve.controlPoints.push_back(glm::vec2(0.5f));
+        heightCurveChanged = true;
+      }
+    }
+
+    // Only re-baked for the plot when the curve changes
+    static HeightCurve plottedHeightCurve;
+    static HeightCurveTable plottedHeightCurveTable = bakeHeightCurve(plottedHeightCurve);
+    if (plottedHeightCurve != heightCurve) {
+      plottedHeightCurve = heightCurve;
+      plottedHeightCurveTable = bakeHeightCurve(plottedHeightCurve);
+    }
+    ImGui::PlotLines("Curve", plottedHeightCurveTable.data(), int(plottedHeightCurveTable.size()), 0, nullptr,
+                     0.0f, 1.0f, ImVec2(0.0f, 120.0f));
+
+    if (heightCurveChanged) {
+      updateTerrain(*terrainData);
     }
 
     ImGui::TreePop();
@@ -168,9 +344,7 @@ void handleUIInput(SceneSettings *sceneSettings, TerrainData *terrainData, Scene
         if (ImGui::SliderFloat("Height", &terrainData->terrainProperties.heights[i], 0.0f, 1.0f) ||
             ImGui::ColorEdit3("Color", glm::value_ptr(terrainData->terrainProperties.colors[i]),
                               ImGuiColorEditFlags_NoInputs)) {
-          updateTerrainMeshTexture(&meshIdToMesh->at(kTerrainMeshId), terrainData->noiseMapData,
-                                   terrainData->useFalloffMap, terrainData->terrainProperties.colors,
-                                   terrainData->terrainProperties.heights);
+          updateTerrain(*terrainData);
         }
 
         if (ImGui::SliderFloat("Color strength", &terrainData->terrainProperties.colorStrengths[i], 0.0f,
@@ -196,9 +370,7 @@ void handleUIInput(SceneSettings *sceneSettings, TerrainData *terrainData, Scene
   }
 
   if (ImGui::Checkbox("Use falloff map", &terrainData->useFalloffMap)) {
-    updateTerrainMeshTexture(&meshIdToMesh->at(kTerrainMeshId), terrainData->noiseMapData,
-                             terrainData->useFalloffMap, terrainData->terrainProperties.colors,
-                             terrainData->terrainProperties.heights);
+    updateTerrain(*terrainData);
   }
 
   if (ImGui::SliderFloat("Terrain grid spacing", &terrainData->gridPointSpacing, 1.0f, 10.0f)) {
@@ -211,13 +383,110 @@ void handleUIInput(SceneSettings *sceneSettings, TerrainData *terrainData, Scene
     // Do nothing, just update the variable
   }
 
+  if (ImGui::TreeNode("Profiling")) {
+    const auto frameTimePercentiles = frameStatistics->frameTimePercentiles();
+    ImGui::Text("Frame time over the last %d frames", frameStatistics->frameCount());
+    ImGui::Text("%-16s p50 %6.2f ms  p95 %6.2f ms  p99 %6.2f ms", "Total", frameTimePercentiles.p50,
+                frameTimePercentiles.p95, frameTimePercentiles.p99);
+    for (int i = 0; i < int(FRAME_STAGE::COUNT); ++i) {
+      const auto stageTimePercentiles = frameStatistics->stageTimePercentiles(FRAME_STAGE(i));
+      ImGui::Text("%-16s p50 %6.2f ms  p95 %6.2f ms  p99 %6.2f ms", kFrameStageNames[i],
+                  stageTimePercentiles.p50, stageTimePercentiles.p95, stageTimePercentiles.p99);
+    }
+
+    const auto frameTimeHistory = frameStatistics->frameTimeHistory(&getFrameArena());
+    ImGui::PlotLines("Frame times (ms)", frameTimeHistory.data(), int(frameTimeHistory.size()), 0, nullptr,
+                     0.0f, std::max(frameTimePercentiles.p99 * 1.5f, 1.0f), ImVec2(0.0f, 60.0f));
+
+    const auto &frameArena = getFrameArena();
+    ImGui::Text("Heap allocations per frame: %d, at most %d", frameStatistics->lastFrameHeapAllocationCount(),
+                frameStatistics->maxFrameHeapAllocationCount());
+    ImGui::Text("Frame arena: %zu KiB used, %zu KiB at most, %zu KiB reserved", frameArena.usedBytes() / 1024,
+                frameArena.peakUsedBytes() / 1024, frameArena.capacity() / 1024);
+
+    constexpr auto kBytesToMiB = 1.0 / (1024.0 * 1024.0);
+    ImGui::Text("%-16s %10s %10s %12s %10s %10s", "Memory", "heap MiB", "peak MiB", "allocations", "GPU MiB",
+                "peak MiB");
+    for (int i = 0; i <= int(MEMORY_TAG::COUNT); ++i) {
+      const auto isTotal = i == int(MEMORY_TAG::COUNT);
+      const auto usage = isTotal ? getTotalMemoryUsage() : getMemoryTagUsage(MEMORY_TAG(i));
+      ImGui::Text("%-16s %10.2f %10.2f %12llu %10.2f %10.2f", isTotal ? "Total" : kMemoryTagNames[i],
+                  usage.heap.bytes * kBytesToMiB, usage.heap.peakBytes * kBytesToMiB,
+                  static_cast<unsigned long long>(usage.heap.allocationCount), usage.gpu.bytes * kBytesToMiB,
+                  usage.gpu.peakBytes * kBytesToMiB);
+    }
+    if (ImGui::Button("Reset memory peaks")) {
+      resetMemoryPeaks();
+    }
+    ImGui::SameLine();
+    static std::string memoryReportMessage;
+    if (ImGui::Button("Save memory report")) {
+      const auto reportPath = getExePath() + "/terrainGenerator.memory.txt";
+      const auto reportFile = std::fopen(reportPath.c_str(), "w");
+      if (reportFile != nullptr) {
+        writeMemoryReport(reportFile);
+        std::fclose(reportFile);
+        memoryReportMessage = "Saved " + reportPath;
+      } else {
+        memoryReportMessage = "Could not write " + reportPath;
+      }
+    }
+    if (!memoryReportMessage.empty()) {
+      ImGui::TextUnformatted(memoryReportMessage.c_str());
+    }
+
+    if (ImGui::SliderFloat("Spike threshold (ms)", &frameStatistics->spikeThresholdInMs, 0.0f, 200.0f)) {
+      // Do nothing, just update the variable
+    }
+    if (!frameStatistics->lastSpikeCapture().empty()) {
+      ImGui::TextUnformatted(frameStatistics->lastSpikeCapture().c_str());
+    }
+
+    auto &threadPool = getThreadPool();
+    const std::array<const char *, 3> threadPoolModeNames{"Parallel", "Single threaded", "Deterministic"};
+    const auto threadPoolModeIndex = int(threadPool.mode());
+    if (ImGui::BeginCombo("Job scheduling", threadPoolModeNames[threadPoolModeIndex])) {
+      for (int i = 0; i < threadPoolModeNames.size(); ++i) {
+        const auto isSelected = threadPoolModeIndex == i;
+        if (ImGui::Selectable(threadPoolModeNames[i], isSelected)) {
+          threadPool.setMode(THREAD_POOL_MODE(i));
+        }
+
+        if (isSelected)
+          ImGui::SetItemDefaultFocus();
+      }
+      ImGui::EndCombo();
+    }
+    const auto threadPoolCounters = threadPool.counters();
+    ImGui::Text("Threads: %u, tasks: %llu, stolen: %llu, workers idle: %.0f ms", threadPool.threadCount(),
+                static_cast<unsigned long long>(threadPoolCounters.executedTaskCount),
+                static_cast<unsigned long long>(threadPoolCounters.stealCount),
+                threadPoolCounters.idleTimeInMs);
+    if (ImGui::Button("Reset job counters")) {
+      threadPool.resetCounters();
+    }
+
+    ImGui::NewLine();
+#ifdef TERRAIN_GENERATOR_PROFILING
+    static std::string traceMessage;
+    if (ImGui::Button("Save trace")) {
+      const auto tracePath = getExePath() + "/terrainGenerator.trace.json";
+      traceMessage = writeChromeTrace(tracePath) ? "Saved " + tracePath : "Could not write " + tracePath;
+    }
+    if (!traceMessage.empty()) {
+      ImGui::TextUnformatted(traceMessage.c_str());
+    }
+#else
+    ImGui::TextUnformatted("Built without TERRAIN_GENERATOR_PROFILING");
+#endif
+    ImGui::TreePop();
+  }
+
   ImGui::NewLine();
   if (ImGui::Button("Reset terrain settings")) {
     sceneSettings->renderMode = SceneSettings::RENDER_MODE::MESH;
     *terrainData = initDefaultTerrainData();
-    updateTerrainMeshTexture(&meshIdToMesh->at(kTerrainMeshId), terrainData->noiseMapData,
-                             terrainData->useFalloffMap, terrainData->terrainProperties.colors,
-                             terrainData->terrainProperties.heights);
+    updateTerrain(*terrainData);
   }
 
   ImGui::End();
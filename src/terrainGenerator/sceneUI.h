@@ -1,6 +1,7 @@
 #pragma once
 
 #include "GL/glew.h"
+#include "frameStatistics.h"
 #include "meshGenerator.h"
 #include "sceneDefs.h"
 #include "sceneShaders.h"
@@ -33,4 +34,5 @@ void initUI(GLFWwindow *window, const std::string &glslVersion);
 void destroyUI();
 void renderUI();
 void handleUIInput(SceneSettings *sceneSettings, TerrainData *terrainData, SceneData::WaterData *waterData,
-                   LightData *lightData, SceneData::SkyBoxData *skyboxData, MeshIdToMesh *meshIdToMesh);
+                   LightData *lightData, SceneData::SkyBoxData *skyboxData, MeshIdToMesh *meshIdToMesh,
+                   FrameStatistics *frameStatistics);
@@ -121,70 +121,70 @@ void validateProgramObject(const GLuint programObject) {
 void deleteProgramObject(const GLuint programObject) { glDeleteProgram(programObject); }
 
 // Int
-void setUniform(const GLuint programObject, const std::string &uniformName, const int uniformValue) {
-  glProgramUniform1iv(programObject, glGetUniformLocation(programObject, uniformName.c_str()), 1,
+void setUniform(const GLuint programObject, const char *uniformName, const int uniformValue) {
+  glProgramUniform1iv(programObject, glGetUniformLocation(programObject, uniformName), 1,
                       &uniformValue);
 }
-void setUniform(const GLuint programObject, const std::string &uniformName, const glm::ivec2 &uniformValue) {
-  glProgramUniform2iv(programObject, glGetUniformLocation(programObject, uniformName.c_str()), 1,
+void setUniform(const GLuint programObject, const char *uniformName, const glm::ivec2 &uniformValue) {
+  glProgramUniform2iv(programObject, glGetUniformLocation(programObject, uniformName), 1,
                       glm::value_ptr(uniformValue));
 }
-void setUniform(const GLuint programObject, const std::string &uniformName, const glm::ivec3 &uniformValue) {
-  glProgramUniform3iv(programObject, glGetUniformLocation(programObject, uniformName.c_str()), 1,
+void setUniform(const GLuint programObject, const char *uniformName, const glm::ivec3 &uniformValue) {
+  glProgramUniform3iv(programObject, glGetUniformLocation(programObject, uniformName), 1,
                       glm::value_ptr(uniformValue));
 }
-void setUniform(const GLuint programObject, const std::string &uniformName, const glm::ivec4 &uniformValue) {
-  glProgramUniform4iv(programObject, glGetUniformLocation(programObject, uniformName.c_str()), 1,
+void setUniform(const GLuint programObject, const char *uniformName, const glm::ivec4 &uniformValue) {
+  glProgramUniform4iv(programObject, glGetUniformLocation(programObject, uniformName), 1,
                       glm::value_ptr(uniformValue));
 }
 
 // Float
-void setUniform(const GLuint programObject, const std::string &uniformName, const float uniformValue) {
-  glProgramUniform1fv(programObject, glGetUniformLocation(programObject, uniformName.c_str()), 1,
+void setUniform(const GLuint programObject, const char *uniformName, const float uniformValue) {
+  glProgramUniform1fv(programObject, glGetUniformLocation(programObject, uniformName), 1,
                       &uniformValue);
 }
-void setUniform(const GLuint programObject, const std::string &uniformName, const glm::vec2 &uniformValue) {
-  glProgramUniform2fv(programObject, glGetUniformLocation(programObject, uniformName.c_str()), 1,
+void setUniform(const GLuint programObject, const char *uniformName, const glm::vec2 &uniformValue) {
+  glProgramUniform2fv(programObject, glGetUniformLocation(programObject, uniformName), 1,
                       glm::value_ptr(uniformValue));
 }
-void setUniform(const GLuint programObject, const std::string &uniformName, const glm::vec3 &uniformValue) {
-  glProgramUniform3fv(programObject, glGetUniformLocation(programObject, uniformName.c_str()), 1,
+void setUniform(const GLuint programObject, const char *uniformName, const glm::vec3 &uniformValue) {
+  glProgramUniform3fv(programObject, glGetUniformLocation(programObject, uniformName), 1,
                       glm::value_ptr(uniformValue));
 }
-void setUniform(const GLuint programObject, const std::string &uniformName, const glm::vec4 &uniformValue) {
-  glProgramUniform4fv(programObject, glGetUniformLocation(programObject, uniformName.c_str()), 1,
+void setUniform(const GLuint programObject, const char *uniformName, const glm::vec4 &uniformValue) {
+  glProgramUniform4fv(programObject, glGetUniformLocation(programObject, uniformName), 1,
                       glm::value_ptr(uniformValue));
 }
 
 // Float arrays
-void setUniform(const GLuint programObject, const std::string &uniformName,
-                const std::vector<float> &uniformValues) {
-  glProgramUniform1fv(programObject, glGetUniformLocation(programObject, uniformName.c_str()),
+void setUniform(const GLuint programObject, const char *uniformName,
+                const std::span<const float> uniformValues) {
+  glProgramUniform1fv(programObject, glGetUniformLocation(programObject, uniformName),
                       GLsizei(uniformValues.size()), uniformValues.data());
 }
 
-void setUniform(const GLuint programObject, const std::string &uniformName,
-                const std::vector<glm::vec3> &uniformValues) {
-  glProgramUniform3fv(programObject, glGetUniformLocation(programObject, uniformName.c_str()),
-                      GLsizei(uniformValues.size()), glm::value_ptr(uniformValues[0]));
+void setUniform(const GLuint programObject, const char *uniformName,
+                const std::span<const glm::vec3> uniformValues) {
+  glProgramUniform3fv(programObject, glGetUniformLocation(programObject, uniformName),
+                      GLsizei(uniformValues.size()), glm::value_ptr(uniformValues.front()));
 }
 
-void setUniform(const GLuint programObject, const std::string &uniformName,
-                const std::vector<glm::vec4> &uniformValues) {
-  glProgramUniform4fv(programObject, glGetUniformLocation(programObject, uniformName.c_str()),
-                      GLsizei(uniformValues.size()), glm::value_ptr(uniformValues[0]));
+void setUniform(const GLuint programObject, const char *uniformName,
+                const std::span<const glm::vec4> uniformValues) {
+  glProgramUniform4fv(programObject, glGetUniformLocation(programObject, uniformName),
+                      GLsizei(uniformValues.size()), glm::value_ptr(uniformValues.front()));
 }
 
 // Matrices
-void setUniform(const GLuint programObject, const std::string &uniformName, const glm::mat2 &uniformValue) {
-  glProgramUniformMatrix2fv(programObject, glGetUniformLocation(programObject, uniformName.c_str()), 1,
+void setUniform(const GLuint programObject, const char *uniformName, const glm::mat2 &uniformValue) {
+  glProgramUniformMatrix2fv(programObject, glGetUniformLocation(programObject, uniformName), 1,
                             GL_FALSE, glm::value_ptr(uniformValue));
 }
-void setUniform(const GLuint programObject, const std::string &uniformName, const glm::mat3 &uniformValue) {
-  glProgramUniformMatrix3fv(programObject, glGetUniformLocation(programObject, uniformName.c_str()), 1,
+void setUniform(const GLuint programObject, const char *uniformName, const glm::mat3 &uniformValue) {
+  glProgramUniformMatrix3fv(programObject, glGetUniformLocation(programObject, uniformName), 1,
                             GL_FALSE, glm::value_ptr(uniformValue));
 }
-void setUniform(const GLuint programObject, const std::string &uniformName, const glm::mat4 &uniformValue) {
-  glProgramUniformMatrix4fv(programObject, glGetUniformLocation(programObject, uniformName.c_str()), 1,
+void setUniform(const GLuint programObject, const char *uniformName, const glm::mat4 &uniformValue) {
+  glProgramUniformMatrix4fv(programObject, glGetUniformLocation(programObject, uniformName), 1,
                             GL_FALSE, glm::value_ptr(uniformValue));
 }
\ No newline at end of file
@@ -2,6 +2,7 @@
 
 #include "GL\glew.h"
 #include "glm\glm.hpp"
+#include <span>
 #include <string>
 #include <vector>
 
@@ -11,27 +12,27 @@ void validateProgramObject(const GLuint programObject);
 void deleteProgramObject(GLuint programObject);
 
 // Int
-void setUniform(const GLuint programObject, const std::string &uniformName, const int uniformValue);
-void setUniform(const GLuint programObject, const std::string &uniformName, const glm::ivec2 &uniformValue);
-void setUniform(const GLuint programObject, const std::string &uniformName, const glm::ivec3 &uniformValue);
-void setUniform(const GLuint programObject, const std::string &uniformName, const glm::ivec4 &uniformValue);
+void setUniform(const GLuint programObject, const char *uniformName, const int uniformValue);
+void setUniform(const GLuint programObject, const char *uniformName, const glm::ivec2 &uniformValue);
+void setUniform(const GLuint programObject, const char *uniformName, const glm::ivec3 &uniformValue);
+void setUniform(const GLuint programObject, const char *uniformName, const glm::ivec4 &uniformValue);
 
 // Float
-void setUniform(const GLuint programObject, const std::string &uniformName, const float uniformValue);
-void setUniform(const GLuint programObject, const std::string &uniformName, const glm::vec2 &uniformValue);
-void setUniform(const GLuint programObject, const std::string &uniformName, const glm::vec3 &uniformValue);
-void setUniform(const GLuint programObject, const std::string &uniformName, const glm::vec4 &uniformValue);
+void setUniform(const GLuint programObject, const char *uniformName, const float uniformValue);
+void setUniform(const GLuint programObject, const char *uniformName, const glm::vec2 &uniformValue);
+void setUniform(const GLuint programObject, const char *uniformName, const glm::vec3 &uniformValue);
+void setUniform(const GLuint programObject, const char *uniformName, const glm::vec4 &uniformValue);
 
 // Float arrays
-void setUniform(const GLuint programObject, const std::string &uniformName,
-                const std::vector<float> &uniformValues);
-void setUniform(const GLuint programObject, const std::string &uniformName,
-                const std::vector<glm::vec3> &uniformValues);
-void setUniform(const GLuint programObject, const std::string &uniformName,
-                const std::vector<glm::vec4> &uniformValues);
+void setUniform(const GLuint programObject, const char *uniformName,
+                const std::span<const float> uniformValues);
+void setUniform(const GLuint programObject, const char *uniformName,
+                const std::span<const glm::vec3> uniformValues);
+void setUniform(const GLuint programObject, const char *uniformName,
+                const std::span<const glm::vec4> uniformValues);
 
 // Matrices
-void setUniform(const GLuint programObject, const std::string &uniformName, const float uniformValue);
-void setUniform(const GLuint programObject, const std::string &uniformName, const glm::mat2 &uniformValue);
-void setUniform(const GLuint programObject, const std::string &uniformName, const glm::mat3 &uniformValue);
-void setUniform(const GLuint programObject, const std::string &uniformName, const glm::mat4 &uniformValue);
\ No newline at end of file
+void setUniform(const GLuint programObject, const char *uniformName, const float uniformValue);
+void setUniform(const GLuint programObject, const char *uniformName, const glm::mat2 &uniformValue);
+void setUniform(const GLuint programObject, const char *uniformName, const glm::mat3 &uniformValue);
+void setUniform(const GLuint programObject, const char *uniformName, const glm::mat4 &uniformValue);
\ No newline at end of file
@@ -0,0 +1,495 @@
+// Headless batch generation of heightmaps, no window or GL context is created.
+//
+//   TerrainBatch <job file> [--threads <n>] [--thread-mode parallel|single|deterministic]
+//                [--output-dir <dir>] [--skip-existing] [--verify]
+//
+// Every line of the job file is a job of key=value settings separated by spaces, # starts a comment. A line
+// starting with "defaults" sets values for every job below it instead. seed=<first>..<last> expands to one
+// job per seed, with {seed} in the output paths replaced by the seed:
+//
+//   defaults size=1024 octaves=6 backend=simd normalization=fractalBounds falloff=1
+//   seed=1..1000 output=islands/island_{seed}.png normalMap=islands/island_{seed}_normal.png
+//
+// Settings: size, scale, octaves, persistance, lacunarity, seed, offset=<x>,<y>, backend=scalar|simd,
+// normalization=local|fractalBounds|worldRange, worldRange=<min>,<max>, falloff=0|1,
+// curve=<c0>,<c1>,... (polynomial), curvePoints=<x>:<y>,<x>:<y>,... (control points), output,
+// format=png16|raw16|float32|tiled, tileSize, normalMap and normalHeight (texels a height of 1 spans in the
+// normal map). The format defaults to png16 for .png outputs, float32 for .r32, .f32 and .float, tiled for
+// .tiled and raw16 otherwise. Tiled heightmaps (see tiledHeightmap.h) are streamed to disk while they are
+// generated, so they can be larger than memory. They need a normalization other than local. --verify reads
+// every tiled heightmap back after it was written and checks it against the map it was generated from.
+//
+// Jobs run concurrently on one work stealing pool, threads without a map of their own help with the tiles
+// of the others. The exit code is 1 if any job failed and 2 on usage or job file errors, in which case
+// nothing is generated.
+
+#include "derivedMaps.h"
+#include "heightmapWriter.h"
+#include "memoryTracking.h"
+#include "noiseMapGenerator.h"
+#include "profiler.h"
+#include "threadPool.h"
+#include "tiledHeightmap.h"
+#include "timeMeasureUtils.h"
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+struct BatchOptions {
+  std::string jobFilePath;
+  unsigned threadCount = std::max(1u, std::thread::hardware_concurrency());
+  THREAD_POOL_MODE threadPoolMode = THREAD_POOL_MODE::PARALLEL;
+  std::string outputDirectory;
+  bool skipExisting = false;
+  bool verify = false;
+};
+
+struct BatchJob {
+  NoiseMapData noiseMapData;
+  bool useFalloffMap = false;
+  std::string outputPath;
+  HEIGHTMAP_FORMAT format = HEIGHTMAP_FORMAT::PNG16;
+  bool isTiled = false; // Streamed to a tiled heightmap instead of format
+  int tileSize = 256;
+  std::string normalMapPath; // No normal map if empty
+  float normalHeight = 64.0f;
+};
+
+using JobSettings = std::map<std::string, std::string>;
+
+static constexpr double kNanoToMilliSeconds = 1000000.0;
+
+static const char *kSettingNames[] = {"size", "scale", "octaves", "persistance", "lacunarity", "seed",
+                                      "offset", "backend", "normalization", "worldRange", "falloff",
+                                      "curve", "curvePoints", "output", "format", "tileSize", "normalMap",
+                                      "normalHeight"};
+
+static bool parseFloat(const std::string &text, float *value) {
+  char *end = nullptr;
+  *value = std::strtof(text.c_str(), &end);
+  return !text.empty() && *end == '\0';
+}
+
+static bool parseInt(const std::string &text, int *value) {
+  char *end = nullptr;
+  *value = int(std::strtol(text.c_str(), &end, 10));
+  return !text.empty() && *end == '\0';
+}
+
+static std::vector<std::string> split(const std::string &text, const char separator) {
+  std::vector<std::string> parts;
+  std::stringstream stream(text);
+  std::string part;
+  while (std::getline(stream, part, separator)) {
+    parts.push_back(part);
+  }
+  return parts;
+}
+
+static bool parseVec2(const std::string &text, const char separator, glm::vec2 *value) {
+  const auto parts = split(text, separator);
+  return parts.size() == 2 && parseFloat(parts[0], &value->x) && parseFloat(parts[1], &value->y);
+}
+
+static std::string replaceSeed(std::string path, const int seed) {
+  const std::string placeholder = "{seed}";
+  for (auto pos = path.find(placeholder); pos != std::string::npos; pos = path.find(placeholder, pos)) {
+    path.replace(pos, placeholder.size(), std::to_string(seed));
+  }
+  return path;
+}
+
+static void setFormatFromExtension(BatchJob *job) {
+  const auto extension = std::filesystem::path(job->outputPath).extension().string();
+  job->isTiled = extension == ".tiled";
+  if (extension == ".png") {
+    job->format = HEIGHTMAP_FORMAT::PNG16;
+  } else if (extension == ".r32" || extension == ".f32" || extension == ".float") {
+    job->format = HEIGHTMAP_FORMAT::FLOAT32;
+  } else {
+    job->format = HEIGHTMAP_FORMAT::RAW16;
+  }
+}
+
+// Adds the key=value pairs of a line to settings
+static bool parseJobLine(const std::string &line, JobSettings *settings, std::string *error) {
+  std::stringstream stream(line);
+  std::string token;
+  while (stream >> token) {
+    const auto separator = token.find('=');
+    if (separator == std::string::npos || separator == 0) {
+      *error = "expected key=value, got '" + token + "'";
+      return false;
+    }
+
+    const auto key = token.substr(0, separator);
+    if (std::find(std::begin(kSettingNames), std::end(kSettingNames), key) == std::end(kSettingNames)) {
+      *error = "unknown setting '" + key + "'";
+      return false;
+    }
+    (*settings)[key] = token.substr(separator + 1);
+  }
+  return true;
+}
+
+static bool applySetting(const std::string &key, const std::string &value, BatchJob *job, bool *hasFormat) {
+  auto &noiseMapData = job->noiseMapData;
+  if (key == "size") {
+    int size = 0;
+    noiseMapData.width = noiseMapData.height = parseInt(value, &size) ? size : 0;
+    return size >= 2;
+  }
+  if (key == "scale") {
+    return parseFloat(value, &noiseMapData.scale) && noiseMapData.scale > 0.0f;
+  }
+  if (key == "octaves") {
+    return parseInt(value, &noiseMapData.octaves) && noiseMapData.octaves >= 1 && noiseMapData.octaves <= 32;
+  }
+  if (key == "persistance") {
+    return parseFloat(value, &noiseMapData.persistance);
+  }
+  if (key == "lacunarity") {
+    return parseFloat(value, &noiseMapData.lacunarity);
+  }
+  if (key == "offset") {
+    return parseVec2(value, ',', &noiseMapData.octaveOffset);
+  }
+  if (key == "backend") {
+    noiseMapData.noiseBackend = value == "simd" ? NOISE_BACKEND::SIMD : NOISE_BACKEND::SCALAR;
+    return value == "simd" || value == "scalar";
+  }
+  if (key == "normalization") {
+    if (value == "local") {
+      noiseMapData.normalization = NOISE_NORMALIZATION::LOCAL;
+    } else if (value == "fractalBounds") {
+      noiseMapData.normalization = NOISE_NORMALIZATION::FRACTAL_BOUNDS;
+    } else if (value == "worldRange") {
+      noiseMapData.normalization = NOISE_NORMALIZATION::WORLD_RANGE;
+    } else {
+      return false;
+    }
+    return true;
+  }
+  if (key == "worldRange") {
+    return parseVec2(value, ',', &noiseMapData.worldNoiseRange) &&
+           noiseMapData.worldNoiseRange.y > noiseMapData.worldNoiseRange.x;
+  }
+  if (key == "falloff") {
+    job->useFalloffMap = value == "1";
+    return value == "0" || value == "1";
+  }
+  if (key == "curve") {
+    noiseMapData.heightCurve.type = HEIGHT_CURVE_TYPE::POLYNOMIAL;
+    noiseMapData.heightCurve.coefficients.clear();
+    for (const auto &coefficient : split(value, ',')) {
+      noiseMapData.heightCurve.coefficients.push_back(0.0f);
+      if (!parseFloat(coefficient, &noiseMapData.heightCurve.coefficients.back())) {
+        return false;
+      }
+    }
+    return !noiseMapData.heightCurve.coefficients.empty();
+  }
+  if (key == "curvePoints") {
+    noiseMapData.heightCurve.type = HEIGHT_CURVE_TYPE::CONTROL_POINTS;
+    noiseMapData.heightCurve.controlPoints.clear();
+    for (const auto &point : split(value, ',')) {
+      noiseMapData.heightCurve.controlPoints.emplace_back(0.0f);
+      if (!parseVec2(point, ':', &noiseMapData.heightCurve.controlPoints.back())) {
+        return false;
+      }
+    }
+    return noiseMapData.heightCurve.controlPoints.size() >= 2;
+  }
+  if (key == "output") {
+    job->outputPath = value;
+    return !value.empty();
+  }
+  if (key == "format") {
+    *hasFormat = true;
+    if (value == "png16") {
+      job->format = HEIGHTMAP_FORMAT::PNG16;
+    } else if (value == "raw16") {
+      job->format = HEIGHTMAP_FORMAT::RAW16;
+    } else if (value == "float32") {
+      job->format = HEIGHTMAP_FORMAT::FLOAT32;
+    } else if (value == "tiled") {
+      job->isTiled = true;
+    } else {
+      return false;
+    }
+    return true;
+  }
+  if (key == "tileSize") {
+    return parseInt(value, &job->tileSize) && job->tileSize > 0 && job->tileSize % 16 == 0;
+  }
+  if (key == "normalMap") {
+    job->normalMapPath = value;
+    return true;
+  }
+  if (key == "normalHeight") {
+    return parseFloat(value, &job->normalHeight);
+  }
+  return key == "seed"; // Expanded by addJobs
+}
+
+// One job per seed of the settings
+static bool addJobs(const JobSettings &settings, const BatchOptions &options, std::vector<BatchJob> *jobs,
+                    std::string *error) {
+  // Same defaults as the terrain in the viewer
+  BatchJob job;
+  job.noiseMapData.width = job.noiseMapData.height = 512;
+  job.noiseMapData.scale = 1.0f;
+  job.noiseMapData.octaves = 4;
+  job.noiseMapData.persistance = 0.366f;
+  job.noiseMapData.lacunarity = 2.0f;
+  job.noiseMapData.seed = 1;
+  job.noiseMapData.octaveOffset = glm::vec2(0.0f, 444.0f);
+
+  bool hasFormat = false;
+  for (const auto &[key, value] : settings) {
+    if (!applySetting(key, value, &job, &hasFormat)) {
+      *error = "invalid value '" + value + "' for " + key;
+      return false;
+    }
+  }
+  if (job.outputPath.empty()) {
+    *error = "no output";
+    return false;
+  }
+  if (!hasFormat) {
+    setFormatFromExtension(&job);
+  }
+  if (job.isTiled && job.noiseMapData.normalization == NOISE_NORMALIZATION::LOCAL) {
+    *error = "tiled heightmaps need a normalization other than local";
+    return false;
+  }
+  if (job.isTiled && !job.normalMapPath.empty()) {
+    *error = "tiled heightmaps have no normal map";
+    return false;
+  }
+
+  int firstSeed = job.noiseMapData.seed;
+  int lastSeed = firstSeed;
+  if (const auto seedIt = settings.find("seed"); seedIt != settings.end()) {
+    const auto &seed = seedIt->second;
+    const auto rangeSeparator = seed.find("..");
+    const auto isValid =
+        rangeSeparator == std::string::npos
+            ? parseInt(seed, &firstSeed) && parseInt(seed, &lastSeed)
+            : parseInt(seed.substr(0, rangeSeparator), &firstSeed) &&
+                  parseInt(seed.substr(rangeSeparator + 2), &lastSeed) && firstSeed <= lastSeed;
+    if (!isValid) {
+      *error = "invalid value '" + seed + "' for seed";
+      return false;
+    }
+  }
+
+  const auto getOutputPath = [&](const std::string &path, const int seed) {
+    if (path.empty() || options.outputDirectory.empty()) {
+      return replaceSeed(path, seed);
+    }
+    return (std::filesystem::path(options.outputDirectory) / replaceSeed(path, seed)).string();
+  };
+
+  for (auto seed = firstSeed; seed <= lastSeed; ++seed) {
+    auto seedJob = job;
+    seedJob.noiseMapData.seed = seed;
+    seedJob.outputPath = getOutputPath(job.outputPath, seed);
+    seedJob.normalMapPath = getOutputPath(job.normalMapPath, seed);
+    jobs->push_back(std::move(seedJob));
+  }
+  return true;
+}
+
+static bool readJobFile(const BatchOptions &options, std::vector<BatchJob> *jobs) {
+  std::ifstream file(options.jobFilePath);
+  if (!file) {
+    fprintf(stderr, "Could not read %s\n", options.jobFilePath.c_str());
+    return false;
+  }
+
+  const std::string defaultsKeyword = "defaults";
+  JobSettings defaults;
+  std::string line;
+  for (int lineNumber = 1; std::getline(file, line); ++lineNumber) {
+    line = line.substr(0, line.find('#'));
+    if (line.find_first_not_of(" \t\r") == std::string::npos) {
+      continue;
+    }
+
+    std::string error;
+    const auto firstToken = line.find_first_not_of(" \t");
+    const auto isDefaults = line.compare(firstToken, defaultsKeyword.size(), defaultsKeyword) == 0;
+    if (isDefaults) {
+      if (!parseJobLine(line.substr(firstToken + defaultsKeyword.size()), &defaults, &error)) {
+        fprintf(stderr, "%s:%d: %s\n", options.jobFilePath.c_str(), lineNumber, error.c_str());
+        return false;
+      }
+      continue;
+    }
+
+    auto settings = defaults;
+    if (!parseJobLine(line, &settings, &error) || !addJobs(settings, options, jobs, &error)) {
+      fprintf(stderr, "%s:%d: %s\n", options.jobFilePath.c_str(), lineNumber, error.c_str());
+      return false;
+    }
+  }
+  return true;
+}
+
+static bool createParentDirectory(const std::string &filePath) {
+  const auto directory = std::filesystem::path(filePath).parent_path();
+  std::error_code errorCode;
+  return directory.empty() || std::filesystem::create_directories(directory, errorCode) ||
+         std::filesystem::is_directory(directory);
+}
+
+static bool runJob(const BatchJob &job, const bool verify, ThreadPool *threadPool) {
+  PROFILE_ZONE("Run batch job");
+
+  NoiseMapGenerationContext context;
+  context.threadPool = threadPool;
+  if (job.isTiled) {
+    if (!createParentDirectory(job.outputPath) ||
+        !generateTiledHeightmap(job.outputPath, job.noiseMapData, job.useFalloffMap, job.tileSize, context)) {
+      fprintf(stderr, "Could not write %s\n", job.outputPath.c_str());
+      return false;
+    }
+    if (verify && !verifyTiledHeightmap(job.outputPath, job.noiseMapData, job.useFalloffMap, context)) {
+      fprintf(stderr, "%s does not match the map it was generated from\n", job.outputPath.c_str());
+      return false;
+    }
+    return true;
+  }
+
+  const auto noiseMap = generateNoiseMap(job.noiseMapData, job.useFalloffMap, context);
+
+  if (!createParentDirectory(job.outputPath) || !writeHeightmap(job.outputPath, noiseMap, job.format)) {
+    fprintf(stderr, "Could not write %s\n", job.outputPath.c_str());
+    return false;
+  }
+
+  if (!job.normalMapPath.empty()) {
+    const auto normals = generateNormalMap(noiseMap, job.normalHeight);
+    if (!createParentDirectory(job.normalMapPath) ||
+        !writeNormalMap(job.normalMapPath, normals, noiseMap.width(), noiseMap.height())) {
+      fprintf(stderr, "Could not write %s\n", job.normalMapPath.c_str());
+      return false;
+    }
+  }
+  return true;
+}
+
+static bool parseOptions(const int argc, char **argv, BatchOptions *options) {
+  for (int i = 1; i < argc; ++i) {
+    const std::string argument = argv[i];
+    if (argument == "--skip-existing") {
+      options->skipExisting = true;
+      continue;
+    }
+    if (argument == "--verify") {
+      options->verify = true;
+      continue;
+    }
+    if (argument.rfind("--", 0) != 0) {
+      if (!options->jobFilePath.empty()) {
+        return false;
+      }
+      options->jobFilePath = argument;
+      continue;
+    }
+    if (i + 1 >= argc) {
+      return false;
+    }
+
+    const std::string value = argv[++i];
+    if (argument == "--threads") {
+      options->threadCount = unsigned(std::max(1, std::atoi(value.c_str())));
+    } else if (argument == "--thread-mode") {
+      if (value == "parallel") {
+        options->threadPoolMode = THREAD_POOL_MODE::PARALLEL;
+      } else if (value == "single") {
+        options->threadPoolMode = THREAD_POOL_MODE::SINGLE_THREADED;
+      } else if (value == "deterministic") {
+        options->threadPoolMode = THREAD_POOL_MODE::DETERMINISTIC;
+      } else {
+        return false;
+      }
+    } else if (argument == "--output-dir") {
+      options->outputDirectory = value;
+    } else {
+      return false;
+    }
+  }
+
+  return !options->jobFilePath.empty();
+}
+
+int main(int argc, char **argv) {
+  BatchOptions options;
+  if (!parseOptions(argc, argv, &options)) {
+    fprintf(stderr,
+            "Usage: %s <job file> [--threads <n>] [--thread-mode parallel|single|deterministic] "
+            "[--output-dir <dir>] [--skip-existing] [--verify]\n",
+            argv[0]);
+    return 2;
+  }
+
+  std::vector<BatchJob> jobs;
+  if (!readJobFile(options, &jobs)) {
+    return 2;
+  }
+  if (options.skipExisting) {
+    std::erase_if(jobs, [](const BatchJob &job) {
+      return std::filesystem::exists(job.outputPath) &&
+             (job.normalMapPath.empty() || std::filesystem::exists(job.normalMapPath));
+    });
+  }
+
+  ThreadPool threadPool(options.threadCount, options.threadPoolMode);
+  printf("SIMD level: %s, jobs: %zu, threads: %u\n", getNoiseSIMDLevelName(), jobs.size(),
+         threadPool.threadCount());
+
+  const auto batchStart = startTimeMeasure();
+  std::atomic<size_t> finishedJobCount = 0;
+  std::atomic<int> failedJobCount = 0;
+  std::mutex printMutex;
+
+  // Every map is a job, the tiles of a map are stolen by the threads that have no map to work on
+  std::vector<JobHandle> jobHandles;
+  jobHandles.reserve(jobs.size());
+  for (size_t jobIndex = 0; jobIndex < jobs.size(); ++jobIndex) {
+    jobHandles.push_back(threadPool.schedule([&, jobIndex] {
+      const auto jobStart = startTimeMeasure();
+      const auto isWritten = runJob(jobs[jobIndex], options.verify, &threadPool);
+      failedJobCount += isWritten ? 0 : 1;
+
+      const auto finishedJobs = ++finishedJobCount;
+      std::lock_guard lock(printMutex);
+      printf("[%zu/%zu] %s %s (%.1f ms)\n", finishedJobs, jobs.size(), jobs[jobIndex].outputPath.c_str(),
+             isWritten ? "done" : "FAILED", endTimeMeasure(jobStart) / kNanoToMilliSeconds);
+      fflush(stdout);
+    }));
+  }
+  for (const auto &jobHandle : jobHandles) {
+    threadPool.wait(jobHandle);
+  }
+
+  const auto counters = threadPool.counters();
+  printf("%llu tasks, %llu stolen, workers idle for %.1f ms\n",
+         static_cast<unsigned long long>(counters.executedTaskCount),
+         static_cast<unsigned long long>(counters.stealCount), counters.idleTimeInMs);
+  printf("%zu maps in %.2f s, %d failed\n", jobs.size(),
+         endTimeMeasure(batchStart) / kNanoToMilliSeconds / 1000.0, failedJobCount.load());
+  writeMemoryReport(stdout);
+  return failedJobCount > 0 ? 1 : 0;
+}
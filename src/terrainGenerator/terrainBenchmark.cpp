@@ -0,0 +1,661 @@
+// Headless benchmarks of the CPU side of terrain generation, no window or GL context is created.
+//
+//   TerrainBenchmark [--filter <substring>] [--sizes 256,512,...] [--warmup <n>] [--repetitions <n>]
+//                    [--max-mesh-size <n>] [--json <file>] [--baseline <file>] [--threshold <percent>]
+//
+// A file written with --json can be passed back as --baseline. The exit code is 1 if the median of any
+// benchmark got slower than in the baseline by more than the threshold.
+
+#include "derivedMaps.h"
+#include "dirtyRegion.h"
+#include "falloffMapGenerator.h"
+#include "heightPyramid.h"
+#include "heightQueries.h"
+#include "heightfieldKernels.h"
+#include "noiseMapGenerator.h"
+#include "profiler.h"
+#include "terrainDefs.h"
+#include "threadPool.h"
+#include "timeMeasureUtils.h"
+#include "vertexAttributes.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <random>
+#include <sstream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+struct BenchmarkOptions {
+  std::string filter;
+  std::vector<int> sizes = {256, 512, 1024, 2048, 4096, 8192};
+  int warmup = 2;
+  int repetitions = 10;
+  // Grid meshes take 60 bytes per vertex plus 24 bytes of indices per quad, 8192^2 does not fit in memory
+  int maxMeshSize = 2048;
+  std::string jsonPath;
+  std::string baselinePath;
+  float threshold = 5.0f;
+};
+
+struct BenchmarkResult {
+  std::string name;
+  int repetitions;
+  double minInMs;
+  double medianInMs;
+  double p90InMs;
+  double p99InMs;
+  double meanInMs;
+};
+
+// Results are written here so the benchmarked work can not be optimised away
+static volatile float benchmarkSink;
+
+static constexpr double kNanoToMilliSeconds = 1000000.0;
+
+static bool isBenchmarkSelected(const BenchmarkOptions &options, const std::string &name) {
+  return options.filter.empty() || name.find(options.filter) != std::string::npos;
+}
+
+// Nearest rank on sorted samples
+static double getPercentile(const std::vector<double> &sortedSamples, const double percentile) {
+  const auto rank = int(std::ceil(percentile / 100.0 * sortedSamples.size()));
+  return sortedSamples[std::clamp(rank - 1, 0, int(sortedSamples.size()) - 1)];
+}
+
+static double getMedian(const std::vector<double> &sortedSamples) {
+  const auto middle = sortedSamples.size() / 2;
+  return sortedSamples.size() % 2 == 1 ? sortedSamples[middle]
+                                       : (sortedSamples[middle - 1] + sortedSamples[middle]) * 0.5;
+}
+
+// prepare runs before every repetition (warmup included) and is not timed, for benchmarks that work in
+// place on their input
+static void runBenchmark(const BenchmarkOptions &options, const std::string &name,
+                         const std::function<void()> &run, std::vector<BenchmarkResult> *results,
+                         const std::function<void()> &prepare = {}) {
+  for (int i = 0; i < options.warmup; ++i) {
+    if (prepare) {
+      prepare();
+    }
+    run();
+  }
+
+  std::vector<double> samples;
+  samples.reserve(options.repetitions);
+  for (int i = 0; i < options.repetitions; ++i) {
+    if (prepare) {
+      prepare();
+    }
+    const auto timeStart = startTimeMeasure();
+    run();
+    samples.push_back(endTimeMeasure(timeStart) / kNanoToMilliSeconds);
+  }
+
+  std::sort(samples.begin(), samples.end());
+  double sum = 0.0;
+  for (const auto sample : samples) {
+    sum += sample;
+  }
+
+  BenchmarkResult result = {.name = name,
+                            .repetitions = options.repetitions,
+                            .minInMs = samples.front(),
+                            .medianInMs = getMedian(samples),
+                            .p90InMs = getPercentile(samples, 90.0),
+                            .p99InMs = getPercentile(samples, 99.0),
+                            .meanInMs = sum / samples.size()};
+  printf("%-44s %12.3f %12.3f %12.3f %12.3f\n", name.c_str(), result.minInMs, result.medianInMs,
+         result.p90InMs, result.p99InMs);
+  fflush(stdout);
+  results->push_back(std::move(result));
+}
+
+static NoiseMapData getBenchmarkNoiseMapData(const int mapSize, const int octaves,
+                                             const NOISE_BACKEND noiseBackend) {
+  NoiseMapData noiseMapData = {};
+  noiseMapData.width = noiseMapData.height = mapSize;
+  noiseMapData.scale = 1.0f;
+  noiseMapData.octaves = octaves;
+  noiseMapData.persistance = 0.366f;
+  noiseMapData.lacunarity = 2.0f;
+  noiseMapData.seed = 1;
+  noiseMapData.octaveOffset = glm::vec2(0.0f, 444.0f);
+  noiseMapData.noiseBackend = noiseBackend;
+  return noiseMapData;
+}
+
+static void runNoiseMapBenchmarks(const BenchmarkOptions &options, const int mapSize,
+                                  std::vector<BenchmarkResult> *results) {
+  const std::pair<NOISE_BACKEND, const char *> noiseBackends[] = {{NOISE_BACKEND::SCALAR, "scalar"},
+                                                                  {NOISE_BACKEND::SIMD, "simd"}};
+  for (const auto &[noiseBackend, noiseBackendName] : noiseBackends) {
+    for (const auto octaves : {1, 4, 8}) {
+      const auto name = "noiseMap/" + std::string(noiseBackendName) + "/" + std::to_string(mapSize) +
+                        "/octaves" + std::to_string(octaves);
+      if (!isBenchmarkSelected(options, name)) {
+        continue;
+      }
+
+      const auto noiseMapData = getBenchmarkNoiseMapData(mapSize, octaves, noiseBackend);
+      runBenchmark(options, name, [&]() { benchmarkSink = generateNoiseMap(noiseMapData, false).at(0, 0); },
+                   results);
+    }
+  }
+}
+
+// The post-process as it was before it was fused, for comparison: a pass over the whole map per step, the
+// falloff read column by column from a three channel map and the curve polynomial evaluated per texel
+static void postProcessInSeparatePasses(const float minNoiseHeight, const float noiseHeightDiffInverse,
+                                        const std::vector<glm::vec3> &falloffMap,
+                                        const std::vector<float> &curveCoefficients, NoiseMap *noiseMap) {
+  const auto mapSize = noiseMap->width();
+  for (int i = 0; i < mapSize; ++i) {
+    for (auto &value : noiseMap->row(i)) {
+      value = (value - minNoiseHeight) * noiseHeightDiffInverse;
+    }
+  }
+
+  for (int i = 0; i < mapSize; ++i) {
+    const auto noiseValues = noiseMap->row(i);
+    for (int j = 0; j < mapSize; ++j) {
+      noiseValues[j] = glm::clamp(noiseValues[j] - falloffMap[size_t(mapSize) * j + i].x, 0.0f, 1.0f);
+    }
+  }
+
+  for (int i = 0; i < mapSize; ++i) {
+    for (auto &value : noiseMap->row(i)) {
+      auto curveValue = 0.0f;
+      for (auto coefficient = curveCoefficients.rbegin(); coefficient != curveCoefficients.rend();
+           ++coefficient) {
+        curveValue = curveValue * value + *coefficient;
+      }
+      value = glm::clamp(curveValue, 0.0f, 1.0f);
+    }
+  }
+}
+
+// The fused normalise, falloff and height curve pass on its own, on the calling thread, next to the separate
+// passes it replaced. The default sizes go up to 8192^2, where the map no longer fits in any cache and the
+// difference is the memory traffic.
+static void runPostProcessBenchmark(const BenchmarkOptions &options, const int mapSize,
+                                    std::vector<BenchmarkResult> *results) {
+  const auto name = "postProcess/" + std::to_string(mapSize);
+  const auto separatePassesName = "postProcess/separatePasses/" + std::to_string(mapSize);
+  const auto runFused = isBenchmarkSelected(options, name);
+  const auto runSeparatePasses = isBenchmarkSelected(options, separatePassesName);
+  if (!runFused && !runSeparatePasses) {
+    return;
+  }
+
+  const auto noiseMapData = getBenchmarkNoiseMapData(mapSize, 4, NOISE_BACKEND::SIMD);
+  const auto rawNoiseMap = generateNoiseMap(noiseMapData, false);
+  const auto falloffMap = getFalloffMap(mapSize);
+  auto minNoiseHeight = rawNoiseMap.at(0, 0);
+  auto maxNoiseHeight = minNoiseHeight;
+  for (int i = 0; i < mapSize; ++i) {
+    const auto [minRowHeight, maxRowHeight] =
+        std::minmax_element(rawNoiseMap.row(i).begin(), rawNoiseMap.row(i).end());
+    minNoiseHeight = std::min(minNoiseHeight, *minRowHeight);
+    maxNoiseHeight = std::max(maxNoiseHeight, *maxRowHeight);
+  }
+  const auto noiseHeightDiffInverse = 1.0f / std::max(maxNoiseHeight - minNoiseHeight, 1e-6f);
+
+  NoiseMap noiseMap(mapSize, mapSize);
+  const auto prepare = [&]() {
+    std::memcpy(noiseMap.data(), rawNoiseMap.data(), rawNoiseMap.sizeInBytes());
+  };
+
+  if (runSeparatePasses) {
+    // The falloff map layout of the time, one vec3 per texel
+    std::vector<glm::vec3> threeChannelFalloffMap(size_t(mapSize) * size_t(mapSize));
+    for (int i = 0; i < mapSize; ++i) {
+      for (int j = 0; j < mapSize; ++j) {
+        threeChannelFalloffMap[size_t(mapSize) * i + j] = glm::vec3(falloffMap->at(j, i));
+      }
+    }
+
+    const auto run = [&]() {
+      postProcessInSeparatePasses(minNoiseHeight, noiseHeightDiffInverse, threeChannelFalloffMap,
+                                  noiseMapData.heightCurve.coefficients, &noiseMap);
+      benchmarkSink = noiseMap.at(0, 0);
+    };
+    runBenchmark(options, separatePassesName, run, results, prepare);
+  }
+
+  if (runFused) {
+    const auto heightCurveTable = bakeHeightCurve(noiseMapData.heightCurve);
+    const auto run = [&]() {
+      for (int i = 0; i < mapSize; ++i) {
+        postProcessNoiseRow(noiseMap.row(i).data(), falloffMap->row(i).data(), minNoiseHeight,
+                            noiseHeightDiffInverse, heightCurveTable.data(), int(heightCurveTable.size()),
+                            noiseMap.stride());
+      }
+      benchmarkSink = noiseMap.at(0, 0);
+    };
+    runBenchmark(options, name, run, results, prepare);
+  }
+
+  if (runFused && runSeparatePasses) {
+    const auto &fused = results->back();
+    const auto &separatePasses = results->end()[-2];
+    printf("%-44s %12s %11.2fx faster than separate passes\n", "", "",
+           separatePasses.medianInMs / fused.medianInMs);
+  }
+}
+
+static void runFalloffMapBenchmark(const BenchmarkOptions &options, const int mapSize,
+                                   std::vector<BenchmarkResult> *results) {
+  const auto name = "falloffMap/" + std::to_string(mapSize);
+  if (!isBenchmarkSelected(options, name)) {
+    return;
+  }
+
+  runBenchmark(options, name, [&]() { benchmarkSink = generateFalloffMap(mapSize).at(0, 0); }, results);
+}
+
+static void runNoiseMapTextureBenchmark(const BenchmarkOptions &options, const int mapSize,
+                                        std::vector<BenchmarkResult> *results) {
+  const auto name = "noiseMapTexture/" + std::to_string(mapSize);
+  if (!isBenchmarkSelected(options, name)) {
+    return;
+  }
+
+  const auto noiseMap = generateNoiseMap(getBenchmarkNoiseMapData(mapSize, 4, NOISE_BACKEND::SIMD), false);
+  runBenchmark(options, name, [&]() { benchmarkSink = generateNoiseMapTexture(noiseMap)[0]; }, results);
+}
+
+// A full build, and an update after a 64^2 texel edit like a brush stroke would make
+static void runHeightPyramidBenchmarks(const BenchmarkOptions &options, const int mapSize,
+                                       std::vector<BenchmarkResult> *results) {
+  const auto buildName = "heightPyramid/build/" + std::to_string(mapSize);
+  const auto updateName = "heightPyramid/update/" + std::to_string(mapSize);
+  if (!isBenchmarkSelected(options, buildName) && !isBenchmarkSelected(options, updateName)) {
+    return;
+  }
+
+  const auto noiseMap = generateNoiseMap(getBenchmarkNoiseMapData(mapSize, 4, NOISE_BACKEND::SIMD), false);
+  HeightPyramid heightPyramid;
+  if (isBenchmarkSelected(options, buildName)) {
+    runBenchmark(
+        options, buildName,
+        [&]() {
+          heightPyramid.build(noiseMap);
+          benchmarkSink = heightPyramid.cellRange(heightPyramid.levelCount() - 1, 0, 0).y;
+        },
+        results);
+  }
+
+  if (isBenchmarkSelected(options, updateName)) {
+    heightPyramid.build(noiseMap);
+    const auto editSize = std::min(64, mapSize);
+    const auto editStart = (mapSize - editSize) / 2 + 3;
+    const HeightRect editRect = {editStart, editStart, editSize, editSize};
+    runBenchmark(
+        options, updateName,
+        [&]() {
+          heightPyramid.update(noiseMap, editRect);
+          benchmarkSink = heightPyramid.cellRange(heightPyramid.levelCount() - 1, 0, 0).y;
+        },
+        results);
+  }
+}
+
+// Texture regions of a regeneration that changed 64^2 texels, found by comparing against the previous map
+static void runDirtyRegionBenchmark(const BenchmarkOptions &options, const int mapSize,
+                                    std::vector<BenchmarkResult> *results) {
+  const auto name = "dirtyRegion/changedTexture/" + std::to_string(mapSize);
+  if (!isBenchmarkSelected(options, name)) {
+    return;
+  }
+
+  const auto previousMap = generateNoiseMap(getBenchmarkNoiseMapData(mapSize, 4, NOISE_BACKEND::SIMD), false);
+  auto nextMap = previousMap.clone();
+  const auto editSize = std::min(64, mapSize);
+  const auto editStart = (mapSize - editSize) / 2 + 3;
+  for (int i = editStart; i < std::min(editStart + editSize, mapSize); ++i) {
+    for (int j = editStart; j < std::min(editStart + editSize, mapSize); ++j) {
+      nextMap.at(j, i) += 0.01f;
+    }
+  }
+
+  DirtyRegion dirtyRegion(mapSize, mapSize);
+  runBenchmark(
+      options, name,
+      [&]() {
+        dirtyRegion.clear();
+        dirtyRegion.addChanges(previousMap, nextMap);
+        const HeightfieldView nextMapView = nextMap;
+        for (const auto &rect : dirtyRegion.rects()) {
+          benchmarkSink = float(generateNoiseMapTexture(nextMapView.subview(rect)).back());
+        }
+      },
+      results);
+}
+
+// Empty zones back to back, the cost PROFILE_ZONE adds to every scope it times. Not tied to a map size.
+static void runProfileZoneBenchmark(const BenchmarkOptions &options, std::vector<BenchmarkResult> *results) {
+  constexpr int kZoneCount = 1 << 20;
+
+  const std::string name = "profileZone";
+  if (!isBenchmarkSelected(options, name)) {
+    return;
+  }
+
+  runBenchmark(
+      options, name,
+      [&]() {
+        for (int i = 0; i < kZoneCount; ++i) {
+          ProfileZone zone("profileZone");
+        }
+      },
+      results);
+  printf("%-44s %12s %12.1f ns per zone\n", "", "",
+         results->back().medianInMs * kNanoToMilliSeconds / kZoneCount);
+}
+
+// Batched queries at random positions over the map, and rays looking down at it from random points above
+static void runHeightQueryBenchmarks(const BenchmarkOptions &options, const int mapSize,
+                                     std::vector<BenchmarkResult> *results) {
+  constexpr int kQueryCount = 1 << 20;
+  constexpr int kRayCount = 1 << 16;
+
+  const auto heightsName = "heightQueries/heights/" + std::to_string(mapSize);
+  const auto normalsName = "heightQueries/normals/" + std::to_string(mapSize);
+  const auto raysName = "heightQueries/rays/" + std::to_string(mapSize);
+  if (!isBenchmarkSelected(options, heightsName) && !isBenchmarkSelected(options, normalsName) &&
+      !isBenchmarkSelected(options, raysName)) {
+    return;
+  }
+
+  const TerrainData terrainData = {};
+  const auto noiseMap = generateNoiseMap(getBenchmarkNoiseMapData(mapSize, 4, NOISE_BACKEND::SIMD), false);
+  HeightPyramid heightPyramid;
+  heightPyramid.build(noiseMap);
+  const HeightQueries heightQueries(noiseMap, heightPyramid, terrainData.gridPointSpacing,
+                                    terrainData.heightMultiplier);
+
+  std::mt19937 random(1);
+  const auto terrainSize = float(mapSize - 1) * terrainData.gridPointSpacing;
+  std::uniform_real_distribution<float> randomPosition(0.0f, terrainSize);
+  std::vector<glm::vec2> positions(kQueryCount);
+  for (auto &position : positions) {
+    position = glm::vec2(randomPosition(random), randomPosition(random));
+  }
+
+  if (isBenchmarkSelected(options, heightsName)) {
+    std::vector<float> heights(kQueryCount);
+    runBenchmark(
+        options, heightsName,
+        [&]() {
+          heightQueries.getHeights(positions.data(), kQueryCount, heights.data());
+          benchmarkSink = heights[0];
+        },
+        results);
+  }
+
+  if (isBenchmarkSelected(options, normalsName)) {
+    std::vector<glm::vec3> normals(kQueryCount);
+    runBenchmark(
+        options, normalsName,
+        [&]() {
+          heightQueries.getNormals(positions.data(), kQueryCount, normals.data());
+          benchmarkSink = normals[0].y;
+        },
+        results);
+  }
+
+  if (isBenchmarkSelected(options, raysName)) {
+    const auto rayHeight = 1.5f * terrainData.heightMultiplier * terrainData.gridPointSpacing;
+    std::uniform_real_distribution<float> randomDirection(-1.0f, 1.0f);
+    std::vector<TerrainRay> rays(kRayCount);
+    for (auto &ray : rays) {
+      ray.origin = glm::vec3(randomPosition(random), rayHeight, randomPosition(random));
+      ray.direction = glm::normalize(glm::vec3(randomDirection(random), -0.3f, randomDirection(random)));
+      ray.maxT = terrainSize;
+    }
+
+    std::vector<TerrainRayHit> hits(kRayCount);
+    runBenchmark(
+        options, raysName,
+        [&]() { benchmarkSink = float(heightQueries.castRays(rays.data(), kRayCount, hits.data())); },
+        results);
+  }
+}
+
+// Triangulated grid with one vertex per texel, like a mesh displaced on the CPU would be
+static void generateGridMesh(const NoiseMap &noiseMap, std::vector<Vertex> *vertices,
+                             std::vector<uint32_t> *indices) {
+  const auto width = noiseMap.width();
+  const auto height = noiseMap.height();
+
+  vertices->assign(size_t(width) * size_t(height), Vertex{});
+  for (int i = 0; i < height; ++i) {
+    for (int j = 0; j < width; ++j) {
+      auto &vertex = (*vertices)[size_t(i) * width + j];
+      vertex.position3f = glm::vec3(float(j), noiseMap.at(j, i) * 64.0f, float(i));
+      vertex.textureCoordinate = glm::vec2(j / float(width - 1), i / float(height - 1));
+    }
+  }
+
+  indices->clear();
+  indices->reserve(size_t(width - 1) * size_t(height - 1) * 6);
+  for (int i = 0; i < height - 1; ++i) {
+    for (int j = 0; j < width - 1; ++j) {
+      const auto topLeft = uint32_t(i * width + j);
+      const auto bottomLeft = uint32_t((i + 1) * width + j);
+      indices->insert(indices->end(),
+                      {topLeft, bottomLeft, topLeft + 1, topLeft + 1, bottomLeft, bottomLeft + 1});
+    }
+  }
+}
+
+static void runVertexAttributeBenchmarks(const BenchmarkOptions &options, const int mapSize,
+                                         std::vector<BenchmarkResult> *results) {
+  const auto normalsName = "normals/" + std::to_string(mapSize);
+  const auto tangentsName = "tangents/" + std::to_string(mapSize);
+  const auto runNormals = isBenchmarkSelected(options, normalsName);
+  const auto runTangents = isBenchmarkSelected(options, tangentsName);
+  if (mapSize > options.maxMeshSize || (!runNormals && !runTangents)) {
+    return;
+  }
+
+  std::vector<Vertex> vertices;
+  std::vector<uint32_t> indices;
+  const auto noiseMap = generateNoiseMap(getBenchmarkNoiseMapData(mapSize, 4, NOISE_BACKEND::SIMD), false);
+  generateGridMesh(noiseMap, &vertices, &indices);
+
+  // Both accumulate in to the vertices, so they are reset before every repetition
+  if (runNormals) {
+    const auto prepare = [&]() {
+      for (auto &vertex : vertices) {
+        vertex.normal = glm::vec3(0.0f);
+      }
+    };
+    runBenchmark(options, normalsName, [&]() { calculateNormals(indices, &vertices); }, results, prepare);
+  }
+
+  if (runTangents) {
+    for (auto &vertex : vertices) {
+      vertex.normal = glm::vec3(0.0f);
+    }
+    calculateNormals(indices, &vertices);
+
+    const auto prepare = [&]() {
+      for (auto &vertex : vertices) {
+        vertex.tangent = vertex.bitangent = glm::vec3(0.0f);
+      }
+    };
+    runBenchmark(
+        options, tangentsName, [&]() { calculateTangentVectors(indices, &vertices); }, results, prepare);
+  }
+  benchmarkSink = vertices[0].normal.y + vertices[0].tangent.x;
+}
+
+static bool writeResults(const std::string &jsonPath, const std::vector<BenchmarkResult> &results) {
+  std::ofstream file(jsonPath);
+  if (!file) {
+    return false;
+  }
+
+  // One benchmark per line, readBaseline relies on it
+  file << "{\n";
+  file << "  \"simdLevel\": \"" << getNoiseSIMDLevelName() << "\",\n";
+  file << "  \"threadCount\": " << getThreadPool().threadCount() << ",\n";
+  file << "  \"benchmarks\": [\n";
+  for (size_t i = 0; i < results.size(); ++i) {
+    const auto &result = results[i];
+    char line[512];
+    snprintf(line, sizeof(line),
+             "    {\"name\": \"%s\", \"repetitions\": %d, \"minMs\": %.6f, \"medianMs\": %.6f, "
+             "\"p90Ms\": %.6f, \"p99Ms\": %.6f, \"meanMs\": %.6f}%s\n",
+             result.name.c_str(), result.repetitions, result.minInMs, result.medianInMs, result.p90InMs,
+             result.p99InMs, result.meanInMs, i + 1 < results.size() ? "," : "");
+    file << line;
+  }
+  file << "  ]\n";
+  file << "}\n";
+  return bool(file);
+}
+
+// Median per benchmark name from a file written by writeResults
+static bool readBaseline(const std::string &baselinePath, std::unordered_map<std::string, double> *baseline) {
+  std::ifstream file(baselinePath);
+  if (!file) {
+    return false;
+  }
+
+  const std::string nameKey = "\"name\": \"";
+  const std::string medianKey = "\"medianMs\": ";
+  std::string line;
+  while (std::getline(file, line)) {
+    const auto namePos = line.find(nameKey);
+    const auto medianPos = line.find(medianKey);
+    if (namePos == std::string::npos || medianPos == std::string::npos) {
+      continue;
+    }
+
+    const auto nameStart = namePos + nameKey.size();
+    const auto name = line.substr(nameStart, line.find('"', nameStart) - nameStart);
+    (*baseline)[name] = std::strtod(line.c_str() + medianPos + medianKey.size(), nullptr);
+  }
+  return true;
+}
+
+// Returns the number of regressions
+static int compareWithBaseline(const std::vector<BenchmarkResult> &results,
+                               const std::unordered_map<std::string, double> &baseline,
+                               const float threshold) {
+  printf("\n%-44s %12s %12s %9s\n", "Compared to baseline", "base (ms)", "median (ms)", "change");
+
+  int regressionCount = 0;
+  for (const auto &result : results) {
+    const auto baselineIt = baseline.find(result.name);
+    if (baselineIt == baseline.end() || baselineIt->second <= 0.0) {
+      printf("%-44s %12s %12.3f %9s\n", result.name.c_str(), "-", result.medianInMs, "new");
+      continue;
+    }
+
+    const auto change = (result.medianInMs / baselineIt->second - 1.0) * 100.0;
+    const auto isRegression = change > threshold;
+    regressionCount += isRegression ? 1 : 0;
+    printf("%-44s %12.3f %12.3f %+8.1f%%%s\n", result.name.c_str(), baselineIt->second, result.medianInMs,
+           change, isRegression ? "  REGRESSION" : "");
+  }
+
+  return regressionCount;
+}
+
+static std::vector<int> parseSizes(const std::string &sizesArgument) {
+  std::vector<int> sizes;
+  std::stringstream stream(sizesArgument);
+  std::string size;
+  while (std::getline(stream, size, ',')) {
+    sizes.push_back(std::atoi(size.c_str()));
+  }
+  return sizes;
+}
+
+static bool parseOptions(const int argc, char **argv, BenchmarkOptions *options) {
+  for (int i = 1; i < argc; ++i) {
+    const std::string argument = argv[i];
+    if (i + 1 >= argc) {
+      return false;
+    }
+
+    const std::string value = argv[++i];
+    if (argument == "--filter") {
+      options->filter = value;
+    } else if (argument == "--sizes") {
+      options->sizes = parseSizes(value);
+    } else if (argument == "--warmup") {
+      options->warmup = std::max(0, std::atoi(value.c_str()));
+    } else if (argument == "--repetitions") {
+      options->repetitions = std::max(1, std::atoi(value.c_str()));
+    } else if (argument == "--max-mesh-size") {
+      options->maxMeshSize = std::atoi(value.c_str());
+    } else if (argument == "--json") {
+      options->jsonPath = value;
+    } else if (argument == "--baseline") {
+      options->baselinePath = value;
+    } else if (argument == "--threshold") {
+      options->threshold = float(std::atof(value.c_str()));
+    } else {
+      return false;
+    }
+  }
+
+  return std::all_of(options->sizes.begin(), options->sizes.end(), [](const int size) { return size >= 2; });
+}
+
+int main(int argc, char **argv) {
+  BenchmarkOptions options;
+  if (!parseOptions(argc, argv, &options)) {
+    fprintf(stderr,
+            "Usage: %s [--filter <substring>] [--sizes 256,512,...] [--warmup <n>] [--repetitions <n>]\n"
+            "       [--max-mesh-size <n>] [--json <file>] [--baseline <file>] [--threshold <percent>]\n",
+            argv[0]);
+    return 2;
+  }
+
+  printf("SIMD level: %s, threads: %u, warmup: %d, repetitions: %d\n\n", getNoiseSIMDLevelName(),
+         getThreadPool().threadCount(), options.warmup, options.repetitions);
+  printf("%-44s %12s %12s %12s %12s\n", "Benchmark", "min (ms)", "median (ms)", "p90 (ms)", "p99 (ms)");
+
+  std::vector<BenchmarkResult> results;
+  runProfileZoneBenchmark(options, &results);
+  for (const auto mapSize : options.sizes) {
+    runNoiseMapBenchmarks(options, mapSize, &results);
+    runPostProcessBenchmark(options, mapSize, &results);
+    runFalloffMapBenchmark(options, mapSize, &results);
+    runNoiseMapTextureBenchmark(options, mapSize, &results);
+    runHeightPyramidBenchmarks(options, mapSize, &results);
+    runDirtyRegionBenchmark(options, mapSize, &results);
+    runHeightQueryBenchmarks(options, mapSize, &results);
+    runVertexAttributeBenchmarks(options, mapSize, &results);
+  }
+
+  if (!options.jsonPath.empty() && !writeResults(options.jsonPath, results)) {
+    fprintf(stderr, "Could not write %s\n", options.jsonPath.c_str());
+    return 2;
+  }
+
+  if (!options.baselinePath.empty()) {
+    std::unordered_map<std::string, double> baseline;
+    if (!readBaseline(options.baselinePath, &baseline)) {
+      fprintf(stderr, "Could not read %s\n", options.baselinePath.c_str());
+      return 2;
+    }
+
+    if (compareWithBaseline(results, baseline, options.threshold) > 0) {
+      return 1;
+    }
+  }
+
+  return 0;
+}
@@ -28,6 +28,9 @@ struct TerrainData {
   int terrainCount;
 
   bool useFalloffMap = true;
+  bool useNoiseLayerCache = false;
+  bool useNoiseMapCache = true;
+  bool useProgressivePreview = true; // Show coarse levels first while the terrain regenerates
 };
 
 inline TerrainData initDefaultTerrainData() {
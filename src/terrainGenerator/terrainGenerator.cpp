@@ -7,21 +7,30 @@
 
 #include "camera.h"
 #include "falloffMapGenerator.h"
+#include "frameStatistics.h"
 #include "glm\glm.hpp"
 #include "glm\gtc\matrix_transform.hpp"
 #include "glm\gtc\type_ptr.hpp"
 #include "lightDefs.h"
+#include "linearArena.h"
+#include "memoryTracking.h"
 #include "meshGenerator.h"
+#include "noiseMapCache.h"
 #include "noiseMapGenerator.h"
+#include "profiler.h"
 #include "sceneControl.h"
 #include "sceneDefs.h"
 #include "sceneRendering.h"
 #include "sceneShaders.h"
 #include "shaderLoader.h"
 #include "terrainDefs.h"
+#include "terrainRegenerator.h"
 #include "textureGenerator.h"
+#include "textureUploadQueue.h"
+#include "threadPool.h"
 #include "timeMeasureUtils.h"
 #include "uniformDefs.h"
+#include "utils.h"
 #include "windowDefs.h"
 #include <iostream>
 
@@ -29,6 +38,8 @@ WindowData windowData = {};
 SceneData sceneData = {};
 ControlInputData controlInputData = {};
 FrameTimeData frameTimeData = {};
+FrameStatistics frameStatistics;
+TextureUploadQueue textureUploadQueue;
 SceneProgramObjects sceneProgramObjects;
 SceneSettings sceneSettings = {};
 
@@ -105,14 +116,16 @@ static void initFrameBuffers() {
   glBindFramebuffer(GL_FRAMEBUFFER, sceneData.frameBufferObject.fboHandle);
 
   glGenTextures(1, &sceneData.frameBufferObject.fboTexture);
-  createTexture2D(&sceneData.frameBufferObject.fboTexture, GL_CLAMP_TO_EDGE, GL_NEAREST, windowData.width,
-                  windowData.height, GL_FLOAT, NULL);
+  createTexture2D(&sceneData.frameBufferObject.fboTexture, MEMORY_TAG::RENDER_TARGETS, GL_CLAMP_TO_EDGE,
+                  GL_NEAREST, windowData.width, windowData.height, GL_FLOAT, NULL);
   glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D,
                          sceneData.frameBufferObject.fboTexture, 0);
 
   glGenRenderbuffers(1, &sceneData.frameBufferObject.rboHandle);
   glBindRenderbuffer(GL_RENDERBUFFER, sceneData.frameBufferObject.rboHandle);
   glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT, windowData.width, windowData.height);
+  trackGpuResource(GPU_RESOURCE_TYPE::RENDERBUFFER, sceneData.frameBufferObject.rboHandle,
+                   MEMORY_TAG::RENDER_TARGETS, uint64_t(windowData.width) * uint64_t(windowData.height) * 4);
   glBindRenderbuffer(GL_RENDERBUFFER, 0);
   glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER,
                             sceneData.frameBufferObject.rboHandle);
@@ -149,6 +162,8 @@ void initGLStates() {
 }
 
 void updateScene() {
+  FrameStageTimer stageTimer(&frameStatistics, FRAME_STAGE::UPDATE_SCENE);
+
   glfwPollEvents();
 
   if (!sceneSettings.showSettings) {
@@ -163,8 +178,15 @@ void updateScene() {
     }
   } else {
     handleUIInput(&sceneSettings, &sceneData.terrainData, &sceneData.waterData, &sceneData.lightData,
-                  &sceneData.skyboxData, &sceneData.meshIdToMesh);
+                  &sceneData.skyboxData, &sceneData.meshIdToMesh, &frameStatistics);
+  }
+
+  getThreadPool().runMainThreadJobs();
+  if (auto regeneratedTerrain = getTerrainRegenerator().takeRegeneratedTerrain()) {
+    updateTerrainMeshTexture(&sceneData.meshIdToMesh.at(kTerrainMeshId), regeneratedTerrain->level,
+                             std::move(regeneratedTerrain->textureRegions), &textureUploadQueue);
   }
+  textureUploadQueue.update();
 
   sceneData.waterData.waterDistortionMoveFactor +=
       sceneData.waterData.waterDistortionSpeed * float(frameTimeData.frameTimeInSec);
@@ -180,24 +202,29 @@ void updateScene() {
 }
 
 void renderScene() {
+  PROFILE_ZONE("Render scene");
+
   glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
   const auto viewToClipMatrix = glm::perspective(
       sceneData.viewFrustumData.fieldOfView, float(windowData.width) / float(windowData.height),
       sceneData.viewFrustumData.nearPlane, sceneData.viewFrustumData.farPlane);
   switch (sceneSettings.renderMode) {
-  case SceneSettings::RENDER_MODE::NOISE_MAP:
+  case SceneSettings::RENDER_MODE::NOISE_MAP: {
+    FrameStageTimer stageTimer(&frameStatistics, FRAME_STAGE::MAP_PASS);
     renderNoiseMap(sceneData.meshIdToMesh.at(kTerrainMeshId), sceneData.fpsCamera.createViewMatrix(),
                    viewToClipMatrix, sceneProgramObjects.at(kTerrainGeneratorDebugProgramObjectName));
-    break;
-  case SceneSettings::RENDER_MODE::COLOR_MAP:
+  } break;
+  case SceneSettings::RENDER_MODE::COLOR_MAP: {
+    FrameStageTimer stageTimer(&frameStatistics, FRAME_STAGE::MAP_PASS);
     renderColorMap(windowData, sceneData, sceneData.fpsCamera.createViewMatrix(), viewToClipMatrix,
                    sceneProgramObjects);
-    break;
-  case SceneSettings::RENDER_MODE::FALLOFF_MAP:
+  } break;
+  case SceneSettings::RENDER_MODE::FALLOFF_MAP: {
+    FrameStageTimer stageTimer(&frameStatistics, FRAME_STAGE::MAP_PASS);
     renderFalloffMap(sceneData.meshIdToMesh.at(kTerrainMeshId), sceneData.fpsCamera.createViewMatrix(),
                      viewToClipMatrix, sceneProgramObjects.at(kTerrainGeneratorDebugProgramObjectName));
-    break;
+  } break;
   case SceneSettings::RENDER_MODE::MESH:
   case SceneSettings::RENDER_MODE::WIREFRAME: {
     // Move camera under water (twice distance from water to camera)
@@ -210,8 +237,11 @@ void renderScene() {
     cameraPosition.y -= distanceToMoveY;
     camera.setCameraPosition(cameraPosition);
     camera.invertPitch();
-    renderSceneReflectionTexture(sceneData, camera.createViewMatrix(), viewToClipMatrix,
+    {
+      FrameStageTimer stageTimer(&frameStatistics, FRAME_STAGE::REFLECTION_PASS);
+      renderSceneReflectionTexture(sceneData, camera.createViewMatrix(), viewToClipMatrix,
                                    sceneProgramObjects);
+    }
 
     // Change camera back to original state
     cameraPosition.y += distanceToMoveY;
@@ -219,6 +249,7 @@ void renderScene() {
     camera.invertPitch();
 
     const auto viewMatrix = camera.createViewMatrix();
+    FrameStageTimer stageTimer(&frameStatistics, FRAME_STAGE::SCENE_PASS);
     renderScene(windowData, sceneData, viewMatrix, viewToClipMatrix,
                 sceneSettings.renderMode == SceneSettings::RENDER_MODE::MESH ? false : true,
                 sceneProgramObjects);
@@ -230,29 +261,35 @@ void renderScene() {
 
   // Call here to always render UI at the very front
   if (sceneSettings.showSettings) {
+    FrameStageTimer stageTimer(&frameStatistics, FRAME_STAGE::UI);
     renderUI();
   }
 
+  FrameStageTimer stageTimer(&frameStatistics, FRAME_STAGE::SWAP_BUFFERS);
   glfwSwapBuffers(windowData.window);
 }
 
 void freeResources() {
-  for (auto &[meshId, mesh] : sceneData.meshIdToMesh) {
-    glDeleteBuffers(1, &mesh.vboHandle);
-    glDeleteBuffers(1, &mesh.iboHandle);
+  textureUploadQueue.destroy();
+
+  const auto deleteMeshResources = [](Mesh *mesh) {
+    untrackGpuResource(GPU_RESOURCE_TYPE::BUFFER, mesh->vboHandle);
+    untrackGpuResource(GPU_RESOURCE_TYPE::BUFFER, mesh->iboHandle);
+    glDeleteBuffers(1, &mesh->vboHandle);
+    glDeleteBuffers(1, &mesh->iboHandle);
 
-    for (auto &textureHandle : mesh.textureHandles) {
+    for (auto &textureHandle : mesh->textureHandles) {
+      untrackGpuResource(GPU_RESOURCE_TYPE::TEXTURE, textureHandle);
       glDeleteTextures(1, &textureHandle);
     }
+  };
+
+  for (auto &[meshId, mesh] : sceneData.meshIdToMesh) {
+    deleteMeshResources(&mesh);
   }
 
   for (auto &lightMesh : sceneData.lightMeshes) {
-    glDeleteBuffers(1, &lightMesh.vboHandle);
-    glDeleteBuffers(1, &lightMesh.iboHandle);
-
-    for (auto &textureHandle : lightMesh.textureHandles) {
-      glDeleteTextures(1, &textureHandle);
-    }
+    deleteMeshResources(&lightMesh);
   }
 
   glDeleteBuffers(1, &sceneData.frameBufferObject.fboHandle);
@@ -309,8 +346,13 @@ void initTerrainGenerator() {
 
   glfwSwapInterval(1);
 
+  setProfilerThreadName("Main");
+
   initUI(windowData.window, "#version 130");
 
+  getNoiseMapCache().setDiskCachePath(getExePath() + "/cache/noiseMaps/");
+  frameStatistics.spikeCapturePath = getExePath() + "/frameSpikes/";
+
   initGLStates();
   initSceneData();
 
@@ -318,8 +360,11 @@ void initTerrainGenerator() {
     // Measure time each frame
     updateFrameTime(&frameTimeData);
 
+    getFrameArena().reset();
+    frameStatistics.beginFrame();
     updateScene();
     renderScene();
+    frameStatistics.endFrame();
   }
 
   freeResources();
@@ -0,0 +1,470 @@
+// Checks that the SIMD noise backend stays in line with the scalar one, no window or GL context is created.
+//
+//   TerrainParity
+//
+// The scalar backend samples FastNoise's 2D Perlin noise and the SIMD backend FastNoiseSIMD's 3D Perlin
+// noise at z = 0. Their gradients are hashed differently, so the same texel of both maps is unrelated and
+// the maps can only be compared statistically:
+//
+//  - contract: each backend on its own maps octaveOffset, scale, persistance and lacunarity to sample
+//    positions and weights the same way, checked exactly on the raw noise. This is what catches the
+//    backends drifting apart.
+//  - statistics: both backends cover [0, 1] alike, with a similar mean, spread and spatial correlation.
+//  - post-process: the fused kernel both backends share matches its scalar loop bit for bit.
+//  - height queries: batched heights and normals (AVX2 if the CPU has it) match the queries one at a time
+//    bit for bit, also for positions off the map, infinite or NaN. Queries through the tile views of a tiled
+//    heightmap match them over every level, across tile seams as well.
+//
+// The exit code is 1 if any check failed.
+
+#include "falloffMapGenerator.h"
+#include "heightCurve.h"
+#include "heightPyramid.h"
+#include "heightQueries.h"
+#include "heightfieldKernels.h"
+#include "noiseMapGenerator.h"
+#include "tiledHeightQueries.h"
+#include "tiledHeightmap.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdarg>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <functional>
+#include <limits>
+#include <random>
+#include <string>
+#include <vector>
+
+// Raw noise is mapped linearly to [0, 1] with WORLD_RANGE over this range, wide enough that nothing clamps
+static constexpr float kRawNoiseRange = 4.0f;
+// Sample positions of the contract checks are the same up to float rounding
+static constexpr float kMaxContractDifference = 1e-4f;
+
+// The worst seen over the maps below is a mean difference of 0.001 (0.094 with LOCAL), a standard deviation
+// ratio within [0.85, 1.15] and an autocorrelation difference of 0.067
+static constexpr double kMaxMeanDifference = 0.02;
+static constexpr double kMaxLocalMeanDifference = 0.15; // The extremes of each map set its normalisation
+static constexpr double kMinStandardDeviationRatio = 0.8;
+static constexpr double kMaxStandardDeviationRatio = 1.25;
+static constexpr double kMaxAutocorrelationDifference = 0.1;
+// The height curve table interpolates the ends of a linear curve up to rounding
+static constexpr double kMaxLocalRangeError = 1e-4;
+static constexpr int kAutocorrelationLags[] = {1, 2, 4, 8};
+
+static const char *kNoiseBackendNames[] = {"scalar", "simd"};
+static const char *kNormalizationNames[] = {"local", "fractalBounds", "worldRange"};
+
+static int failedCheckCount = 0;
+
+// format and the arguments after it describe what was measured
+static void reportCheck(const bool passed, const std::string &name, const char *format, ...) {
+  printf("%s %s: ", passed ? "ok    " : "FAILED", name.c_str());
+  va_list arguments;
+  va_start(arguments, format);
+  vprintf(format, arguments);
+  va_end(arguments);
+  printf("\n");
+  failedCheckCount += passed ? 0 : 1;
+}
+
+static NoiseMapData getParityNoiseMapData(const int mapSize, const NOISE_BACKEND noiseBackend, const int seed,
+                                          const int octaves) {
+  NoiseMapData noiseMapData = {};
+  noiseMapData.width = noiseMapData.height = mapSize;
+  // About ten texels per noise cell, so even small maps hold enough cells for stable statistics
+  noiseMapData.scale = 0.1f;
+  noiseMapData.octaves = octaves;
+  noiseMapData.persistance = 0.366f;
+  noiseMapData.lacunarity = 2.0f;
+  noiseMapData.seed = seed;
+  noiseMapData.octaveOffset = glm::vec2(0.0f, 444.0f);
+  noiseMapData.noiseBackend = noiseBackend;
+  // Linear, so the normalised noise is compared and not the curve's flattening of the low heights
+  noiseMapData.heightCurve.coefficients = {0.0f, 1.0f};
+  return noiseMapData;
+}
+
+// The weighted octave sum before normalisation
+static NoiseMap generateRawNoiseMap(NoiseMapData noiseMapData) {
+  noiseMapData.normalization = NOISE_NORMALIZATION::WORLD_RANGE;
+  noiseMapData.worldNoiseRange = glm::vec2(-kRawNoiseRange, kRawNoiseRange);
+  auto noiseMap = generateNoiseMap(noiseMapData, false);
+  for (int i = 0; i < noiseMap.height(); ++i) {
+    for (auto &value : noiseMap.row(i)) {
+      value = value * 2.0f * kRawNoiseRange - kRawNoiseRange;
+    }
+  }
+  return noiseMap;
+}
+
+// Largest difference of expected(x, y) and the texels of noiseMap in [beginX, endX) x [beginY, endY)
+static float getMaxDifference(const NoiseMap &noiseMap, const int beginX, const int endX, const int beginY,
+                              const int endY, const std::function<float(int x, int y)> &expected) {
+  float maxDifference = 0.0f;
+  for (int i = beginY; i < endY; ++i) {
+    for (int j = beginX; j < endX; ++j) {
+      maxDifference = std::max(maxDifference, std::abs(noiseMap.at(j, i) - expected(j, i)));
+    }
+  }
+  return maxDifference;
+}
+
+static void checkNoiseContract(const NOISE_BACKEND noiseBackend, const int mapSize, const int seed) {
+  const auto prefix = "contract/" + std::string(kNoiseBackendNames[int(noiseBackend)]) + "/" +
+                      std::to_string(mapSize) + "/seed" + std::to_string(seed);
+  const auto noiseMapData = getParityNoiseMapData(mapSize, noiseBackend, seed, 4);
+  const auto rawNoiseMap = generateRawNoiseMap(noiseMapData);
+
+  // Moving the offset by whole texels moves the map, +x to the left and +y down
+  constexpr int kShift = 16;
+  auto shiftedNoiseMapData = noiseMapData;
+  shiftedNoiseMapData.octaveOffset.x += kShift;
+  auto maxDifference = getMaxDifference(generateRawNoiseMap(shiftedNoiseMapData), 0, mapSize - kShift, 0,
+                                        mapSize, [&](const int x, const int y) {
+                                          return rawNoiseMap.at(x + kShift, y);
+                                        });
+  reportCheck(maxDifference <= kMaxContractDifference, prefix + "/offsetX",
+              "max difference %g", maxDifference);
+
+  shiftedNoiseMapData = noiseMapData;
+  shiftedNoiseMapData.octaveOffset.y += kShift;
+  maxDifference = getMaxDifference(generateRawNoiseMap(shiftedNoiseMapData), 0, mapSize, kShift, mapSize,
+                                   [&](const int x, const int y) { return rawNoiseMap.at(x, y - kShift); });
+  reportCheck(maxDifference <= kMaxContractDifference, prefix + "/offsetY",
+              "max difference %g", maxDifference);
+
+  // The map is scaled around its centre: with twice the scale, even texels are the texels half as far from
+  // the centre. Without an offset, so the offset does not move the centre.
+  auto centeredNoiseMapData = noiseMapData;
+  centeredNoiseMapData.octaveOffset = glm::vec2(0.0f);
+  const auto centeredNoiseMap = generateRawNoiseMap(centeredNoiseMapData);
+  auto scaledNoiseMapData = centeredNoiseMapData;
+  scaledNoiseMapData.scale *= 2.0f;
+  const auto scaledNoiseMap = generateRawNoiseMap(scaledNoiseMapData);
+  const auto halfMapSize = mapSize / 2;
+  maxDifference = 0.0f;
+  for (int i = 0; i < mapSize; i += 2) {
+    for (int j = 0; j < mapSize; j += 2) {
+      const auto expected =
+          centeredNoiseMap.at(halfMapSize + (j - halfMapSize) / 2, halfMapSize + (i - halfMapSize) / 2);
+      maxDifference = std::max(maxDifference, std::abs(scaledNoiseMap.at(j, i) - expected));
+    }
+  }
+  reportCheck(maxDifference <= kMaxContractDifference, prefix + "/scale",
+              "max difference %g", maxDifference);
+
+  // Octave o is the first octave at scale / lacunarity^o, weighted by persistance^o
+  auto twoOctaveNoiseMapData = noiseMapData;
+  twoOctaveNoiseMapData.octaves = 2;
+  auto firstOctaveNoiseMapData = noiseMapData;
+  firstOctaveNoiseMapData.octaves = 1;
+  auto secondOctaveNoiseMapData = firstOctaveNoiseMapData;
+  secondOctaveNoiseMapData.scale /= noiseMapData.lacunarity;
+  const auto firstOctaveNoiseMap = generateRawNoiseMap(firstOctaveNoiseMapData);
+  const auto secondOctaveNoiseMap = generateRawNoiseMap(secondOctaveNoiseMapData);
+  maxDifference = getMaxDifference(generateRawNoiseMap(twoOctaveNoiseMapData), 0, mapSize, 0, mapSize,
+                                   [&](const int x, const int y) {
+                                     return firstOctaveNoiseMap.at(x, y) +
+                                            noiseMapData.persistance * secondOctaveNoiseMap.at(x, y);
+                                   });
+  reportCheck(maxDifference <= kMaxContractDifference, prefix + "/octaves",
+              "max difference %g", maxDifference);
+}
+
+struct MapStatistics {
+  double min = 0.0;
+  double max = 0.0;
+  double mean = 0.0;
+  double standardDeviation = 0.0;
+  std::vector<double> autocorrelations; // At kAutocorrelationLags, over rows and columns
+};
+
+static MapStatistics getMapStatistics(const NoiseMap &noiseMap) {
+  MapStatistics statistics = {noiseMap.at(0, 0), noiseMap.at(0, 0)};
+  double sum = 0.0;
+  double squaredSum = 0.0;
+  for (int i = 0; i < noiseMap.height(); ++i) {
+    for (const auto value : noiseMap.row(i)) {
+      statistics.min = std::min(statistics.min, double(value));
+      statistics.max = std::max(statistics.max, double(value));
+      sum += value;
+      squaredSum += double(value) * value;
+    }
+  }
+
+  const auto texelCount = double(noiseMap.width()) * noiseMap.height();
+  statistics.mean = sum / texelCount;
+  const auto variance = std::max(squaredSum / texelCount - statistics.mean * statistics.mean, 0.0);
+  statistics.standardDeviation = std::sqrt(variance);
+
+  for (const auto lag : kAutocorrelationLags) {
+    double covariance = 0.0;
+    for (int i = 0; i < noiseMap.height() - lag; ++i) {
+      for (int j = 0; j < noiseMap.width() - lag; ++j) {
+        const auto value = noiseMap.at(j, i) - statistics.mean;
+        covariance += value * (noiseMap.at(j + lag, i) - statistics.mean) +
+                      value * (noiseMap.at(j, i + lag) - statistics.mean);
+      }
+    }
+    const auto pairCount = 2.0 * (noiseMap.width() - lag) * (noiseMap.height() - lag);
+    statistics.autocorrelations.push_back(covariance / pairCount / variance);
+  }
+  return statistics;
+}
+
+static void checkBackendStatistics(const int mapSize, const int seed, const int octaves,
+                                   const NOISE_NORMALIZATION normalization, const bool useFalloffMap) {
+  const auto name = "statistics/" + std::to_string(mapSize) + "/seed" + std::to_string(seed) + "/octaves" +
+                    std::to_string(octaves) + "/" + kNormalizationNames[int(normalization)] +
+                    (useFalloffMap ? "/falloff" : "");
+
+  auto noiseMapData = getParityNoiseMapData(mapSize, NOISE_BACKEND::SCALAR, seed, octaves);
+  noiseMapData.normalization = normalization;
+  const auto scalar = getMapStatistics(generateNoiseMap(noiseMapData, useFalloffMap));
+  noiseMapData.noiseBackend = NOISE_BACKEND::SIMD;
+  const auto simd = getMapStatistics(generateNoiseMap(noiseMapData, useFalloffMap));
+
+  const auto isInUnitRange = scalar.min >= 0.0 && scalar.max <= 1.0 && simd.min >= 0.0 && simd.max <= 1.0;
+  // LOCAL stretches every map to cover [0, 1], unless the falloff lowers the heights afterwards
+  const auto coversLocalRange =
+      normalization != NOISE_NORMALIZATION::LOCAL || useFalloffMap ||
+      (scalar.min <= kMaxLocalRangeError && simd.min <= kMaxLocalRangeError &&
+       scalar.max >= 1.0 - kMaxLocalRangeError && simd.max >= 1.0 - kMaxLocalRangeError);
+  const auto maxMeanDifference =
+      normalization == NOISE_NORMALIZATION::LOCAL ? kMaxLocalMeanDifference : kMaxMeanDifference;
+  const auto standardDeviationRatio = simd.standardDeviation / scalar.standardDeviation;
+  double maxAutocorrelationDifference = 0.0;
+  for (size_t i = 0; i < scalar.autocorrelations.size(); ++i) {
+    maxAutocorrelationDifference = std::max(maxAutocorrelationDifference,
+                                            std::abs(scalar.autocorrelations[i] - simd.autocorrelations[i]));
+  }
+
+  const auto passed = isInUnitRange && coversLocalRange &&
+                      std::abs(scalar.mean - simd.mean) <= maxMeanDifference &&
+                      standardDeviationRatio >= kMinStandardDeviationRatio &&
+                      standardDeviationRatio <= kMaxStandardDeviationRatio &&
+                      maxAutocorrelationDifference <= kMaxAutocorrelationDifference;
+  reportCheck(passed, name,
+              "range [%.3f, %.3f] vs [%.3f, %.3f], mean %.3f vs %.3f, stddev ratio %.2f, "
+              "autocorrelation difference %.3f",
+              scalar.min, scalar.max, simd.min, simd.max, scalar.mean, simd.mean, standardDeviationRatio,
+              maxAutocorrelationDifference);
+}
+
+// The plain loop postProcessNoiseRow falls back to without SSE2
+static void postProcessNoiseRowReference(float *noiseValues, const float *falloffValues,
+                                         const float minNoiseHeight, const float noiseHeightDiffInverse,
+                                         const HeightCurveTable &heightCurveTable, const int count) {
+  const auto lastTableSegment = float(heightCurveTable.size() - 2);
+  const auto tableScale = float(heightCurveTable.size() - 1);
+  for (int i = 0; i < count; ++i) {
+    auto value = (noiseValues[i] - minNoiseHeight) * noiseHeightDiffInverse;
+
+    if (falloffValues != nullptr) {
+      value -= falloffValues[i];
+    }
+    value = std::min(std::max(value, 0.0f), 1.0f);
+
+    const auto tablePosition = value * tableScale;
+    const auto tableIndex = int(std::min(tablePosition, lastTableSegment));
+    const auto fraction = tablePosition - float(tableIndex);
+    const auto a = heightCurveTable[tableIndex];
+    const auto b = heightCurveTable[tableIndex + 1];
+    noiseValues[i] = a + (b - a) * fraction;
+  }
+}
+
+static void checkPostProcessKernel(const int mapSize, const bool useFalloffMap) {
+  // Raw noise beyond the normalisation range on both sides, so the clamps are covered as well
+  std::mt19937 random{uint32_t(mapSize)};
+  std::uniform_real_distribution<float> rawNoise(-1.2f, 1.2f);
+  NoiseMap noiseMap(mapSize, mapSize);
+  NoiseMap referenceNoiseMap(mapSize, mapSize);
+  for (int i = 0; i < mapSize; ++i) {
+    for (auto &value : noiseMap.row(i)) {
+      value = rawNoise(random);
+    }
+    std::memcpy(referenceNoiseMap.row(i).data(), noiseMap.row(i).data(), noiseMap.row(i).size_bytes());
+  }
+
+  const auto falloffMap = getFalloffMap(mapSize);
+  const auto heightCurveTable = bakeHeightCurve(HeightCurve());
+  const auto minNoiseHeight = -1.0f;
+  const auto noiseHeightDiffInverse = 1.0f / 2.0f;
+  auto passed = true;
+  for (int i = 0; i < mapSize; ++i) {
+    const auto falloffValues = useFalloffMap ? falloffMap->row(i).data() : nullptr;
+    postProcessNoiseRow(noiseMap.row(i).data(), falloffValues, minNoiseHeight, noiseHeightDiffInverse,
+                        heightCurveTable.data(), int(heightCurveTable.size()), noiseMap.stride());
+    postProcessNoiseRowReference(referenceNoiseMap.row(i).data(), falloffValues, minNoiseHeight,
+                                 noiseHeightDiffInverse, heightCurveTable, mapSize);
+    passed = passed && std::memcmp(noiseMap.row(i).data(), referenceNoiseMap.row(i).data(),
+                                   noiseMap.row(i).size_bytes()) == 0;
+  }
+
+  reportCheck(passed, "postProcess/" + std::to_string(mapSize) + (useFalloffMap ? "/falloff" : ""),
+              "%s", passed ? "bit identical to the scalar loop" : "differs from the scalar loop");
+}
+
+static constexpr float kQueryGridPointSpacing = 0.5f;
+static constexpr float kQueryHeightMultiplier = 30.0f;
+
+// Random positions reaching past every edge, with infinite and NaN ones spread over full batches and the
+// remainder that is not a multiple of the batch size
+static std::vector<glm::vec2> getQueryPositions(const int width, const int height, const uint32_t seed) {
+  std::mt19937 random{seed};
+  std::uniform_real_distribution<float> randomX(-0.25f * float(width), 1.25f * float(width));
+  std::uniform_real_distribution<float> randomY(-0.25f * float(height), 1.25f * float(height));
+  std::vector<glm::vec2> positions(1003);
+  for (auto &position : positions) {
+    position = glm::vec2(randomX(random), randomY(random)) * kQueryGridPointSpacing;
+  }
+
+  const auto nan = std::numeric_limits<float>::quiet_NaN();
+  const auto infinity = std::numeric_limits<float>::infinity();
+  const glm::vec2 specialPositions[] = {{nan, nan},        {nan, 1.0f},           {1.0f, nan},
+                                        {infinity, 1.0f},  {-infinity, 1.0f},     {1.0f, infinity},
+                                        {1.0f, -infinity}, {infinity, -infinity}, {nan, infinity}};
+  for (size_t i = 0; i < std::size(specialPositions); ++i) {
+    positions[i * 97 + 5] = specialPositions[i];
+    positions[positions.size() - 1 - i % 3] = specialPositions[i];
+  }
+  return positions;
+}
+
+// Number of positions whose height or normal from queryHeight and queryNormal is not bit identical
+static int countQueryMismatches(const std::vector<glm::vec2> &positions, const std::vector<float> &heights,
+                                const std::vector<glm::vec3> &normals,
+                                const std::function<float(const glm::vec2 &)> &queryHeight,
+                                const std::function<glm::vec3(const glm::vec2 &)> &queryNormal) {
+  int mismatchCount = 0;
+  for (size_t i = 0; i < positions.size(); ++i) {
+    const auto height = queryHeight(positions[i]);
+    const auto normal = queryNormal(positions[i]);
+    mismatchCount += std::memcmp(&height, &heights[i], sizeof(height)) != 0 ||
+                             std::memcmp(&normal, &normals[i], sizeof(normal)) != 0
+                         ? 1
+                         : 0;
+  }
+  return mismatchCount;
+}
+
+static void checkHeightQueryBatches(const int mapSize) {
+  const auto noiseMap = generateNoiseMap(getParityNoiseMapData(mapSize, NOISE_BACKEND::SIMD, 1, 4), false);
+  HeightPyramid heightPyramid;
+  heightPyramid.build(noiseMap);
+  const HeightQueries heightQueries(noiseMap, heightPyramid, kQueryGridPointSpacing, kQueryHeightMultiplier);
+
+  const auto positions = getQueryPositions(mapSize, mapSize, uint32_t(mapSize));
+  std::vector<float> heights(positions.size());
+  std::vector<glm::vec3> normals(positions.size());
+  heightQueries.getHeights(positions.data(), int(positions.size()), heights.data());
+  heightQueries.getNormals(positions.data(), int(positions.size()), normals.data());
+
+  const auto queryHeight = [&](const glm::vec2 &position) { return heightQueries.getHeight(position); };
+  const auto queryNormal = [&](const glm::vec2 &position) { return heightQueries.getNormal(position); };
+  const auto mismatchCount = countQueryMismatches(positions, heights, normals, queryHeight, queryNormal);
+  reportCheck(mismatchCount == 0, "heightQueries/" + std::to_string(mapSize),
+              "%d of %zu batched heights or normals differ from one at a time", mismatchCount,
+              positions.size());
+}
+
+static void checkTiledHeightQueries(const int mapSize, const int tileSize) {
+  const auto name = "tiledHeightQueries/" + std::to_string(mapSize) + "/tile" + std::to_string(tileSize);
+  auto noiseMapData = getParityNoiseMapData(mapSize, NOISE_BACKEND::SIMD, 1, 4);
+  noiseMapData.normalization = NOISE_NORMALIZATION::FRACTAL_BOUNDS;
+  const auto filePath = (std::filesystem::temp_directory_path() / "terrainParity.tiled").string();
+  TiledHeightmapReader reader;
+  if (!generateTiledHeightmap(filePath, noiseMapData, false, tileSize) || !reader.open(filePath)) {
+    reportCheck(false, name, "could not write %s", filePath.c_str());
+    return;
+  }
+
+  for (int level = 0; level < reader.levelCount(); ++level) {
+    const auto width = reader.levelWidth(level);
+    const auto height = reader.levelHeight(level);
+    if (width < 2 || height < 2) {
+      continue;
+    }
+
+    // The reference queries run over the whole level copied out of the tiles
+    Heightfield levelHeights(width, height);
+    for (int i = 0; i < height; ++i) {
+      for (int j = 0; j < width; ++j) {
+        levelHeights.at(j, i) = reader.tile(level, j / tileSize, i / tileSize).at(j % tileSize, i % tileSize);
+      }
+    }
+    HeightPyramid heightPyramid;
+    heightPyramid.build(levelHeights);
+    const HeightQueries heightQueries(levelHeights, heightPyramid, kQueryGridPointSpacing,
+                                      kQueryHeightMultiplier);
+    const TiledHeightQueries tiledHeightQueries(reader, level, kQueryGridPointSpacing,
+                                                kQueryHeightMultiplier);
+
+    // Every quad corner at a tile seam on top of the random positions
+    auto positions = getQueryPositions(width, height, uint32_t(mapSize + level));
+    for (int seam = tileSize - 1; seam < std::max(width, height); seam += tileSize) {
+      for (const auto offset : {-0.5f, 0.0f, 0.5f, 1.0f}) {
+        const auto seamPosition = (float(seam) + offset) * kQueryGridPointSpacing;
+        positions.emplace_back(seamPosition, float(height) * 0.5f * kQueryGridPointSpacing);
+        positions.emplace_back(float(width) * 0.5f * kQueryGridPointSpacing, seamPosition);
+        positions.emplace_back(seamPosition, seamPosition);
+      }
+    }
+
+    std::vector<float> heights(positions.size());
+    std::vector<glm::vec3> normals(positions.size());
+    tiledHeightQueries.getHeights(positions.data(), int(positions.size()), heights.data());
+    tiledHeightQueries.getNormals(positions.data(), int(positions.size()), normals.data());
+
+    const auto queryHeight = [&](const glm::vec2 &position) { return heightQueries.getHeight(position); };
+    const auto queryNormal = [&](const glm::vec2 &position) { return heightQueries.getNormal(position); };
+    const auto mismatchCount = countQueryMismatches(positions, heights, normals, queryHeight, queryNormal);
+    reportCheck(mismatchCount == 0, name + "/level" + std::to_string(level),
+                "%d of %zu heights or normals differ from the whole level", mismatchCount, positions.size());
+  }
+
+  reader.close();
+  std::error_code errorCode;
+  std::filesystem::remove(filePath, errorCode);
+}
+
+int main() {
+  for (const auto mapSize : {128, 333, 512}) {
+    for (const auto useFalloffMap : {false, true}) {
+      checkPostProcessKernel(mapSize, useFalloffMap);
+    }
+  }
+
+  for (const auto mapSize : {64, 333}) {
+    checkHeightQueryBatches(mapSize);
+  }
+  for (const auto [mapSize, tileSize] : {std::pair(257, 128), std::pair(333, 48), std::pair(512, 64)}) {
+    checkTiledHeightQueries(mapSize, tileSize);
+  }
+
+  for (const auto noiseBackend : {NOISE_BACKEND::SCALAR, NOISE_BACKEND::SIMD}) {
+    for (const auto mapSize : {128, 333}) {
+      for (const auto seed : {1, 1337}) {
+        checkNoiseContract(noiseBackend, mapSize, seed);
+      }
+    }
+  }
+
+  for (const auto mapSize : {256, 333, 512}) {
+    for (const auto seed : {1, 7, 1337}) {
+      for (const auto octaves : {1, 4, 8}) {
+        for (const auto normalization : {NOISE_NORMALIZATION::LOCAL, NOISE_NORMALIZATION::FRACTAL_BOUNDS}) {
+          for (const auto useFalloffMap : {false, true}) {
+            checkBackendStatistics(mapSize, seed, octaves, normalization, useFalloffMap);
+          }
+        }
+      }
+    }
+  }
+
+  printf("%d checks failed\n", failedCheckCount);
+  return failedCheckCount > 0 ? 1 : 0;
+}
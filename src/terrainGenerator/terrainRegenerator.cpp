@@ -0,0 +1,202 @@
+#include "terrainRegenerator.h"
+
+#include "derivedMaps.h"
+#include "memoryTracking.h"
+#include "noiseLayerCache.h"
+#include "noiseMapCache.h"
+#include "profiler.h"
+#include "terrainDefs.h"
+#include "textureGenerator.h"
+#include "threadPool.h"
+#include <utility>
+
+// Previews start at 1/8 resolution, or coarser for big maps so the first preview takes about the same time
+// for any map size
+static constexpr int kFirstPreviewLevel = 3;
+static constexpr int kMaxFirstPreviewSize = 128;
+
+static int getFirstPreviewLevel(const int mapSize) {
+  auto level = kFirstPreviewLevel;
+  while (getNoiseMapLevelSize(mapSize, level) > kMaxFirstPreviewSize) {
+    ++level;
+  }
+  while (level > 0 && (mapSize >> level) == 0) {
+    --level;
+  }
+  return level;
+}
+
+TerrainRegenerator::TerrainRegenerator() {
+  // Construct the shared pool and caches first, so they are destroyed after the last job has finished
+  getThreadPool();
+  getNoiseLayerCache();
+  getNoiseMapCache();
+}
+
+TerrainRegenerator::~TerrainRegenerator() {
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+    _stop = true;
+  }
+  // Also cancels the generation in flight
+  _newestGenerationId = UINT64_MAX;
+
+  getThreadPool().wait(_job);
+}
+
+uint64_t TerrainRegenerator::requestRegeneration(const TerrainData &terrainData) {
+  uint64_t generationId;
+  bool isJobScheduled;
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+    generationId = _newestGenerationId + 1;
+    _pendingRequest = Request{generationId, terrainData.noiseMapData, terrainData.useFalloffMap,
+                              terrainData.useNoiseLayerCache, terrainData.useNoiseMapCache,
+                              terrainData.useProgressivePreview};
+    _newestGenerationId = generationId;
+    isJobScheduled = std::exchange(_isJobScheduled, true);
+  }
+
+  // Outside the lock, a single threaded pool runs the job right away
+  if (!isJobScheduled) {
+    _job = getThreadPool().schedule([this] { runRequests(); });
+  }
+
+  return generationId;
+}
+
+std::optional<RegeneratedTerrain> TerrainRegenerator::takeRegeneratedTerrain() {
+  std::lock_guard<std::mutex> lock(_mutex);
+  if (_regeneratedTerrain && _regeneratedTerrain->level == 0) {
+    _takenGenerationId = _regeneratedTerrain->generationId;
+  }
+  return std::exchange(_regeneratedTerrain, std::nullopt);
+}
+
+bool TerrainRegenerator::isRegenerating() const {
+  std::lock_guard<std::mutex> lock(_mutex);
+  return _finishedGenerationId != _newestGenerationId;
+}
+
+void TerrainRegenerator::runRequests() {
+  while (true) {
+    Request request;
+    {
+      std::lock_guard<std::mutex> lock(_mutex);
+      if (_stop || !_pendingRequest) {
+        _isJobScheduled = false;
+        return;
+      }
+      request = *std::exchange(_pendingRequest, std::nullopt);
+    }
+    runRequest(request);
+  }
+}
+
+void TerrainRegenerator::runRequest(const Request &request) {
+  PROFILE_ZONE("Regenerate terrain");
+  MemoryTagScope memoryTagScope(MEMORY_TAG::NOISE_MAPS);
+
+  const auto isCancelled = [&] {
+    return _newestGenerationId.load(std::memory_order_relaxed) != request.generationId;
+  };
+
+  NoiseMapGenerationContext noiseMapGenerationContext;
+  noiseMapGenerationContext.rawNoiseMap = &_rawNoiseMap;
+  noiseMapGenerationContext.isCancelled = isCancelled;
+  if (request.useNoiseLayerCache) {
+    noiseMapGenerationContext.noiseLayerCache = &getNoiseLayerCache();
+  }
+
+  // Maps generated before, also in earlier runs, are shown right away
+  if (request.useNoiseMapCache) {
+    if (const auto cachedNoiseMap = getNoiseMapCache().find(request.noiseMapData, request.useFalloffMap)) {
+      publishRegeneratedTerrain(request, 0, cachedNoiseMap->clone());
+      return;
+    }
+  }
+
+  // Scrolling or re-post-processing the raw map is quick enough without previews
+  if (request.useProgressivePreview && !canReuseRawNoiseMap(_rawNoiseMap, request.noiseMapData)) {
+    const auto firstPreviewLevel = getFirstPreviewLevel(request.noiseMapData.width);
+    for (int level = firstPreviewLevel; level > 0 && !isCancelled(); --level) {
+      auto noiseMapLevel = generateNoiseMapLevel(request.noiseMapData, request.useFalloffMap, level,
+                                                 noiseMapGenerationContext, &_rawNoiseMapLevel);
+      publishRegeneratedTerrain(request, level, std::move(noiseMapLevel));
+    }
+  }
+
+  auto noiseMap = generateNoiseMap(request.noiseMapData, request.useFalloffMap, noiseMapGenerationContext);
+  if (request.useNoiseMapCache && !noiseMap.empty()) {
+    getNoiseMapCache().insert(request.noiseMapData, request.useFalloffMap,
+                              std::make_shared<const NoiseMap>(noiseMap.clone()));
+  }
+  publishRegeneratedTerrain(request, 0, std::move(noiseMap));
+}
+
+void TerrainRegenerator::publishRegeneratedTerrain(const Request &request, const int level,
+                                                   NoiseMap noiseMap) {
+  if (noiseMap.empty() || request.generationId != _newestGenerationId) {
+    return; // Cancelled or superseded
+  }
+
+  // Converted here as well, so the GL thread only has to upload
+  auto regeneratedTerrain = RegeneratedTerrain{request.generationId, level, request.noiseMapData,
+                                               noiseMap.width(), noiseMap.height()};
+  if (level > 0) {
+    regeneratedTerrain.textureRegions.push_back(
+        {{0, 0, noiseMap.width(), noiseMap.height()}, generateNoiseMapTexture(noiseMap)});
+  } else {
+    uint64_t takenGenerationId;
+    {
+      std::lock_guard<std::mutex> lock(_mutex);
+      takenGenerationId = _takenGenerationId;
+    }
+    std::erase_if(_publishedChanges,
+                  [&](const PublishedChanges &changes) { return changes.generationId <= takenGenerationId; });
+
+    DirtyRegion changedRegion(noiseMap.width(), noiseMap.height());
+    const auto previousSnapshot = _heightfield.pin();
+    if (previousSnapshot && previousSnapshot->heightfield.width() == noiseMap.width() &&
+        previousSnapshot->heightfield.height() == noiseMap.height()) {
+      changedRegion.addChanges(previousSnapshot->heightfield, noiseMap);
+    } else {
+      changedRegion.addAll();
+    }
+    _publishedChanges.push_back({request.generationId, std::move(changedRegion)});
+
+    // Everything changed since the map on the GPU, the one taken last, has to be uploaded
+    DirtyRegion uploadRegion(noiseMap.width(), noiseMap.height());
+    for (const auto &changes : _publishedChanges) {
+      if (changes.changedRegion.width() == noiseMap.width() &&
+          changes.changedRegion.height() == noiseMap.height()) {
+        uploadRegion.add(changes.changedRegion);
+      }
+    }
+    const auto noiseMapView = HeightfieldView(noiseMap);
+    for (const auto &rect : uploadRegion.rects()) {
+      regeneratedTerrain.textureRegions.push_back(
+          {rect, generateNoiseMapTexture(noiseMapView.subview(rect))});
+    }
+
+    auto snapshot = std::make_unique<HeightfieldSnapshot>();
+    snapshot->version = request.generationId;
+    snapshot->noiseMapData = request.noiseMapData;
+    snapshot->heightPyramid.build(noiseMap);
+    snapshot->heightfield = std::move(noiseMap);
+    _heightfield.publish(std::move(snapshot));
+  }
+
+  std::lock_guard<std::mutex> lock(_mutex);
+  if (request.generationId == _newestGenerationId) {
+    _regeneratedTerrain = std::move(regeneratedTerrain);
+    if (level == 0) {
+      _finishedGenerationId = request.generationId;
+    }
+  }
+}
+
+TerrainRegenerator &getTerrainRegenerator() {
+  static TerrainRegenerator terrainRegenerator;
+  return terrainRegenerator;
+}
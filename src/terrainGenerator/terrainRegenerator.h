@@ -0,0 +1,102 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <optional>
+#include <vector>
+
+#include "derivedMaps.h"
+#include "dirtyRegion.h"
+#include "glm/glm.hpp"
+#include "heightfieldSnapshot.h"
+#include "noiseMapGenerator.h"
+#include "threadPool.h"
+
+struct TerrainData;
+
+// Texture data of a finished regeneration, ready to be uploaded on the GL thread. The heights themselves
+// are published as a heightfield snapshot (see TerrainRegenerator::pinHeightfield).
+//
+// Previews cover their whole level. The full resolution map only has the rects that changed since the last
+// full resolution map that was taken, which keeps small edits cheap to upload.
+struct RegeneratedTerrain {
+  uint64_t generationId = 0;
+  int level = 0; // 0 for the full resolution map, greater for coarse previews (see generateNoiseMapLevel)
+  NoiseMapData noiseMapData = {};
+  int width = 0;
+  int height = 0;
+  std::vector<TextureRegion> textureRegions;
+};
+
+// Regenerates the terrain noise map in a job on the shared thread pool so edits do not stall the render
+// loop. Requests are handled one after another by a single job that runs while there are any. Every
+// request gets a new generation id and supersedes the older ones: a running generation is cancelled
+// between tiles and only the newest finished result is handed out. With progressive previews a request
+// first produces coarse levels that refine towards the full resolution map.
+//
+// Every full resolution map is also published as a heightfield snapshot with its height pyramid, which
+// other threads can pin and query while the next generation runs.
+class TerrainRegenerator {
+public:
+  TerrainRegenerator();
+  ~TerrainRegenerator();
+
+  TerrainRegenerator(const TerrainRegenerator &) = delete;
+  TerrainRegenerator &operator=(const TerrainRegenerator &) = delete;
+
+  // Returns the generation id of the request
+  uint64_t requestRegeneration(const TerrainData &terrainData);
+
+  // Takes the newest finished result if there is one that has not been taken yet. The texture regions of
+  // results that were replaced before they were taken are included in the next full resolution one.
+  std::optional<RegeneratedTerrain> takeRegeneratedTerrain();
+
+  // True while the newest request has not finished yet
+  bool isRegenerating() const;
+
+  // The newest full resolution heightfield, versioned by generation id. Pinning never waits for the
+  // regeneration.
+  HeightfieldSnapshotPin pinHeightfield() const { return _heightfield.pin(); }
+  const VersionedHeightfield &heightfield() const { return _heightfield; }
+
+private:
+  struct Request {
+    uint64_t generationId;
+    NoiseMapData noiseMapData;
+    bool useFalloffMap;
+    bool useNoiseLayerCache;
+    bool useNoiseMapCache;
+    bool useProgressivePreview;
+  };
+
+  void runRequests();
+  void runRequest(const Request &request);
+  void publishRegeneratedTerrain(const Request &request, const int level, NoiseMap noiseMap);
+
+  mutable std::mutex _mutex;
+  std::optional<Request> _pendingRequest;
+  std::optional<RegeneratedTerrain> _regeneratedTerrain;
+  bool _isJobScheduled = false;
+  JobHandle _job; // The last job, only used on the thread that requests regenerations
+  uint64_t _finishedGenerationId = 0;
+  uint64_t _takenGenerationId = 0; // Of the last full resolution result that was taken
+  bool _stop = false;
+
+  std::atomic<uint64_t> _newestGenerationId = 0;
+
+  VersionedHeightfield _heightfield;
+
+  // Only used by the job
+  // What every published full resolution map changed against the one before it, back to the one taken last
+  struct PublishedChanges {
+    uint64_t generationId;
+    DirtyRegion changedRegion;
+  };
+  std::vector<PublishedChanges> _publishedChanges;
+  RawNoiseMap _rawNoiseMap;
+  RawNoiseMapLevel _rawNoiseMapLevel;
+};
+
+// Regenerator used by the UI for the terrain mesh
+TerrainRegenerator &getTerrainRegenerator();
@@ -2,8 +2,13 @@
 
 #include "GL/glew.h"
 #include "glm\gtc\type_ptr.hpp"
+#include "profiler.h"
 #include "stb_image.h"
 #include "terrainDefs.h"
+#include "textureUploadQueue.h"
+#include "threadPool.h"
+#include "tiledHeightmap.h"
+#include <algorithm>
 
 void loadTexture(const std::string &textureName, const std::string &texturePath, int *width, int *height,
                  unsigned char **pixelData) {
@@ -14,8 +19,34 @@ void loadTexture(const std::string &textureName, const std::string &texturePath,
 
 void freeTexture(unsigned char *pixelData) { stbi_image_free(pixelData); }
 
-void createTexture2D(GLuint *texHandle, GLenum wrapMode, GLenum filterMode, const int width, const int height,
-                     GLenum dataType, const void *pixelData) {
+std::vector<LoadedTexture> loadTextures(const std::vector<std::string> &textureNames,
+                                        const std::string &texturePath) {
+  PROFILE_ZONE("Load textures");
+  MemoryTagScope memoryTagScope(MEMORY_TAG::TEXTURES);
+
+  std::vector<LoadedTexture> textures(textureNames.size());
+  getThreadPool().parallelFor(int(textureNames.size()), [&](const int i) {
+    auto &texture = textures[i];
+    loadTexture(textureNames[i], texturePath, &texture.width, &texture.height, &texture.pixelData);
+  });
+  return textures;
+}
+
+// Summed over the levels. Drivers may pad rows or store RGB as RGBA, so this is a lower bound.
+static uint64_t getTextureSizeInBytes(const int width, const int height, const int bytesPerTexel,
+                                      const bool hasMipmaps) {
+  uint64_t size = 0;
+  for (int levelWidth = width, levelHeight = height;;
+       levelWidth = std::max(1, levelWidth / 2), levelHeight = std::max(1, levelHeight / 2)) {
+    size += uint64_t(levelWidth) * uint64_t(levelHeight) * uint64_t(bytesPerTexel);
+    if (!hasMipmaps || (levelWidth == 1 && levelHeight == 1)) {
+      return size;
+    }
+  }
+}
+
+void createTexture2D(GLuint *texHandle, const MEMORY_TAG memoryTag, GLenum wrapMode, GLenum filterMode,
+                     const int width, const int height, GLenum dataType, const void *pixelData) {
   glBindTexture(GL_TEXTURE_2D, *texHandle);
   glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, wrapMode);
   glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, wrapMode);
@@ -24,10 +55,13 @@ void createTexture2D(GLuint *texHandle, GLenum wrapMode, GLenum filterMode, cons
   glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, width, height, 0, GL_RGB, dataType, pixelData);
   glGenerateMipmap(GL_TEXTURE_2D);
   glBindTexture(GL_TEXTURE_2D, 0);
+
+  trackGpuResource(GPU_RESOURCE_TYPE::TEXTURE, *texHandle, memoryTag,
+                   getTextureSizeInBytes(width, height, 3, true));
 }
 
-void createTexture2DArray(GLuint *texHandle, GLenum wrapMode, GLenum filterMode, const int width,
-                          const int height, GLenum dataType,
+void createTexture2DArray(GLuint *texHandle, const MEMORY_TAG memoryTag, GLenum wrapMode, GLenum filterMode,
+                          const int width, const int height, GLenum dataType,
                           const std::vector<unsigned char *> &terrainTextures) {
   glBindTexture(GL_TEXTURE_2D_ARRAY, *texHandle);
 
@@ -42,21 +76,25 @@ void createTexture2DArray(GLuint *texHandle, GLenum wrapMode, GLenum filterMode,
   glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, filterMode);
 
   glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+
+  trackGpuResource(GPU_RESOURCE_TYPE::TEXTURE, *texHandle, memoryTag,
+                   getTextureSizeInBytes(width, height, 3, false) * terrainTextures.size());
 }
 
-void createCubeMapTexture(GLuint *texHandle, const std::vector<std::string> &facesNames) {
+void createCubeMapTexture(GLuint *texHandle, const MEMORY_TAG memoryTag,
+                          const std::vector<std::string> &facesNames) {
   glBindTexture(GL_TEXTURE_CUBE_MAP, *texHandle);
 
-  for (size_t i = 0; i < facesNames.size(); i++) {
-    int faceWidth, faceHeight;
-    unsigned char *facePixelData = nullptr;
-    loadTexture(facesNames[i], skyboxTexturePath, &faceWidth, &faceHeight, &facePixelData);
-    assert(facePixelData != nullptr);
-
-    glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + GLenum(i), 0, GL_RGB, faceWidth, faceHeight, 0, GL_RGB,
-                 GL_UNSIGNED_BYTE, facePixelData);
-    freeTexture(facePixelData);
+  const auto faces = loadTextures(facesNames, skyboxTexturePath);
+  uint64_t sizeInBytes = 0;
+  for (size_t i = 0; i < faces.size(); i++) {
+    assert(faces[i].pixelData != nullptr);
+    glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + GLenum(i), 0, GL_RGB, faces[i].width, faces[i].height, 0,
+                 GL_RGB, GL_UNSIGNED_BYTE, faces[i].pixelData);
+    freeTexture(faces[i].pixelData);
+    sizeInBytes += getTextureSizeInBytes(faces[i].width, faces[i].height, 3, false);
   }
+  trackGpuResource(GPU_RESOURCE_TYPE::TEXTURE, *texHandle, memoryTag, sizeInBytes);
 
   glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
   glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
@@ -67,26 +105,56 @@ void createCubeMapTexture(GLuint *texHandle, const std::vector<std::string> &fac
   glBindTexture(GL_TEXTURE_CUBE_MAP, 0);
 }
 
-void updateTexture2D(GLuint *texHandle, const int offsetX, const int offsetY, const int width,
-                     const int height, GLenum dataType, const void *pixelData) {
+void updateTexture2D(GLuint *texHandle, const int level, const int offsetX, const int offsetY,
+                     const int width, const int height, GLenum dataType, const void *pixelData) {
+  PROFILE_ZONE("Upload texture");
+
   glBindTexture(GL_TEXTURE_2D, *texHandle);
-  glTexSubImage2D(GL_TEXTURE_2D, 0, offsetX, offsetY, width, height, GL_RGB, dataType, pixelData);
+  glTexSubImage2D(GL_TEXTURE_2D, level, offsetX, offsetY, width, height, GL_RGB, dataType, pixelData);
+}
+
+void createHeightTexture2D(GLuint *texHandle, const MEMORY_TAG memoryTag, GLenum wrapMode, GLenum filterMode,
+                           const int width, const int height, const uint16_t *texels) {
+  const GLint swizzle[] = {GL_RED, GL_RED, GL_RED, GL_ONE};
+
+  glBindTexture(GL_TEXTURE_2D, *texHandle);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, wrapMode);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, wrapMode);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, filterMode);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, filterMode);
+  glTexParameteriv(GL_TEXTURE_2D, GL_TEXTURE_SWIZZLE_RGBA, swizzle);
+
+  // Rows of an odd width are not 4-byte aligned
+  glPixelStorei(GL_UNPACK_ALIGNMENT, 2);
+  glTexImage2D(GL_TEXTURE_2D, 0, GL_R16, width, height, 0, GL_RED, GL_UNSIGNED_SHORT, texels);
+  glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+  glGenerateMipmap(GL_TEXTURE_2D);
+  glBindTexture(GL_TEXTURE_2D, 0);
+
+  trackGpuResource(GPU_RESOURCE_TYPE::TEXTURE, *texHandle, memoryTag,
+                   getTextureSizeInBytes(width, height, 2, true));
 }
 
-std::vector<glm::vec3> generateNoiseMapTexture(const NoiseMap &noiseMap) {
-  const auto black = glm::vec3(0.0f);
-  const auto white = glm::vec3(1.0f);
+void updateHeightTexture2D(GLuint *texHandle, const int level, const int offsetX, const int offsetY,
+                           const int width, const int height, const uint16_t *texels) {
+  PROFILE_ZONE("Upload texture");
 
-  const auto mapHeight = noiseMap.size();
-  const auto mapWidth = noiseMap.front().size();
+  glBindTexture(GL_TEXTURE_2D, *texHandle);
+  glPixelStorei(GL_UNPACK_ALIGNMENT, 2);
+  glTexSubImage2D(GL_TEXTURE_2D, level, offsetX, offsetY, width, height, GL_RED, GL_UNSIGNED_SHORT, texels);
+  glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+}
 
-  std::vector<glm::vec3> noiseMapTextureData;
-  noiseMapTextureData.reserve(size_t(mapWidth) * size_t(mapHeight));
-  for (size_t i = 0; i < mapHeight; ++i) {
-    for (size_t j = 0; j < mapWidth; ++j) {
-      noiseMapTextureData.push_back(glm::mix(black, white, noiseMap[i][j]));
-    }
-  }
+void createTiledHeightTexture2D(GLuint *texHandle, const MEMORY_TAG memoryTag, GLenum wrapMode,
+                                GLenum filterMode, const TiledHeightmapReader &reader, const int firstLevel,
+                                TextureUploadQueue *textureUploadQueue, std::function<void()> onUploaded) {
+  createHeightTexture2D(texHandle, memoryTag, wrapMode, filterMode, reader.levelWidth(firstLevel),
+                        reader.levelHeight(firstLevel), nullptr);
 
-  return noiseMapTextureData;
-}
\ No newline at end of file
+  // The levels below the last tiled one are never filled in
+  glBindTexture(GL_TEXTURE_2D, *texHandle);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, reader.levelCount() - 1 - firstLevel);
+  glBindTexture(GL_TEXTURE_2D, 0);
+
+  textureUploadQueue->enqueueTiledHeightmap(*texHandle, reader, firstLevel, std::move(onUploaded));
+}
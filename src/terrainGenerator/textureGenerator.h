@@ -2,13 +2,18 @@
 
 #include "GL/glew.h"
 #include "glm/glm.hpp"
+#include "memoryTracking.h"
 #include "noiseMapGenerator.h"
 #include "utils.h"
+#include <cstdint>
+#include <functional>
 #include <string>
 #include <vector>
 
 struct TerrainData;
 struct TerrainProperty;
+class TextureUploadQueue;
+class TiledHeightmapReader;
 
 const std::string texturePath(getExePath() + "/resources/textures/");
 const std::string skyboxTexturePath(getExePath() + "/resources/textures/skybox/");
@@ -20,13 +25,39 @@ void loadTexture(const std::string &textureName, const std::string &texturePath,
                  unsigned char **pixelData);
 void freeTexture(unsigned char *pixelData);
 
-void createCubeMapTexture(GLuint *texHandle, const std::vector<std::string> &facesNames);
+struct LoadedTexture {
+  int width = 0;
+  int height = 0;
+  unsigned char *pixelData = nullptr; // Null if it could not be loaded, freed with freeTexture
+};
 
-void createTexture2D(GLuint *texHandle, GLenum wrapMode, GLenum filterMode, const int width, const int height,
-                     GLenum dataType, const void *pixels);
-void createTexture2DArray(GLuint *texHandle, GLenum wrapMode, GLenum filterMode, const int width,
-                          const int height, GLenum dataType, const std::vector<unsigned char *> &terrainTextures);
-void updateTexture2D(GLuint *texHandle, const int offsetX, const int offsetY, const int width,
-                     const int height, GLenum dataType, const void *pixels);
+// Decodes the textures in parallel on the shared thread pool
+std::vector<LoadedTexture> loadTextures(const std::vector<std::string> &textureNames,
+                                        const std::string &texturePath);
 
-std::vector<glm::vec3> generateNoiseMapTexture(const NoiseMap &noiseMap);
\ No newline at end of file
+// The created textures are tracked under memoryTag until untrackGpuResource, creating one again on the same
+// handle replaces its size
+void createCubeMapTexture(GLuint *texHandle, const MEMORY_TAG memoryTag,
+                          const std::vector<std::string> &facesNames);
+
+void createTexture2D(GLuint *texHandle, const MEMORY_TAG memoryTag, GLenum wrapMode, GLenum filterMode,
+                     const int width, const int height, GLenum dataType, const void *pixels);
+void createTexture2DArray(GLuint *texHandle, const MEMORY_TAG memoryTag, GLenum wrapMode, GLenum filterMode,
+                          const int width, const int height, GLenum dataType,
+                          const std::vector<unsigned char *> &terrainTextures);
+void updateTexture2D(GLuint *texHandle, const int level, const int offsetX, const int offsetY,
+                     const int width, const int height, GLenum dataType, const void *pixels);
+
+// Single channel R16 unorm texture for height data, rows packed without padding. Green and blue read the red
+// channel as well, so views that sample the colour show it grey.
+void createHeightTexture2D(GLuint *texHandle, const MEMORY_TAG memoryTag, GLenum wrapMode, GLenum filterMode,
+                           const int width, const int height, const uint16_t *texels);
+void updateHeightTexture2D(GLuint *texHandle, const int level, const int offsetX, const int offsetY,
+                           const int width, const int height, const uint16_t *texels);
+// Height texture of tiled heightmap levels [firstLevel, levelCount), one mip level each, streamed in through
+// the upload queue straight from the mapped tiles (see TextureUploadQueue::enqueueTiledHeightmap). The
+// reader has to stay open until onUploaded.
+void createTiledHeightTexture2D(GLuint *texHandle, const MEMORY_TAG memoryTag, GLenum wrapMode,
+                                GLenum filterMode, const TiledHeightmapReader &reader, const int firstLevel,
+                                TextureUploadQueue *textureUploadQueue,
+                                std::function<void()> onUploaded = {});
\ No newline at end of file
@@ -0,0 +1,146 @@
+#include "textureUploadQueue.h"
+
+#include "heightfieldKernels.h"
+#include "memoryTracking.h"
+#include "profiler.h"
+#include "tiledHeightmap.h"
+#include <algorithm>
+#include <cstring>
+
+static bool containsRect(const HeightRect &rect, const HeightRect &otherRect) {
+  return otherRect.x >= rect.x && otherRect.y >= rect.y &&
+         otherRect.x + otherRect.width <= rect.x + rect.width &&
+         otherRect.y + otherRect.height <= rect.y + rect.height;
+}
+
+void TextureUploadQueue::enqueue(const GLuint texture, const int level, TextureRegion region,
+                                 std::function<void()> onUploaded) {
+  enqueueUpload({texture, level, std::move(region), std::move(onUploaded)});
+}
+
+void TextureUploadQueue::enqueue(const GLuint texture, const int level, const int x, const int y,
+                                 const HeightfieldView &heights, std::function<void()> onUploaded) {
+  const HeightRect rect = {x, y, heights.width(), heights.height()};
+  enqueueUpload({texture, level, TextureRegion{rect, {}}, std::move(onUploaded), heights});
+}
+
+void TextureUploadQueue::enqueueTiledHeightmap(const GLuint texture, const TiledHeightmapReader &reader,
+                                               const int firstLevel, std::function<void()> onUploaded) {
+  const auto tileSize = reader.tileSize();
+  for (int level = firstLevel; level < reader.levelCount(); ++level) {
+    const auto isLastLevel = level + 1 == reader.levelCount();
+    for (int tileY = 0; tileY < reader.tileCountY(level); ++tileY) {
+      for (int tileX = 0; tileX < reader.tileCountX(level); ++tileX) {
+        // Uploads run in order, so the last tile of the last level is also the last one to finish
+        const auto isLastTile =
+            isLastLevel && tileY + 1 == reader.tileCountY(level) && tileX + 1 == reader.tileCountX(level);
+        enqueue(texture, level - firstLevel, tileX * tileSize, tileY * tileSize,
+                reader.tile(level, tileX, tileY), isLastTile ? std::move(onUploaded) : nullptr);
+      }
+    }
+  }
+}
+
+void TextureUploadQueue::enqueueUpload(Upload upload) {
+  const auto &rect = upload.region.rect;
+  if (rect.width <= 0 || rect.height <= 0) {
+    return;
+  }
+
+  std::erase_if(_uploads, [&](const Upload &otherUpload) {
+    return otherUpload.texture == upload.texture && otherUpload.level == upload.level &&
+           containsRect(rect, otherUpload.region.rect);
+  });
+  _uploads.push_back(std::move(upload));
+}
+
+void TextureUploadQueue::update() {
+  if (_uploads.empty()) {
+    return;
+  }
+  PROFILE_ZONE("Stream texture uploads");
+
+  if (_buffers[0].handle == 0) {
+    for (auto &buffer : _buffers) {
+      glGenBuffers(1, &buffer.handle);
+      glBindBuffer(GL_PIXEL_UNPACK_BUFFER, buffer.handle);
+      glBufferData(GL_PIXEL_UNPACK_BUFFER, kBufferSize, nullptr, GL_STREAM_DRAW);
+      trackGpuResource(GPU_RESOURCE_TYPE::BUFFER, buffer.handle, MEMORY_TAG::TEXTURE_STAGING, kBufferSize);
+    }
+  }
+
+  glPixelStorei(GL_UNPACK_ALIGNMENT, 2);
+  while (!_uploads.empty()) {
+    // Buffers are used in order, so the first one still being read means all others after it are as well
+    auto &buffer = _buffers[_nextBuffer];
+    if (buffer.fence != nullptr) {
+      if (glClientWaitSync(buffer.fence, GL_SYNC_FLUSH_COMMANDS_BIT, 0) == GL_TIMEOUT_EXPIRED) {
+        break;
+      }
+      glDeleteSync(buffer.fence);
+      buffer.fence = nullptr;
+    }
+
+    auto &upload = _uploads.front();
+    const auto &rect = upload.region.rect;
+    const auto rowSize = size_t(rect.width) * sizeof(uint16_t);
+    const auto rowCount =
+        std::min(rect.height - upload.uploadedRowCount, std::max(1, int(kBufferSize / rowSize)));
+    const auto size = rowSize * rowCount;
+
+    // The fence guarantees the GPU is done with the old contents
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, buffer.handle);
+    const auto bufferData = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, GLsizeiptr(size),
+                                             GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+    if (upload.heights.empty()) {
+      std::memcpy(bufferData, upload.region.texels.data() + size_t(upload.uploadedRowCount) * rect.width,
+                  size);
+    } else {
+      for (int i = 0; i < rowCount; ++i) {
+        convertRowToUnorm16(upload.heights.row(upload.uploadedRowCount + i).data(),
+                            static_cast<uint16_t *>(bufferData) + size_t(i) * rect.width, rect.width);
+      }
+    }
+    glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+
+    glBindTexture(GL_TEXTURE_2D, upload.texture);
+    glTexSubImage2D(GL_TEXTURE_2D, upload.level, rect.x, rect.y + upload.uploadedRowCount, rect.width,
+                    rowCount, GL_RED, GL_UNSIGNED_SHORT, nullptr);
+    buffer.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    _nextBuffer = (_nextBuffer + 1) % kBufferCount;
+
+    upload.uploadedRowCount += rowCount;
+    if (upload.uploadedRowCount == rect.height) {
+      if (upload.onUploaded) {
+        upload.onUploaded();
+      }
+      _uploads.pop_front();
+    }
+  }
+  glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+  glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+  glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+void TextureUploadQueue::destroy() {
+  _uploads.clear();
+  for (auto &buffer : _buffers) {
+    if (buffer.fence != nullptr) {
+      glDeleteSync(buffer.fence);
+    }
+    if (buffer.handle != 0) {
+      untrackGpuResource(GPU_RESOURCE_TYPE::BUFFER, buffer.handle);
+      glDeleteBuffers(1, &buffer.handle);
+    }
+    buffer = {};
+  }
+}
+
+size_t TextureUploadQueue::pendingBytes() const {
+  size_t bytes = 0;
+  for (const auto &upload : _uploads) {
+    bytes += size_t(upload.region.rect.height - upload.uploadedRowCount) * upload.region.rect.width *
+             sizeof(uint16_t);
+  }
+  return bytes;
+}
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <vector>
+
+#include "GL/glew.h"
+#include "derivedMaps.h"
+#include "heightfield.h"
+
+class TiledHeightmapReader;
+
+// Streams uploads of rects of height textures (see createHeightTexture2D) through a ring of pixel unpack
+// buffers. Every update copies bands of rows in to the buffers the GPU is done with and starts an
+// asynchronous glTexSubImage2D from each, so uploads cost time proportional to their area and a large one
+// is spread over several frames instead of blocking the GL thread. GL thread only.
+class TextureUploadQueue {
+public:
+  static constexpr int kBufferCount = 4;
+  static constexpr size_t kBufferSize = 4 * 1024 * 1024;
+
+  TextureUploadQueue() = default;
+  TextureUploadQueue(const TextureUploadQueue &) = delete;
+  TextureUploadQueue &operator=(const TextureUploadQueue &) = delete;
+
+  // Queued uploads of the same texture level that lie entirely inside the new region are dropped, they
+  // would be overwritten anyway (and their onUploaded is not called). onUploaded runs on the update that
+  // issues the last rows of the region.
+  void enqueue(const GLuint texture, const int level, TextureRegion region,
+               std::function<void()> onUploaded = {});
+  // Heights at (x, y) in the texture, converted to 16-bit unorm row by row as they are copied in to the
+  // buffers, so a tile view of a mapped tiled heightmap is uploaded without a texel copy of its own. The
+  // view has to stay valid until its upload is done.
+  void enqueue(const GLuint texture, const int level, const int x, const int y,
+               const HeightfieldView &heights, std::function<void()> onUploaded = {});
+  // Every tile of tiled heightmap levels [firstLevel, levelCount) in to texture levels 0, 1, ... The texture
+  // has to be levelWidth(firstLevel) x levelHeight(firstLevel) with a mip chain, like createHeightTexture2D
+  // makes, and the reader has to stay open until onUploaded, which runs once the last tile is uploaded.
+  void enqueueTiledHeightmap(const GLuint texture, const TiledHeightmapReader &reader, const int firstLevel,
+                             std::function<void()> onUploaded = {});
+
+  // Once per frame
+  void update();
+
+  // Deletes the buffers, pending uploads are dropped
+  void destroy();
+
+  bool empty() const { return _uploads.empty(); }
+  size_t pendingBytes() const;
+
+private:
+  struct Upload {
+    GLuint texture;
+    int level;
+    TextureRegion region; // Only the rect if heights is set
+    std::function<void()> onUploaded;
+    HeightfieldView heights;
+    int uploadedRowCount = 0;
+  };
+
+  void enqueueUpload(Upload upload);
+
+  struct Buffer {
+    GLuint handle = 0;
+    GLsync fence = nullptr; // Signalled once the GPU has read the buffer
+  };
+
+  std::deque<Upload> _uploads;
+  std::array<Buffer, kBufferCount> _buffers;
+  int _nextBuffer = 0;
+};
@@ -0,0 +1,394 @@
+#include "threadPool.h"
+
+#include "memoryTracking.h"
+#include "profiler.h"
+#include "timeMeasureUtils.h"
+#include <algorithm>
+
+struct ScheduledJob {
+  std::function<void()> function;
+  bool runsOnMainThread = false;
+  MEMORY_TAG memoryTag = MEMORY_TAG::OTHER; // Of the thread that scheduled it
+  std::atomic<int> unfinishedDependencyCount = 0;
+  std::atomic<bool> isDone = false;
+
+  std::mutex mutex;
+  std::vector<std::shared_ptr<ScheduledJob>> dependencies; // The unfinished ones, until the job is queued
+  std::vector<std::shared_ptr<ScheduledJob>> dependents;
+};
+
+// Set on the workers, so tasks they queue go in to their own deque
+static thread_local const ThreadPool *currentThreadPool = nullptr;
+static thread_local int currentQueueIndex = 0;
+
+bool JobHandle::isDone() const { return _job == nullptr || _job->isDone; }
+
+ThreadPool::ThreadPool(const unsigned threadCount, const THREAD_POOL_MODE mode)
+    : _threadCount(std::max(1u, threadCount)), _mainThreadId(std::this_thread::get_id()), _mode(mode) {
+  const auto workerCount = std::max(1u, _threadCount - 1);
+  for (unsigned i = 0; i <= workerCount; ++i) {
+    _queues.push_back(std::make_unique<TaskQueue>());
+  }
+
+  _workers.reserve(workerCount);
+  for (unsigned i = 0; i < workerCount; ++i) {
+    _workers.emplace_back(&ThreadPool::workerLoop, this, int(i) + 1);
+  }
+}
+
+ThreadPool::~ThreadPool() {
+  {
+    std::lock_guard<std::mutex> lock(_sleepMutex);
+    _stop = true;
+  }
+  _taskAvailable.notify_all();
+  _eventHappened.notify_all();
+
+  for (auto &worker : _workers) {
+    worker.join();
+  }
+}
+
+unsigned ThreadPool::threadCount() const {
+  return _mode == THREAD_POOL_MODE::PARALLEL ? _threadCount : 1;
+}
+
+void ThreadPool::setMode(const THREAD_POOL_MODE mode) {
+  {
+    std::lock_guard<std::mutex> lock(_sleepMutex);
+    _mode = mode;
+    ++_eventCount;
+  }
+  _taskAvailable.notify_all();
+  _eventHappened.notify_all();
+}
+
+void ThreadPool::parallelFor(const int taskCount, const std::function<void(int)> &task) {
+  if (taskCount <= 0) {
+    return;
+  }
+
+  if (_mode != THREAD_POOL_MODE::PARALLEL || _threadCount == 1 || taskCount == 1) {
+    for (int i = 0; i < taskCount; ++i) {
+      task(i);
+    }
+    _executedTaskCount += taskCount;
+    return;
+  }
+
+  // Every runner takes tasks until none are left, so a runner that is stolen late just finds nothing to do
+  std::atomic<int> nextTask = 0;
+  const auto memoryTag = getThreadMemoryTag();
+  const auto runTasks = [&] {
+    MemoryTagScope memoryTagScope(memoryTag);
+    uint64_t executedTaskCount = 0;
+    for (auto i = nextTask.fetch_add(1); i < taskCount; i = nextTask.fetch_add(1)) {
+      task(i);
+      ++executedTaskCount;
+    }
+    _executedTaskCount += executedTaskCount;
+  };
+
+  const auto runnerCount = std::min(taskCount, int(_threadCount)) - 1;
+  std::atomic<int> unfinishedRunnerCount = runnerCount;
+  for (int i = 0; i < runnerCount; ++i) {
+    pushTask({[this, &runTasks, &unfinishedRunnerCount] {
+                runTasks();
+                // Nothing on the stack of parallelFor may be touched after the last runner finished
+                if (--unfinishedRunnerCount == 0) {
+                  notifyWaiters();
+                }
+              },
+              &unfinishedRunnerCount});
+  }
+
+  runTasks();
+  waitUntil(&unfinishedRunnerCount, [&] { return unfinishedRunnerCount == 0; });
+}
+
+void ThreadPool::parallelFor2D(const int countX, const int countY,
+                               const std::function<void(int x, int y)> &task) {
+  if (countX <= 0 || countY <= 0) {
+    return;
+  }
+  parallelFor(countX * countY, [&](const int i) { task(i % countX, i / countX); });
+}
+
+JobHandle ThreadPool::schedule(std::function<void()> job, const std::vector<JobHandle> &dependencies) {
+  return scheduleJob(std::move(job), false, dependencies);
+}
+
+JobHandle ThreadPool::scheduleOnMainThread(std::function<void()> job,
+                                           const std::vector<JobHandle> &dependencies) {
+  return scheduleJob(std::move(job), true, dependencies);
+}
+
+JobHandle ThreadPool::scheduleJob(std::function<void()> function, const bool runsOnMainThread,
+                                  const std::vector<JobHandle> &dependencies) {
+  auto job = std::make_shared<ScheduledJob>();
+  job->function = std::move(function);
+  job->runsOnMainThread = runsOnMainThread;
+  job->memoryTag = getThreadMemoryTag();
+
+  // Held until every dependency is registered, so the last dependency can not queue the job too early
+  job->unfinishedDependencyCount = 1;
+  for (const auto &dependency : dependencies) {
+    if (!dependency) {
+      continue;
+    }
+    std::lock_guard<std::mutex> lock(dependency._job->mutex);
+    if (!dependency._job->isDone) {
+      dependency._job->dependents.push_back(job);
+      job->dependencies.push_back(dependency._job);
+      ++job->unfinishedDependencyCount;
+    }
+  }
+  if (--job->unfinishedDependencyCount == 0) {
+    enqueueJob(job);
+  }
+
+  return JobHandle(job);
+}
+
+void ThreadPool::wait(const JobHandle &job) {
+  if (!job) {
+    return;
+  }
+
+  // Dependencies first, which queues the job even if no worker is around to run them
+  std::vector<std::shared_ptr<ScheduledJob>> dependencies;
+  {
+    std::lock_guard<std::mutex> lock(job._job->mutex);
+    dependencies = job._job->dependencies;
+  }
+  for (const auto &dependency : dependencies) {
+    wait(JobHandle(dependency));
+  }
+
+  waitUntil(job._job.get(), [&] { return job._job->isDone.load(); });
+}
+
+void ThreadPool::runMainThreadJobs() {
+  _mainThreadId = std::this_thread::get_id();
+
+  if (_mode != THREAD_POOL_MODE::PARALLEL) {
+    Task task;
+    while (takeTask(nullptr, &task)) {
+      task.run();
+    }
+  }
+
+  // Jobs queued by the jobs run here wait for the next call
+  size_t taskCount;
+  {
+    std::lock_guard<std::mutex> lock(_mainThreadQueue.mutex);
+    taskCount = _mainThreadQueue.tasks.size();
+  }
+  for (size_t i = 0; i < taskCount; ++i) {
+    Task task;
+    {
+      std::lock_guard<std::mutex> lock(_mainThreadQueue.mutex);
+      task = std::move(_mainThreadQueue.tasks.front());
+      _mainThreadQueue.tasks.pop_front();
+    }
+    task.run();
+  }
+}
+
+ThreadPoolCounters ThreadPool::counters() const {
+  return {_executedTaskCount.load(), _stealCount.load(), double(_idleTimeInNs.load()) / 1000000.0};
+}
+
+void ThreadPool::resetCounters() {
+  _executedTaskCount = 0;
+  _stealCount = 0;
+  _idleTimeInNs = 0;
+}
+
+void ThreadPool::workerLoop(const int queueIndex) {
+  setProfilerThreadName("Thread pool worker");
+  currentThreadPool = this;
+  currentQueueIndex = queueIndex;
+
+  while (true) {
+    Task task;
+    if (_mode == THREAD_POOL_MODE::PARALLEL && takeTask(nullptr, &task)) {
+      task.run();
+      continue;
+    }
+
+    const auto idleStart = startTimeMeasure();
+    {
+      std::unique_lock<std::mutex> lock(_sleepMutex);
+      _taskAvailable.wait(
+          lock, [this] { return _stop || (_queuedTaskCount > 0 && _mode == THREAD_POOL_MODE::PARALLEL); });
+      if (_stop) {
+        return;
+      }
+    }
+    _idleTimeInNs += uint64_t(endTimeMeasure(idleStart));
+  }
+}
+
+int ThreadPool::ownQueueIndex() const {
+  // A single deque keeps the order in which jobs were queued
+  if (_mode == THREAD_POOL_MODE::DETERMINISTIC || currentThreadPool != this) {
+    return 0;
+  }
+  return currentQueueIndex;
+}
+
+void ThreadPool::pushTask(Task task) {
+  auto &queue = *_queues[ownQueueIndex()];
+  {
+    std::lock_guard<std::mutex> lock(queue.mutex);
+    queue.tasks.push_back(std::move(task));
+  }
+
+  // Counted under the sleep mutex, so a worker going to sleep can not miss it
+  bool hasWaiters;
+  {
+    std::lock_guard<std::mutex> lock(_sleepMutex);
+    ++_queuedTaskCount;
+    ++_eventCount;
+    hasWaiters = _waiterCount > 0;
+  }
+  _taskAvailable.notify_one();
+  if (hasWaiters) {
+    _eventHappened.notify_all();
+  }
+}
+
+// Without a group any task, the own deque from the back (newest first) and the others from the front.
+// With a group only tasks of that group, and the main thread jobs of the group on the main thread.
+bool ThreadPool::takeTask(const void *group, Task *task) {
+  const auto takeFromQueue = [&](TaskQueue &queue, const bool fromBack) {
+    std::lock_guard<std::mutex> lock(queue.mutex);
+    if (queue.tasks.empty()) {
+      return false;
+    }
+
+    auto taskIt = fromBack ? queue.tasks.end() - 1 : queue.tasks.begin();
+    if (group != nullptr) {
+      const auto isInGroup = [group](const Task &queuedTask) { return queuedTask.group == group; };
+      if (fromBack) {
+        const auto reverseTaskIt = std::find_if(queue.tasks.rbegin(), queue.tasks.rend(), isInGroup);
+        if (reverseTaskIt == queue.tasks.rend()) {
+          return false;
+        }
+        taskIt = reverseTaskIt.base() - 1;
+      } else {
+        taskIt = std::find_if(queue.tasks.begin(), queue.tasks.end(), isInGroup);
+        if (taskIt == queue.tasks.end()) {
+          return false;
+        }
+      }
+    }
+
+    *task = std::move(*taskIt);
+    queue.tasks.erase(taskIt);
+    return true;
+  };
+
+  if (group != nullptr && isMainThread() && takeFromQueue(_mainThreadQueue, false)) {
+    return true;
+  }
+
+  const auto ownIndex = ownQueueIndex();
+  const auto queueCount = int(_queues.size());
+  for (int i = 0; i < queueCount; ++i) {
+    const auto queueIndex = (ownIndex + i) % queueCount;
+    const auto isOwnQueue = queueIndex == ownIndex;
+    if (takeFromQueue(*_queues[queueIndex], isOwnQueue && _mode != THREAD_POOL_MODE::DETERMINISTIC)) {
+      --_queuedTaskCount;
+      if (!isOwnQueue && queueIndex != 0 && ownIndex != 0) {
+        ++_stealCount;
+      }
+      return true;
+    }
+  }
+  return false;
+}
+
+void ThreadPool::waitUntil(const void *group, const std::function<bool()> &isFinished) {
+  while (true) {
+    uint64_t eventCount;
+    {
+      std::lock_guard<std::mutex> lock(_sleepMutex);
+      eventCount = _eventCount;
+    }
+    if (isFinished()) {
+      return;
+    }
+
+    Task task;
+    if (takeTask(group, &task)) {
+      task.run();
+      continue;
+    }
+
+    std::unique_lock<std::mutex> lock(_sleepMutex);
+    ++_waiterCount;
+    _eventHappened.wait(lock, [&] { return _stop || _eventCount != eventCount; });
+    --_waiterCount;
+  }
+}
+
+void ThreadPool::notifyWaiters() {
+  {
+    std::lock_guard<std::mutex> lock(_sleepMutex);
+    ++_eventCount;
+    if (_waiterCount == 0) {
+      return;
+    }
+  }
+  _eventHappened.notify_all();
+}
+
+void ThreadPool::enqueueJob(const std::shared_ptr<ScheduledJob> &job) {
+  {
+    std::lock_guard<std::mutex> lock(job->mutex);
+    job->dependencies.clear();
+  }
+
+  Task task = {[this, job] { runJob(job); }, job.get()};
+  if (job->runsOnMainThread) {
+    {
+      std::lock_guard<std::mutex> lock(_mainThreadQueue.mutex);
+      _mainThreadQueue.tasks.push_back(std::move(task));
+    }
+    notifyWaiters();
+  } else if (_mode == THREAD_POOL_MODE::SINGLE_THREADED) {
+    runJob(job);
+  } else {
+    pushTask(std::move(task));
+  }
+}
+
+void ThreadPool::runJob(const std::shared_ptr<ScheduledJob> &job) {
+  {
+    MemoryTagScope memoryTagScope(job->memoryTag);
+    job->function();
+    job->function = nullptr;
+  }
+  ++_executedTaskCount;
+
+  std::vector<std::shared_ptr<ScheduledJob>> dependents;
+  {
+    std::lock_guard<std::mutex> lock(job->mutex);
+    job->isDone = true;
+    dependents.swap(job->dependents);
+  }
+  notifyWaiters();
+
+  for (const auto &dependent : dependents) {
+    if (--dependent->unfinishedDependencyCount == 0) {
+      enqueueJob(dependent);
+    }
+  }
+}
+
+ThreadPool &getThreadPool() {
+  static ThreadPool threadPool(std::max(1u, std::thread::hardware_concurrency()));
+  return threadPool;
+}
@@ -0,0 +1,132 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+enum class THREAD_POOL_MODE {
+  PARALLEL,        // Jobs run on the workers, waiting threads help with what they wait for
+  SINGLE_THREADED, // Jobs and every parallelFor run inline on the thread that starts them
+  DETERMINISTIC,   // Jobs are queued in order and only run by threads waiting on them or pumping the main
+                   // thread jobs, one at a time, so every run is scheduled the same way
+};
+
+struct ThreadPoolCounters {
+  uint64_t executedTaskCount = 0; // Jobs and parallelFor tasks
+  uint64_t stealCount = 0;        // Tasks a worker took from the deque of another worker
+  double idleTimeInMs = 0.0;      // Summed over the workers
+};
+
+struct ScheduledJob;
+
+// Refers to a job scheduled on a thread pool, which stays valid after the job is done
+class JobHandle {
+public:
+  JobHandle() = default;
+
+  explicit operator bool() const { return _job != nullptr; }
+  bool isDone() const;
+
+private:
+  friend class ThreadPool;
+
+  explicit JobHandle(std::shared_ptr<ScheduledJob> job) : _job(std::move(job)) {}
+
+  std::shared_ptr<ScheduledJob> _job;
+};
+
+// Work stealing pool for all CPU side work. Every worker has a deque, it takes its own tasks from the back
+// and steals from the front of the others when it runs out, threads that are not workers queue in a
+// shared deque. A thread waiting for a job or a parallelFor runs tasks of that job or parallelFor itself
+// in the meantime, so both can be used from inside tasks, and it never picks up unrelated work that could
+// take much longer than what it waits for.
+//
+// There is at least one worker, so scheduled jobs run in the background even with a thread count of one.
+// parallelFor only ever splits its tasks over thread count threads.
+class ThreadPool {
+public:
+  explicit ThreadPool(const unsigned threadCount, const THREAD_POOL_MODE mode = THREAD_POOL_MODE::PARALLEL);
+  ~ThreadPool();
+
+  ThreadPool(const ThreadPool &) = delete;
+  ThreadPool &operator=(const ThreadPool &) = delete;
+
+  // The threads a parallelFor runs on, including the calling thread. One unless parallel.
+  unsigned threadCount() const;
+
+  THREAD_POOL_MODE mode() const { return _mode; }
+  // Tasks already queued keep running, jobs that are not queued yet are scheduled in the new mode
+  void setMode(const THREAD_POOL_MODE mode);
+
+  // Runs task(i) for every i in [0, taskCount) and returns when all of them are done
+  void parallelFor(const int taskCount, const std::function<void(int)> &task);
+  // Runs task(x, y) for every x in [0, countX) and y in [0, countY), row by row
+  void parallelFor2D(const int countX, const int countY, const std::function<void(int x, int y)> &task);
+
+  // The job runs once all dependencies are done. Empty handles in dependencies are ignored.
+  JobHandle schedule(std::function<void()> job, const std::vector<JobHandle> &dependencies = {});
+  // Like schedule, but the job only runs in runMainThreadJobs
+  JobHandle scheduleOnMainThread(std::function<void()> job, const std::vector<JobHandle> &dependencies = {});
+  // Returns once the job is done. The main thread also runs main thread jobs it waits for.
+  void wait(const JobHandle &job);
+
+  // Runs the main thread jobs that are ready, and in the modes other than PARALLEL all other queued jobs
+  // first. Once per frame on the thread that owns the GL context, which becomes the main thread.
+  void runMainThreadJobs();
+
+  ThreadPoolCounters counters() const;
+  void resetCounters();
+
+private:
+  struct Task {
+    std::function<void()> run;
+    const void *group; // The job or parallelFor the task belongs to
+  };
+
+  struct TaskQueue {
+    std::mutex mutex;
+    std::deque<Task> tasks;
+  };
+
+  void workerLoop(const int queueIndex);
+  void pushTask(Task task);
+  bool takeTask(const void *group, Task *task);
+  void waitUntil(const void *group, const std::function<bool()> &isFinished);
+  void notifyWaiters();
+  void enqueueJob(const std::shared_ptr<ScheduledJob> &job);
+  void runJob(const std::shared_ptr<ScheduledJob> &job);
+  JobHandle scheduleJob(std::function<void()> function, const bool runsOnMainThread,
+                        const std::vector<JobHandle> &dependencies);
+  int ownQueueIndex() const;
+  bool isMainThread() const { return std::this_thread::get_id() == _mainThreadId.load(); }
+
+  unsigned _threadCount;
+  std::vector<std::thread> _workers;
+  // The shared deque of the threads that are not workers first, then one per worker
+  std::vector<std::unique_ptr<TaskQueue>> _queues;
+  TaskQueue _mainThreadQueue;
+  std::atomic<std::thread::id> _mainThreadId;
+  std::atomic<THREAD_POOL_MODE> _mode;
+
+  // Workers sleep until a task is queued, waiting threads until a task was queued or something finished
+  std::mutex _sleepMutex;
+  std::condition_variable _taskAvailable;
+  std::condition_variable _eventHappened;
+  std::atomic<int> _queuedTaskCount = 0;
+  uint64_t _eventCount = 0;
+  int _waiterCount = 0;
+  bool _stop = false;
+
+  std::atomic<uint64_t> _executedTaskCount = 0;
+  std::atomic<uint64_t> _stealCount = 0;
+  std::atomic<uint64_t> _idleTimeInNs = 0;
+};
+
+// Shared pool sized to the number of hardware threads
+ThreadPool &getThreadPool();
@@ -0,0 +1,57 @@
+#include "tiledHeightQueries.h"
+
+#include <algorithm>
+#include <cassert>
+
+TiledHeightQueries::TiledHeightQueries(const TiledHeightmapReader &reader, const int level,
+                                       const float gridPointSpacing, const float heightMultiplier)
+    : _reader(&reader), _level(level), _inverseGridPointSpacing(1.0f / gridPointSpacing),
+      _heightScale(heightMultiplier * gridPointSpacing), _slopeScale(heightMultiplier) {
+  assert(reader.isOpen() && level >= 0 && level < reader.levelCount());
+  assert(reader.levelWidth(level) >= 2 && reader.levelHeight(level) >= 2);
+  assert(gridPointSpacing > 0.0f && heightMultiplier > 0.0f);
+}
+
+float TiledHeightQueries::getHeight(const glm::vec2 &position) const {
+  const auto quad = getQuad(position);
+  return getSurfaceHeight(getQuadSurface(quad), quad.position);
+}
+
+glm::vec3 TiledHeightQueries::getNormal(const glm::vec2 &position) const {
+  const auto quad = getQuad(position);
+  return getSurfaceNormal(getQuadSurface(quad), quad.position);
+}
+
+void TiledHeightQueries::getHeights(const glm::vec2 *positions, const int count, float *heights) const {
+  for (int k = 0; k < count; ++k) {
+    heights[k] = getHeight(positions[k]);
+  }
+}
+
+void TiledHeightQueries::getNormals(const glm::vec2 *positions, const int count, glm::vec3 *normals) const {
+  for (int k = 0; k < count; ++k) {
+    normals[k] = getNormal(positions[k]);
+  }
+}
+
+TiledHeightQueries::Quad TiledHeightQueries::getQuad(const glm::vec2 &position) const {
+  // Clamped like sampleQuad in heightQueries.cpp, NaN included
+  const auto width = _reader->levelWidth(_level);
+  const auto height = _reader->levelHeight(_level);
+  const auto u = std::min(std::max(0.0f, position.x * _inverseGridPointSpacing), float(width - 1));
+  const auto v = std::min(std::max(0.0f, position.y * _inverseGridPointSpacing), float(height - 1));
+  const auto j = std::min(int(u), width - 2);
+  const auto i = std::min(int(v), height - 2);
+
+  const auto tileSize = _reader->tileSize();
+  const auto texel = [&](const int x, const int y) {
+    return _reader->tile(_level, x / tileSize, y / tileSize).at(x % tileSize, y % tileSize);
+  };
+  return {{texel(j, i), texel(j + 1, i), texel(j, i + 1), texel(j + 1, i + 1)},
+          glm::vec2(u - float(j), v - float(i))};
+}
+
+HeightQuerySurface TiledHeightQueries::getQuadSurface(const Quad &quad) const {
+  // Positions within the quad are already in texels, so the fractions are the same as over the whole level
+  return {quad.heights, 2, 2, 2, 1.0f, _heightScale, _slopeScale};
+}
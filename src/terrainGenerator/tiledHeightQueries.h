@@ -0,0 +1,41 @@
+#pragma once
+
+#include "heightQueryKernels.h"
+#include "tiledHeightmap.h"
+
+#include "glm/glm.hpp"
+
+// Height and normal queries like HeightQueries against a level of a tiled heightmap, read straight from the
+// mapped tiles, so maps larger than memory can be queried. Texel (j, i) of the level is at world
+// (x, z) = (j, i) * gridPointSpacing. The results are bit identical to a HeightQueries over the whole level,
+// also for quads across tile seams, whose texels are gathered from up to four tiles.
+//
+// A single tile view is a HeightfieldView and can be passed to HeightQueries as it is, this is for queries
+// anywhere on a level. Any number of threads can query at once, the reader has to stay open meanwhile.
+class TiledHeightQueries {
+public:
+  // The level has to be at least 2x2 texels
+  TiledHeightQueries(const TiledHeightmapReader &reader, const int level, const float gridPointSpacing,
+                     const float heightMultiplier);
+
+  float getHeight(const glm::vec2 &position) const;
+  glm::vec3 getNormal(const glm::vec2 &position) const;
+
+  void getHeights(const glm::vec2 *positions, const int count, float *heights) const;
+  void getNormals(const glm::vec2 *positions, const int count, glm::vec3 *normals) const;
+
+private:
+  struct Quad {
+    float heights[4];   // 2x2 texels, row-major
+    glm::vec2 position; // Within the quad, in texels
+  };
+
+  Quad getQuad(const glm::vec2 &position) const;
+  HeightQuerySurface getQuadSurface(const Quad &quad) const;
+
+  const TiledHeightmapReader *_reader;
+  int _level;
+  float _inverseGridPointSpacing;
+  float _heightScale;
+  float _slopeScale;
+};
@@ -0,0 +1,444 @@
+#include "tiledHeightmap.h"
+
+#include "profiler.h"
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include <filesystem>
+#include <limits>
+
+static constexpr uint32_t kTiledHeightmapMagic = 0x48544754; // "TGTH"
+
+static constexpr uint32_t kHasTileRangesFlag = 1;
+
+// The tile index follows right after the header
+struct TiledHeightmapHeader {
+  uint32_t magic;
+  uint32_t version;
+  int32_t width;
+  int32_t height;
+  int32_t tileSize;
+  int32_t levelCount;
+  uint32_t flags;
+  uint32_t tileCount;
+  uint8_t reserved[32];
+};
+static_assert(sizeof(TiledHeightmapHeader) == 64);
+
+struct TiledHeightmapTileEntry {
+  uint64_t offset; // From the start of the file
+  float min;
+  float max;
+};
+static_assert(sizeof(TiledHeightmapTileEntry) == 16);
+
+static constexpr auto kEmptyTileRange =
+    glm::vec2(std::numeric_limits<float>::max(), std::numeric_limits<float>::lowest());
+
+static int getTileCount(const int size, const int tileSize) { return (size + tileSize - 1) / tileSize; }
+
+static size_t getTileSizeInBytes(const int tileSize) {
+  return size_t(tileSize) * size_t(tileSize) * sizeof(float);
+}
+
+static uint64_t getFirstTileOffset(const int tileCount) {
+  const auto indexEnd = sizeof(TiledHeightmapHeader) + size_t(tileCount) * sizeof(TiledHeightmapTileEntry);
+  return (indexEnd + Heightfield::kAlignment - 1) / Heightfield::kAlignment * Heightfield::kAlignment;
+}
+
+static glm::vec2 getTileRange(const HeightfieldView &tile) {
+  auto range = kEmptyTileRange;
+  for (int i = 0; i < tile.height(); ++i) {
+    const auto [minHeight, maxHeight] = std::minmax_element(tile.row(i).begin(), tile.row(i).end());
+    range = glm::vec2(std::min(range.x, *minHeight), std::max(range.y, *maxHeight));
+  }
+  return range;
+}
+
+// Whether the tile at this index along one axis adds any texel to the level above of the given size
+static bool isParentTexelCovered(const int tile, const int parentLevelSize, const int tileSize) {
+  return tile * (tileSize / 2) < parentLevelSize;
+}
+
+// Tiles along one axis that add texels to the parent tile at this index
+static int getChildTileCount(const int parentTile, const int tileCount, const int parentLevelSize,
+                             const int tileSize) {
+  int childTileCount = 0;
+  for (int tile = 2 * parentTile; tile < std::min(2 * parentTile + 2, tileCount); ++tile) {
+    childTileCount += isParentTexelCovered(tile, parentLevelSize, tileSize) ? 1 : 0;
+  }
+  return childTileCount;
+}
+
+int getTiledHeightmapLevelCount(const int width, const int height, const int tileSize) {
+  int levelCount = 1;
+  while (std::max(getNoiseMapLevelSize(width, levelCount - 1), getNoiseMapLevelSize(height, levelCount - 1)) >
+         tileSize) {
+    ++levelCount;
+  }
+  return levelCount;
+}
+
+bool TiledHeightmapReader::open(const std::string &filePath) {
+  close();
+  if (!_file.open(filePath) || _file.size() < sizeof(TiledHeightmapHeader)) {
+    close();
+    return false;
+  }
+
+  TiledHeightmapHeader header;
+  std::memcpy(&header, _file.data(), sizeof(header));
+  if (header.magic != kTiledHeightmapMagic || header.version != kTiledHeightmapVersion ||
+      header.width <= 0 || header.height <= 0 || header.tileSize <= 0 ||
+      header.tileSize % Heightfield::kStrideAlignment != 0 ||
+      header.levelCount != getTiledHeightmapLevelCount(header.width, header.height, header.tileSize)) {
+    close();
+    return false;
+  }
+
+  _tileSize = header.tileSize;
+  _hasTileRanges = (header.flags & kHasTileRangesFlag) != 0;
+  int tileCount = 0;
+  for (int level = 0; level < header.levelCount; ++level) {
+    const auto width = getNoiseMapLevelSize(header.width, level);
+    const auto height = getNoiseMapLevelSize(header.height, level);
+    _levels.push_back(
+        {width, height, getTileCount(width, _tileSize), getTileCount(height, _tileSize), tileCount});
+    tileCount += _levels.back().tileCountX * _levels.back().tileCountY;
+  }
+
+  if (uint32_t(tileCount) != header.tileCount || _file.size() < getFirstTileOffset(tileCount)) {
+    close();
+    return false;
+  }
+
+  // Every tile has to lie within the file and be aligned, so views in to the mapping are safe to use
+  _tileIndex = _file.data() + sizeof(header);
+  for (int i = 0; i < tileCount; ++i) {
+    TiledHeightmapTileEntry entry;
+    std::memcpy(&entry, _tileIndex + size_t(i) * sizeof(entry), sizeof(entry));
+    if (entry.offset % Heightfield::kAlignment != 0 || entry.offset > _file.size() ||
+        _file.size() - entry.offset < getTileSizeInBytes(_tileSize)) {
+      close();
+      return false;
+    }
+  }
+
+  return true;
+}
+
+void TiledHeightmapReader::close() {
+  _file.close();
+  _tileSize = 0;
+  _hasTileRanges = false;
+  _levels.clear();
+  _tileIndex = nullptr;
+}
+
+HeightfieldView TiledHeightmapReader::tile(const int level, const int tileX, const int tileY) const {
+  const auto &tileLevel = _levels[level];
+  assert(tileX >= 0 && tileX < tileLevel.tileCountX && tileY >= 0 && tileY < tileLevel.tileCountY);
+
+  TiledHeightmapTileEntry entry;
+  const auto tileIndex = size_t(tileLevel.firstTile) + size_t(tileY) * tileLevel.tileCountX + tileX;
+  std::memcpy(&entry, _tileIndex + tileIndex * sizeof(entry), sizeof(entry));
+
+  return HeightfieldView(reinterpret_cast<const float *>(_file.data() + entry.offset),
+                         std::min(_tileSize, tileLevel.width - tileX * _tileSize),
+                         std::min(_tileSize, tileLevel.height - tileY * _tileSize), _tileSize);
+}
+
+glm::vec2 TiledHeightmapReader::tileRange(const int level, const int tileX, const int tileY) const {
+  assert(_hasTileRanges);
+  const auto &tileLevel = _levels[level];
+
+  TiledHeightmapTileEntry entry;
+  const auto tileIndex = size_t(tileLevel.firstTile) + size_t(tileY) * tileLevel.tileCountX + tileX;
+  std::memcpy(&entry, _tileIndex + tileIndex * sizeof(entry), sizeof(entry));
+  return glm::vec2(entry.min, entry.max);
+}
+
+TiledHeightmapWriter::~TiledHeightmapWriter() {
+  if (_file.is_open()) {
+    _file.close();
+    std::error_code errorCode;
+    std::filesystem::remove(_filePath + ".tmp", errorCode);
+  }
+}
+
+bool TiledHeightmapWriter::open(const std::string &filePath, const int width, const int height,
+                                const int tileSize, const bool storeTileRanges) {
+  assert(width > 0 && height > 0 && tileSize > 0 && tileSize % Heightfield::kStrideAlignment == 0);
+
+  _filePath = filePath;
+  _tileSize = tileSize;
+  _storeTileRanges = storeTileRanges;
+  _hasFailed = false;
+
+  const auto levelCount = getTiledHeightmapLevelCount(width, height, tileSize);
+  _levelSizes.clear();
+  _firstTiles.clear();
+  int tileCount = 0;
+  for (int level = 0; level < levelCount; ++level) {
+    _levelSizes.emplace_back(getNoiseMapLevelSize(width, level), getNoiseMapLevelSize(height, level));
+    _firstTiles.push_back(tileCount);
+    tileCount += getTileCount(_levelSizes.back().x, tileSize) * getTileCount(_levelSizes.back().y, tileSize);
+  }
+  _tileRanges.assign(tileCount, kEmptyTileRange);
+  _writtenTiles.assign(tileCount, false);
+  _pendingTiles.clear();
+  _pendingTiles.resize(levelCount);
+  _paddedTile.resize(size_t(tileSize) * size_t(tileSize));
+
+  // Written next to the final file and renamed by close, so a reader never maps a partially written map.
+  // It is sized up front, tiles are written at their final offsets in whatever order they come.
+  _file.open(filePath + ".tmp", std::ios::binary | std::ios::in | std::ios::out | std::ios::trunc);
+  if (!_file) {
+    return false;
+  }
+  const auto fileSize = getFirstTileOffset(tileCount) + size_t(tileCount) * getTileSizeInBytes(tileSize);
+  _file.seekp(std::streamoff(fileSize - 1));
+  _file.put('\0');
+  return bool(_file);
+}
+
+bool TiledHeightmapWriter::writeTile(const int tileX, const int tileY, const HeightfieldView &tile) {
+  assert(tile.width() == std::min(_tileSize, _levelSizes[0].x - tileX * _tileSize));
+  assert(tile.height() == std::min(_tileSize, _levelSizes[0].y - tileY * _tileSize));
+  PROFILE_ZONE("Write heightmap tile");
+
+  return writeLevelTile(0, tileX, tileY, tile, getTileRange(tile));
+}
+
+bool TiledHeightmapWriter::writeLevelTile(const int level, const int tileX, const int tileY,
+                                          const HeightfieldView &tile, const glm::vec2 &range) {
+  const auto tileCountX = getTileCount(_levelSizes[level].x, _tileSize);
+  const auto tileIndex = _firstTiles[level] + tileY * tileCountX + tileX;
+  if (_hasFailed || _writtenTiles[tileIndex]) {
+    _hasFailed = true;
+    return false;
+  }
+
+  // Repeat the last column and row in to the padding
+  for (int i = 0; i < _tileSize; ++i) {
+    const auto row = tile.row(std::min(i, tile.height() - 1));
+    const auto paddedRow = _paddedTile.data() + size_t(i) * _tileSize;
+    std::copy(row.begin(), row.end(), paddedRow);
+    std::fill(paddedRow + tile.width(), paddedRow + _tileSize, row.back());
+  }
+
+  _file.seekp(std::streamoff(getFirstTileOffset(int(_writtenTiles.size())) +
+                             size_t(tileIndex) * getTileSizeInBytes(_tileSize)));
+  _file.write(reinterpret_cast<const char *>(_paddedTile.data()),
+              std::streamsize(getTileSizeInBytes(_tileSize)));
+  _writtenTiles[tileIndex] = true;
+  _tileRanges[tileIndex] = range;
+  if (!_file) {
+    _hasFailed = true;
+    return false;
+  }
+
+  if (level + 1 == int(_levelSizes.size())) {
+    return true;
+  }
+
+  // The parent tile is finished once all of the up to four tiles it covers are in. A last tile of a single
+  // column or row adds nothing to the parent level, floor halving drops it.
+  const auto parentLevel = level + 1;
+  const auto parentX = tileX / 2;
+  const auto parentY = tileY / 2;
+  if (!isParentTexelCovered(tileX, _levelSizes[parentLevel].x, _tileSize) ||
+      !isParentTexelCovered(tileY, _levelSizes[parentLevel].y, _tileSize)) {
+    return true;
+  }
+  const auto parentSize = glm::ivec2(std::min(_tileSize, _levelSizes[parentLevel].x - parentX * _tileSize),
+                                     std::min(_tileSize, _levelSizes[parentLevel].y - parentY * _tileSize));
+  const auto parentIndex = parentY * getTileCount(_levelSizes[parentLevel].x, _tileSize) + parentX;
+
+  auto &pendingTiles = _pendingTiles[parentLevel];
+  auto pendingTileIt = pendingTiles.find(parentIndex);
+  if (pendingTileIt == pendingTiles.end()) {
+    PendingTile parent = {Heightfield(parentSize.x, parentSize.y), kEmptyTileRange};
+    pendingTileIt = pendingTiles.emplace(parentIndex, std::move(parent)).first;
+  }
+  downsampleInToParent(level, tileX, tileY, tile, range, &pendingTileIt->second);
+
+  const auto tileCountY = getTileCount(_levelSizes[level].y, _tileSize);
+  const auto childCount = getChildTileCount(parentX, tileCountX, _levelSizes[parentLevel].x, _tileSize) *
+                          getChildTileCount(parentY, tileCountY, _levelSizes[parentLevel].y, _tileSize);
+  if (pendingTileIt->second.writtenChildCount < childCount) {
+    return true;
+  }
+
+  const auto parent = std::move(pendingTileIt->second);
+  pendingTiles.erase(pendingTileIt);
+  return writeLevelTile(parentLevel, parentX, parentY, parent.texels, parent.range);
+}
+
+void TiledHeightmapWriter::downsampleInToParent(const int level, const int tileX, const int tileY,
+                                                const HeightfieldView &tile, const glm::vec2 &range,
+                                                PendingTile *parent) {
+  // Tile origins are even, so the 2x2 texels of a parent texel never span two tiles
+  const auto parentLevelSize = _levelSizes[level + 1];
+  const auto parentOrigin = glm::ivec2(tileX / 2, tileY / 2) * _tileSize;
+  const auto tileOrigin = glm::ivec2(tileX, tileY) * _tileSize;
+
+  for (int i = 0; i < tile.height(); i += 2) {
+    const auto parentY = (tileOrigin.y + i) / 2;
+    if (parentY >= parentLevelSize.y) {
+      break;
+    }
+
+    const auto row = tile.row(i);
+    const auto nextRow = tile.row(std::min(i + 1, tile.height() - 1));
+    const auto parentRow = parent->texels.row(parentY - parentOrigin.y);
+    for (int j = 0; j < tile.width(); j += 2) {
+      const auto parentX = (tileOrigin.x + j) / 2;
+      if (parentX >= parentLevelSize.x) {
+        break;
+      }
+
+      const auto nextJ = std::min(j + 1, tile.width() - 1);
+      parentRow[parentX - parentOrigin.x] = (row[j] + row[nextJ] + nextRow[j] + nextRow[nextJ]) * 0.25f;
+    }
+  }
+
+  parent->range = glm::vec2(std::min(parent->range.x, range.x), std::max(parent->range.y, range.y));
+  ++parent->writtenChildCount;
+}
+
+bool TiledHeightmapWriter::close() {
+  if (!_file.is_open()) {
+    return false;
+  }
+
+  const auto isComplete =
+      !_hasFailed && std::all_of(_writtenTiles.begin(), _writtenTiles.end(), [](const bool isWritten) {
+        return isWritten;
+      });
+  if (isComplete) {
+    const auto tileCount = int(_writtenTiles.size());
+    std::vector<TiledHeightmapTileEntry> tileIndex(tileCount);
+    for (int i = 0; i < tileCount; ++i) {
+      const auto range = _storeTileRanges ? _tileRanges[i] : glm::vec2(0.0f);
+      tileIndex[i] = {getFirstTileOffset(tileCount) + size_t(i) * getTileSizeInBytes(_tileSize), range.x,
+                      range.y};
+    }
+
+    TiledHeightmapHeader header = {};
+    header.magic = kTiledHeightmapMagic;
+    header.version = kTiledHeightmapVersion;
+    header.width = _levelSizes[0].x;
+    header.height = _levelSizes[0].y;
+    header.tileSize = _tileSize;
+    header.levelCount = int(_levelSizes.size());
+    header.flags = _storeTileRanges ? kHasTileRangesFlag : 0;
+    header.tileCount = uint32_t(tileCount);
+
+    _file.seekp(0);
+    _file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    _file.write(reinterpret_cast<const char *>(tileIndex.data()),
+                std::streamsize(tileIndex.size() * sizeof(TiledHeightmapTileEntry)));
+  }
+
+  const auto isWritten = isComplete && bool(_file);
+  _file.close();
+  _pendingTiles.clear();
+
+  const auto temporaryFilePath = _filePath + ".tmp";
+  std::error_code errorCode;
+  if (isWritten) {
+    std::filesystem::rename(temporaryFilePath, _filePath, errorCode);
+  }
+  if (!isWritten || errorCode) {
+    std::filesystem::remove(temporaryFilePath, errorCode);
+    return false;
+  }
+  return true;
+}
+
+bool generateTiledHeightmap(const std::string &filePath, const NoiseMapData &noiseMapData,
+                            const bool useFalloffMap, const int tileSize,
+                            const NoiseMapGenerationContext &context) {
+  PROFILE_ZONE("Generate tiled heightmap");
+
+  TiledHeightmapWriter writer;
+  if (!writer.open(filePath, noiseMapData.width, noiseMapData.height, tileSize)) {
+    return false;
+  }
+
+  const auto writeTile = [&](const int x, const int y, const HeightfieldView &tile) {
+    return writer.writeTile(x / tileSize, y / tileSize, tile);
+  };
+  return generateNoiseMapTiles(noiseMapData, useFalloffMap, tileSize, context, writeTile) && writer.close();
+}
+
+// Every texel of level is the average of the 2x2 texels of level - 1 below it, the last row and column of an
+// odd sized level repeated
+static bool isDownsampledLevel(const TiledHeightmapReader &reader, const int level) {
+  const auto tileSize = reader.tileSize();
+  const auto childWidth = reader.levelWidth(level - 1);
+  const auto childHeight = reader.levelHeight(level - 1);
+  const auto childTexel = [&](const int x, const int y) {
+    return reader.tile(level - 1, x / tileSize, y / tileSize).at(x % tileSize, y % tileSize);
+  };
+
+  for (int tileY = 0; tileY < reader.tileCountY(level); ++tileY) {
+    for (int tileX = 0; tileX < reader.tileCountX(level); ++tileX) {
+      const auto tile = reader.tile(level, tileX, tileY);
+      for (int i = 0; i < tile.height(); ++i) {
+        const auto y = (tileY * tileSize + i) * 2;
+        const auto nextY = std::min(y + 1, childHeight - 1);
+        for (int j = 0; j < tile.width(); ++j) {
+          const auto x = (tileX * tileSize + j) * 2;
+          const auto nextX = std::min(x + 1, childWidth - 1);
+          const auto average =
+              (childTexel(x, y) + childTexel(nextX, y) + childTexel(x, nextY) + childTexel(nextX, nextY)) *
+              0.25f;
+          if (tile.at(j, i) != average) {
+            return false;
+          }
+        }
+      }
+    }
+  }
+  return true;
+}
+
+bool verifyTiledHeightmap(const std::string &filePath, const NoiseMapData &noiseMapData,
+                          const bool useFalloffMap, const NoiseMapGenerationContext &context) {
+  PROFILE_ZONE("Verify tiled heightmap");
+
+  TiledHeightmapReader reader;
+  if (!reader.open(filePath) || reader.width() != noiseMapData.width ||
+      reader.height() != noiseMapData.height) {
+    return false;
+  }
+
+  const auto tileSize = reader.tileSize();
+  const auto compareTile = [&](const int x, const int y, const HeightfieldView &tile) {
+    const auto tileX = x / tileSize;
+    const auto tileY = y / tileSize;
+    const auto readTile = reader.tile(0, tileX, tileY);
+    if (readTile.width() != tile.width() || readTile.height() != tile.height()) {
+      return false;
+    }
+
+    for (int i = 0; i < tile.height(); ++i) {
+      if (std::memcmp(readTile.row(i).data(), tile.row(i).data(), tile.row(i).size_bytes()) != 0) {
+        return false;
+      }
+    }
+    return !reader.hasTileRanges() || reader.tileRange(0, tileX, tileY) == getTileRange(tile);
+  };
+  if (!generateNoiseMapTiles(noiseMapData, useFalloffMap, tileSize, context, compareTile)) {
+    return false;
+  }
+
+  for (int level = 1; level < reader.levelCount(); ++level) {
+    if (!isDownsampledLevel(reader, level)) {
+      return false;
+    }
+  }
+  return true;
+}
@@ -0,0 +1,123 @@
+#pragma once
+
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "heightfield.h"
+#include "mappedFile.h"
+#include "noiseMapGenerator.h"
+
+#include "glm/glm.hpp"
+
+// Heightmap file split in to fixed size square tiles with a mip pyramid, for maps far larger than memory.
+// A header and an index of every tile come first, then the tiles of each level. Every tile is
+// tileSize^2 floats at a 64-byte aligned offset, so mapped tiles can be used in place. Tiles at the right
+// and bottom edge of a level are padded by repeating their last column and row.
+//
+// Level n is max(1, size >> n) texels wide and high, every texel the average of the 2x2 texels below it.
+// The last level fits in to a single tile.
+
+constexpr uint32_t kTiledHeightmapVersion = 1;
+
+// Not counting the edge padding
+int getTiledHeightmapLevelCount(const int width, const int height, const int tileSize);
+
+// Memory maps a tiled heightmap file. Tile views point in to the mapping and stay valid until close.
+class TiledHeightmapReader {
+public:
+  // Returns false if the file does not exist or is not a valid tiled heightmap
+  bool open(const std::string &filePath);
+  void close();
+
+  bool isOpen() const { return _file.isOpen(); }
+  int width() const { return levelWidth(0); }
+  int height() const { return levelHeight(0); }
+  int tileSize() const { return _tileSize; }
+  int levelCount() const { return int(_levels.size()); }
+  int levelWidth(const int level) const { return _levels[level].width; }
+  int levelHeight(const int level) const { return _levels[level].height; }
+  int tileCountX(const int level) const { return _levels[level].tileCountX; }
+  int tileCountY(const int level) const { return _levels[level].tileCountY; }
+  bool hasTileRanges() const { return _hasTileRanges; }
+
+  // Width and height of the view exclude the edge padding, the stride is tileSize
+  HeightfieldView tile(const int level, const int tileX, const int tileY) const;
+  // Min and max of the full resolution heights the tile covers, only if hasTileRanges
+  glm::vec2 tileRange(const int level, const int tileX, const int tileY) const;
+
+private:
+  struct Level {
+    int width, height;
+    int tileCountX, tileCountY;
+    int firstTile;
+  };
+
+  MappedFile _file;
+  int _tileSize = 0;
+  bool _hasTileRanges = false;
+  std::vector<Level> _levels;
+  const std::byte *_tileIndex = nullptr;
+};
+
+// Writes a tiled heightmap from full resolution tiles. Coarser levels are downsampled as soon as every
+// tile below them was written, so only a row of tiles per level is kept in memory if the tiles come in
+// row-major order. The file only appears at filePath once close succeeded.
+class TiledHeightmapWriter {
+public:
+  TiledHeightmapWriter() = default;
+  ~TiledHeightmapWriter();
+
+  TiledHeightmapWriter(const TiledHeightmapWriter &) = delete;
+  TiledHeightmapWriter &operator=(const TiledHeightmapWriter &) = delete;
+
+  // tileSize has to be a multiple of 16. storeTileRanges keeps the min/max of every tile in the index.
+  bool open(const std::string &filePath, const int width, const int height, const int tileSize,
+            const bool storeTileRanges = true);
+
+  // Every full resolution tile in any order, exactly once. The tile is (tileX * tileSize, tileY * tileSize)
+  // in the map and only as large as the part of the map it covers.
+  bool writeTile(const int tileX, const int tileY, const HeightfieldView &tile);
+
+  // Writes the index, false if a tile is missing or anything failed to write
+  bool close();
+
+private:
+  struct PendingTile {
+    Heightfield texels;
+    glm::vec2 range;
+    int writtenChildCount = 0;
+  };
+
+  bool writeLevelTile(const int level, const int tileX, const int tileY, const HeightfieldView &tile,
+                      const glm::vec2 &range);
+  void downsampleInToParent(const int level, const int tileX, const int tileY, const HeightfieldView &tile,
+                            const glm::vec2 &range, PendingTile *parent);
+
+  std::string _filePath;
+  std::fstream _file;
+  int _tileSize = 0;
+  bool _storeTileRanges = true;
+  bool _hasFailed = false;
+  std::vector<glm::ivec2> _levelSizes;
+  std::vector<int> _firstTiles; // Index of the first tile of every level
+  std::vector<glm::vec2> _tileRanges;
+  std::vector<bool> _writtenTiles;
+  std::vector<std::unordered_map<int, PendingTile>> _pendingTiles; // Per level, by tile index in the level
+  std::vector<float> _paddedTile;
+};
+
+// Streams the map from generateNoiseMapTiles straight in to a tiled heightmap file, the whole map is never
+// held in memory. The normalisation must not be LOCAL.
+bool generateTiledHeightmap(const std::string &filePath, const NoiseMapData &noiseMapData,
+                            const bool useFalloffMap, const int tileSize,
+                            const NoiseMapGenerationContext &context = {});
+
+// Reads a tiled heightmap back through its tile views and checks it against the settings it was generated
+// with: level 0 has to be bit identical to generateNoiseMapTiles, every coarser level the 2x2 averages of
+// the level below and the stored ranges the min/max of the full resolution tiles. Like the generation it
+// never holds the whole map.
+bool verifyTiledHeightmap(const std::string &filePath, const NoiseMapData &noiseMapData,
+                          const bool useFalloffMap, const NoiseMapGenerationContext &context = {});
@@ -0,0 +1,64 @@
+#include "vertexAttributes.h"
+
+void calculateNormals(const std::vector<uint32_t> &indices, std::vector<Vertex> *vertices) {
+  for (size_t i = 0, size = indices.size(); i < size; i = i + 3) {
+    auto &v1 = (*vertices)[indices[i]];
+    auto &v2 = (*vertices)[indices[i + 1]];
+    auto &v3 = (*vertices)[indices[i + 2]];
+
+    const auto edgeOne = glm::vec3(v2.position3f) - glm::vec3(v1.position3f);
+    const auto edgeTwo = glm::vec3(v3.position3f) - glm::vec3(v1.position3f);
+    const auto faceNormal = glm::cross(edgeOne, edgeTwo);
+    v1.normal += faceNormal;
+    v2.normal += faceNormal;
+    v3.normal += faceNormal;
+  }
+
+  for (size_t i = 0, size = vertices->size(); i < size; i++) {
+    auto &v = (*vertices)[i];
+    v.normal = glm::normalize(v.normal);
+  }
+}
+
+void calculateTangentVectors(const std::vector<uint32_t> &indices, std::vector<Vertex> *vertices) {
+  for (size_t i = 0, size = indices.size(); i < size; i = i + 3) {
+    auto &v1 = (*vertices)[indices[i]];
+    auto &v2 = (*vertices)[indices[i + 1]];
+    auto &v3 = (*vertices)[indices[i + 2]];
+
+    const auto edgeOne = glm::vec3(v2.position3f) - glm::vec3(v1.position3f);
+    const auto edgeTwo = glm::vec3(v3.position3f) - glm::vec3(v1.position3f);
+    const auto deltaUVOne = v2.textureCoordinate - v1.textureCoordinate;
+    const auto deltaUVTwo = v3.textureCoordinate - v1.textureCoordinate;
+
+    const auto fract = 1.0f / (deltaUVOne.x * deltaUVTwo.y - deltaUVTwo.x * deltaUVOne.y);
+
+    glm::vec3 tangent(0.0f);
+    glm::vec3 bitangent(0.0f);
+
+    tangent.x = fract * (deltaUVTwo.y * edgeOne.x - deltaUVOne.y * edgeTwo.x);
+    tangent.y = fract * (deltaUVTwo.y * edgeOne.y - deltaUVOne.y * edgeTwo.y);
+    tangent.z = fract * (deltaUVTwo.y * edgeOne.z - deltaUVOne.y * edgeTwo.z);
+
+    bitangent.x = fract * (-deltaUVTwo.x * edgeOne.x + deltaUVOne.x * edgeTwo.x);
+    bitangent.y = fract * (-deltaUVTwo.x * edgeOne.y + deltaUVOne.x * edgeTwo.y);
+    bitangent.z = fract * (-deltaUVTwo.x * edgeOne.z + deltaUVOne.x * edgeTwo.z);
+
+    v1.tangent += tangent;
+    v2.tangent += tangent;
+    v3.tangent += tangent;
+
+    v1.bitangent += bitangent;
+    v2.bitangent += bitangent;
+    v3.bitangent += bitangent;
+  }
+
+  for (size_t i = 0, size = vertices->size(); i < size; i++) {
+    auto &v = (*vertices)[i];
+    const auto &T = v.tangent;
+    const auto &B = v.bitangent;
+    const auto &N = v.normal;
+    v.tangent = normalize(T - glm::dot(T, N) * N);
+    v.bitangent = glm::cross(N, T);
+  }
+}
@@ -0,0 +1,23 @@
+#pragma once
+
+#include "glm/glm.hpp"
+#include <cstdint>
+#include <vector>
+
+struct Vertex {
+  union {
+    glm::vec2 position2f;
+    glm::vec3 position3f;
+    glm::vec4 position4f;
+  };
+
+  glm::vec3 normal;
+  glm::vec3 tangent;
+  glm::vec3 bitangent;
+  glm::vec2 textureCoordinate;
+};
+
+// Both take an indexed triangle list. Normals are accumulated face normals, tangents are orthogonalised
+// against them so the normals have to be calculated first.
+void calculateNormals(const std::vector<uint32_t> &indices, std::vector<Vertex> *vertices);
+void calculateTangentVectors(const std::vector<uint32_t> &indices, std::vector<Vertex> *vertices);